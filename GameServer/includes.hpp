@@ -20,6 +20,8 @@
 
 #include <map>
 #include <vector>
+#include <memory>
+#include <cstdint>
 
 /*
 https://stackoverflow.com/questions/4842424/list-of-ansi-color-escape-sequences
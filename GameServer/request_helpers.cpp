@@ -869,7 +869,7 @@ void print_banner()
 bool Session::is_full() const
 {
     // if AI mode, only player1 is needed to be set
-    if (player1 != nullptr && player2 == nullptr && player1->get_chosen_game_mode() == 1)
+    if (player1 != nullptr && player2 == nullptr && (player1->get_chosen_game_mode() == 1 || player1->get_chosen_game_mode() == 2))
         return true;
     // if multiplayer mode, both players need to be set
     else if (player1 != nullptr && player2 != nullptr)
@@ -4,6 +4,7 @@
 #include "includes.hpp"
 #include "./server/classes.hpp"
 #include "./server/mcts_algorithm.hpp"
+#include "./server/alphabeta.hpp"
 
 using namespace std;
 
@@ -161,7 +162,7 @@ protected:
     int socket;
     string nickname;
     int chosen_game;
-    int chosen_game_mode; // 0 = multiplayer, 1 = AI
+    int chosen_game_mode; // 0 = multiplayer, 1 = AI (MCTS), 2 = AI (alpha-beta)
     Session *session;     // pointer to the session the player is in
     int id;
 
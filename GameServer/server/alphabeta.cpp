@@ -0,0 +1,458 @@
+#include "alphabeta.hpp"
+#include "tree_format.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+#define AB_EXACT 0 // the score is exact
+#define AB_LOWER 1 // the score is a lower bound (the node failed high)
+#define AB_UPPER 2 // the score is an upper bound (the node failed low)
+
+// wins closer than this to AB_WIN are scores of found wins, which are stored relative to the node in the table
+#define AB_WIN_BOUND (AB_WIN - AB_MAX_PLY)
+
+int evaluate(GameState &state)
+{
+    int score[3] = {0, 0, 0};
+    Board *board = state.get_board();
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            Piece *piece = board->get_Piece(y, x);
+            int id = piece->get_id();
+            if (id == NOPLAYER)
+            {
+                continue;
+            }
+            if (piece->get_king())
+            {
+                score[id] += AB_KING_VALUE;
+            }
+            else
+            {
+                // player 1 promotes on row 7, player 2 on row 0
+                score[id] += AB_MAN_VALUE + AB_ADVANCE_VALUE * (id == PLAYER1 ? y : 7 - y);
+            }
+        }
+    }
+    int player = state.get_current_player();
+    return score[player] - score[player == PLAYER1 ? PLAYER2 : PLAYER1];
+}
+
+int quiescence(GameState &state, int ply, int alpha, int beta, long long &budget)
+{
+    budget--;
+    int player = state.get_current_player();
+    int opponent = player == PLAYER1 ? PLAYER2 : PLAYER1;
+    Board *board = state.get_board();
+    // the last capture may have ended the game
+    if (board->get_num_players(player) == 0)
+    {
+        return -(AB_WIN - ply);
+    }
+    if (board->get_num_players(opponent) == 0)
+    {
+        return AB_WIN - ply;
+    }
+    if (budget < 0 || ply >= AB_MAX_PLY - 1)
+    {
+        return evaluate(state);
+    }
+    state.list_all_captures(player);
+    if (state.possible_moves.empty())
+    {
+        return evaluate(state);
+    }
+    // jumps are mandatory, so there is no standing pat: the score is that of the best capture
+    vector<Move> captures = state.possible_moves;
+    int best_score = -AB_INFINITY;
+    for (Move move : captures)
+    {
+        GameState child = state.clone();
+        child.switch_player();
+        move.perform_move(child.get_board(), move);
+        int score = -quiescence(child, ply + 1, -beta, -alpha, budget);
+        best_score = max(best_score, score);
+        alpha = max(alpha, score);
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+    return best_score;
+}
+
+/** @brief Returns true if both moves go from the same square to the same square. */
+static bool same_move(const Move &a, const Move &b)
+{
+    return a.get_src_y() == b.get_src_y() && a.get_src_x() == b.get_src_x() && a.get_dest_y() == b.get_dest_y() &&
+           a.get_dest_x() == b.get_dest_x();
+}
+
+/** @brief Returns true if `move` crowns a man of the player to move in `state`. */
+static bool is_promotion(GameState &state, const Move &move)
+{
+    int last_row = state.get_current_player() == PLAYER1 ? 7 : 0;
+    return move.get_dest_y() == last_row && !state.get_board()->get_Piece(move.get_src_y(), move.get_src_x())->get_king();
+}
+
+// ----- transposition table -----
+/** @brief Packs an entry into one word; the depth is at least 1, so an entry is never 0. */
+static uint64_t pack_entry(const TTEntry &entry)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(entry.score)) | static_cast<uint64_t>(static_cast<uint8_t>(entry.depth)) << 32 |
+           static_cast<uint64_t>(entry.bound) << 40 | static_cast<uint64_t>(entry.move) << 48 | static_cast<uint64_t>(entry.jump) << 56;
+}
+
+/** @brief Unpacks an entry packed with `pack_entry`. */
+static TTEntry unpack_entry(uint64_t data)
+{
+    TTEntry entry;
+    entry.score = static_cast<int32_t>(static_cast<uint32_t>(data));
+    entry.depth = static_cast<int8_t>(data >> 32);
+    entry.bound = static_cast<uint8_t>(data >> 40);
+    entry.move = static_cast<uint8_t>(data >> 48);
+    entry.jump = static_cast<uint8_t>(data >> 56);
+    return entry;
+}
+
+TranspositionTable::TranspositionTable(int bits) : slots(new Slot[static_cast<size_t>(1) << bits]), mask((static_cast<uint64_t>(1) << bits) - 1)
+{
+    clear();
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const
+{
+    const Slot &slot = slots[key & mask];
+    // relaxed is enough: a torn slot fails the check
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+    if (data == 0 || (check ^ data) != key)
+    {
+        return false;
+    }
+    entry = unpack_entry(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry &entry)
+{
+    Slot &slot = slots[key & mask];
+    uint64_t data = pack_entry(entry);
+    slot.check.store(key ^ data, memory_order_relaxed);
+    slot.data.store(data, memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+    for (uint64_t i = 0; i <= mask; i++)
+    {
+        slots[i].check.store(0, memory_order_relaxed);
+        slots[i].data.store(0, memory_order_relaxed);
+    }
+}
+
+// ----- search -----
+AlphaBeta::AlphaBeta(int tt_bits) : table(make_shared<TranspositionTable>(tt_bits))
+{
+    clear_heuristics();
+}
+
+AlphaBeta::AlphaBeta(shared_ptr<TranspositionTable> table, int thread_id) : table(table), thread_id(thread_id)
+{
+    clear_heuristics();
+}
+
+void AlphaBeta::clear()
+{
+    table->clear();
+    clear_heuristics();
+}
+
+void AlphaBeta::clear_heuristics()
+{
+    for (auto &ply_killers : killers)
+    {
+        ply_killers[0] = Move();
+        ply_killers[1] = Move();
+    }
+    memset(history, 0, sizeof(history));
+}
+
+int AlphaBeta::negamax(GameState &state, int depth, int ply, int alpha, int beta)
+{
+    nodes++;
+    // look at the clock every 1024 nodes
+    if ((timed && (nodes & 1023) == 0 && chrono::steady_clock::now() >= deadline) || (abort != nullptr && abort->load(memory_order_relaxed)))
+    {
+        stopped = true;
+    }
+    if (stopped)
+    {
+        return 0;
+    }
+    int player = state.get_current_player();
+    state.list_all_possible_moves(player);
+    // the game is decided the same way as in a real game
+    int terminal = state.TerminalState();
+    if (terminal != -1)
+    {
+        if (terminal == NOPLAYER)
+        {
+            return 0;
+        }
+        return terminal == player ? AB_WIN - ply : -(AB_WIN - ply);
+    }
+    if (depth <= 0 || ply >= AB_MAX_PLY - 1)
+    {
+        // a pending jump is played out; the moves listed above tell whether there is one
+        if (state.possible_moves[0].get_jump_type() && ply < AB_MAX_PLY - 1)
+        {
+            long long budget = quiescence_nodes;
+            int score = quiescence(state, ply, alpha, beta, budget);
+            nodes += quiescence_nodes - budget - 1;
+            return score;
+        }
+        return evaluate(state);
+    }
+
+    uint64_t key = state.hash();
+    TTEntry entry;
+    Move tt_move;
+    bool has_tt_move = false;
+    if (table->probe(key, entry))
+    {
+        if (entry.move != 0xFF)
+        {
+            tt_move = decode_move(entry.move, entry.jump);
+            has_tt_move = true;
+        }
+        // the root always searches, so that it has a move
+        if (ply > 0 && entry.depth >= depth)
+        {
+            int score = entry.score;
+            if (score > AB_WIN_BOUND)
+                score -= ply;
+            else if (score < -AB_WIN_BOUND)
+                score += ply;
+            if (entry.bound == AB_EXACT || (entry.bound == AB_LOWER && score >= beta) || (entry.bound == AB_UPPER && score <= alpha))
+            {
+                return score;
+            }
+        }
+    }
+
+    // order the moves: table move, captures and promotions, killers, history
+    vector<Move> moves = state.possible_moves;
+    vector<int> order(moves.size());
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        const Move &move = moves[i];
+        int from = move.get_src_y() * 8 + move.get_src_x();
+        int to = move.get_dest_y() * 8 + move.get_dest_x();
+        if (has_tt_move && same_move(move, tt_move))
+            order[i] = 1 << 30;
+        else if (move.get_jump_type() || is_promotion(state, move))
+            order[i] = (1 << 29) + (move.get_jump_type() ? 1 : 0);
+        else if (ply < AB_MAX_PLY && same_move(move, killers[ply][0]))
+            order[i] = (1 << 28) + 1;
+        else if (ply < AB_MAX_PLY && same_move(move, killers[ply][1]))
+            order[i] = 1 << 28;
+        else if (thread_id > 0)
+            // helpers break the ties of the history differently, so the threads do not all search the same tree
+            order[i] = history[from][to] * 8 + static_cast<int>(((from * 64 + to) * 2654435761u + thread_id * 40503u) >> 29);
+        else
+            order[i] = history[from][to] * 8;
+    }
+
+    int original_alpha = alpha;
+    int best_score = -AB_INFINITY;
+    Move best_move = moves[0];
+    for (size_t n = 0; n < moves.size(); n++)
+    {
+        // pick the best of the remaining moves (cutoffs usually come early, so a full sort is wasted)
+        size_t pick = n;
+        for (size_t i = n + 1; i < moves.size(); i++)
+        {
+            if (order[i] > order[pick])
+            {
+                pick = i;
+            }
+        }
+        swap(moves[n], moves[pick]);
+        swap(order[n], order[pick]);
+        Move move = moves[n];
+
+        GameState child = state.clone();
+        child.switch_player();
+        move.perform_move(child.get_board(), move);
+        int score = -negamax(child, depth - 1, ply + 1, -beta, -alpha);
+        if (stopped)
+        {
+            return 0;
+        }
+        if (score > best_score)
+        {
+            best_score = score;
+            best_move = move;
+            if (ply == 0)
+            {
+                root_move = move;
+            }
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+        if (alpha >= beta)
+        {
+            if (!move.get_jump_type())
+            {
+                if (!same_move(move, killers[ply][0]))
+                {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = move;
+                }
+                // capped, so the history never outranks the killer moves
+                int &count = history[move.get_src_y() * 8 + move.get_src_x()][move.get_dest_y() * 8 + move.get_dest_x()];
+                count = min(count + depth * depth, 1 << 24);
+            }
+            break;
+        }
+    }
+
+    // always replace: the newest search is the most useful for the next one
+    entry.depth = static_cast<int8_t>(min(depth, 127));
+    entry.bound = best_score <= original_alpha ? AB_UPPER : (best_score >= beta ? AB_LOWER : AB_EXACT);
+    int stored = best_score;
+    if (stored > AB_WIN_BOUND)
+        stored += ply;
+    else if (stored < -AB_WIN_BOUND)
+        stored -= ply;
+    entry.score = stored;
+    entry.move = encode_move(best_move);
+    entry.jump = best_move.get_jump_type() ? 1 : 0;
+    table->store(key, entry);
+    return best_score;
+}
+
+AlphaBetaResult AlphaBeta::search(const GameState &state, double seconds, int max_depth, const atomic<bool> *abort)
+{
+    this->abort = abort;
+    AlphaBetaResult result;
+    auto start = chrono::steady_clock::now();
+    timed = seconds > 0;
+    deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+    stopped = false;
+    nodes = 0;
+    // old history counts are worth less in the new position
+    for (auto &row : history)
+    {
+        for (int &count : row)
+        {
+            count /= 2;
+        }
+    }
+
+    GameState root = state.clone();
+    root.list_all_possible_moves(root.get_current_player());
+    if (root.possible_moves.empty())
+    {
+        return result;
+    }
+    result.found = true;
+    result.best = root.possible_moves[0];
+    // with a single legal move there is nothing to search; odd helpers of a parallel search start one ply deeper
+    int limit = min(max_depth + thread_id % 2, AB_MAX_PLY - 1);
+    for (int depth = 1 + thread_id % 2; root.possible_moves.size() > 1 && depth <= limit; depth++)
+    {
+        int score = negamax(root, depth, 0, -AB_INFINITY, AB_INFINITY);
+        if (stopped)
+        {
+            break;
+        }
+        result.best = root_move;
+        result.score = score;
+        result.depth = depth;
+        // a found win or loss does not change with more depth
+        if (abs(score) > AB_WIN_BOUND || (timed && chrono::steady_clock::now() >= deadline))
+        {
+            break;
+        }
+    }
+    result.nodes = nodes;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// ----- parallel search -----
+ParallelAlphaBeta::ParallelAlphaBeta(int num_threads, int tt_bits) : table(make_shared<TranspositionTable>(tt_bits))
+{
+    if (num_threads <= 0)
+    {
+        num_threads = max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back(new AlphaBeta(table, i));
+    }
+}
+
+LazySMPResult ParallelAlphaBeta::search(const GameState &state, double seconds, int max_depth)
+{
+    LazySMPResult result;
+    result.threads.resize(threads.size());
+    atomic<bool> done(false);
+    vector<thread> helpers;
+    for (size_t i = 1; i < threads.size(); i++)
+    {
+        helpers.emplace_back([&, i]()
+                             { result.threads[i] = threads[i]->search(state, seconds, max_depth, &done); });
+    }
+    // the main thread decides when the search ends; the helpers stop with it
+    result.threads[0] = threads[0]->search(state, seconds, max_depth);
+    done = true;
+    for (thread &helper : helpers)
+    {
+        helper.join();
+    }
+    result.best = result.threads[0];
+    result.best.nodes = 0;
+    for (const AlphaBetaResult &thread_result : result.threads)
+    {
+        if (thread_result.found && thread_result.depth > result.best.depth)
+        {
+            result.best.best = thread_result.best;
+            result.best.score = thread_result.score;
+            result.best.depth = thread_result.depth;
+        }
+        result.best.nodes += thread_result.nodes;
+    }
+    return result;
+}
+
+void ParallelAlphaBeta::clear()
+{
+    table->clear();
+    for (unique_ptr<AlphaBeta> &searcher : threads)
+    {
+        searcher->clear_heuristics();
+    }
+}
+
+string lazy_smp_summary(const LazySMPResult &result)
+{
+    ostringstream out;
+    out << "depth " << result.best.depth << ", " << result.best.nodes << " nodes in " << result.best.seconds << " s, " << result.threads.size()
+        << " thread(s):";
+    for (const AlphaBetaResult &thread_result : result.threads)
+    {
+        out << ' ' << static_cast<long long>(thread_result.seconds > 0 ? thread_result.nodes / thread_result.seconds : 0);
+    }
+    out << " nodes/s";
+    return out.str();
+}
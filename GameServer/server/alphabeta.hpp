@@ -0,0 +1,268 @@
+/**
+ * @file alphabeta.hpp
+ * @brief Iterative-deepening alpha-beta search, the second AI next to MCTS.
+ *
+ * Negamax with alpha-beta pruning on `GameState`/`Move`. The moves of a node are searched in this order:
+ * the move stored in the transposition table, captures and promotions, the two killer moves of the ply,
+ * then the rest by their history score. The search deepens one ply at a time until the time limit is reached;
+ * the best move of the last finished depth is played. At the end of the full-width search, pending captures are
+ * played out by a quiescence search, because a position in the middle of an exchange has a wrong static score.
+ *
+ * `ParallelAlphaBeta` runs the same search on several threads (Lazy SMP): the threads search with slightly
+ * different depths and move orders and only share the transposition table, which is lock-free.
+ */
+#ifndef ALPHABETA_HPP
+#define ALPHABETA_HPP
+
+#include "classes.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+/** @def AB_WIN
+ *  @brief Score of a won position; the plies to the win are subtracted, so faster wins score higher.
+ */
+#define AB_WIN 100000
+/** @def AB_INFINITY
+ *  @brief Bound of the search window; larger than any score.
+ */
+#define AB_INFINITY 1000000
+/** @def AB_MAX_PLY
+ *  @brief Maximum depth of the search in plies.
+ */
+#define AB_MAX_PLY 64
+/** @def AB_TT_BITS
+ *  @brief Default size of the transposition table: 2^AB_TT_BITS entries of 16 bytes.
+ */
+#define AB_TT_BITS 18
+/** @def AB_MOVE_SECONDS
+ *  @brief Time per move of the alpha-beta AI in a game.
+ */
+#define AB_MOVE_SECONDS 0.05
+/** @def AB_QS_NODES
+ *  @brief Node budget of one quiescence search; the positions after it is used up are scored statically.
+ */
+#define AB_QS_NODES 64
+/** @def AB_THREADS
+ *  @brief Threads of the parallel search of one server session; 0 for one per core.
+ *  Every session has its own search and table, and the sessions of a server run at the same time, so one per
+ *  core would put cores x sessions threads on the machine. Two threads still let the helper fill the table for
+ *  the main thread; the whole machine is only used when several games are played.
+ */
+#define AB_THREADS 2
+/** @def AB_MAN_VALUE
+ *  @brief Value of a man in the static evaluation.
+ */
+#define AB_MAN_VALUE 100
+/** @def AB_KING_VALUE
+ *  @brief Value of a king in the static evaluation.
+ */
+#define AB_KING_VALUE 150
+/** @def AB_ADVANCE_VALUE
+ *  @brief Bonus of a man for every row it has advanced towards promotion.
+ */
+#define AB_ADVANCE_VALUE 3
+
+/**
+ * @brief Static evaluation of a position: material, plus a bonus for men that advanced.
+ * @param state The position.
+ * @return The score from the point of view of the player to move (positive is good for them).
+ */
+int evaluate(GameState &state);
+
+/**
+ * @brief Scores a position after playing out its captures: as long as the player to move has a jump, they must take one,
+ * so the best capture is searched (only captures); a position without a jump is scored by `evaluate`.
+ * @param state The position.
+ * @param ply Distance to the root of the search, for the scores of wins.
+ * @param alpha Lower bound of the search window.
+ * @param beta Upper bound of the search window.
+ * @param budget Nodes the search may still visit; decreased by every node. When it reaches 0, the remaining positions
+ * are scored statically. Won positions are recognized before the budget is checked.
+ * @return The score from the point of view of the player to move.
+ * @note A position without jumps whose player has no other moves either is scored by `evaluate` as well.
+ */
+int quiescence(GameState &state, int ply, int alpha, int beta, long long &budget);
+
+/**
+ * @struct AlphaBetaResult
+ * @brief Result of a search.
+ */
+struct AlphaBetaResult
+{
+    bool found = false;  /**< False if the position has no moves. */
+    Move best;           /**< The best move of the last finished depth. */
+    int score = 0;       /**< Its score from the point of view of the player to move. */
+    int depth = 0;       /**< The last finished depth (0 if there was only one move). */
+    long long nodes = 0; /**< Nodes searched. */
+    double seconds = 0;  /**< Time of the search. */
+};
+
+/**
+ * @struct TTEntry
+ * @brief The search result of one position in the transposition table.
+ */
+struct TTEntry
+{
+    int32_t score = 0;   /**< Score, with wins relative to this node. */
+    int8_t depth = 0;    /**< Depth the score was searched to (at least 1). */
+    uint8_t bound = 0;   /**< AB_EXACT, AB_LOWER or AB_UPPER. */
+    uint8_t move = 0xFF; /**< Best move (`encode_move`), 0xFF for none. */
+    uint8_t jump = 0;    /**< 1 if the best move is a jump. */
+};
+
+/**
+ * @class TranspositionTable
+ * @brief Transposition table that any number of threads can read and write without a lock.
+ *
+ * An entry is one 64-bit word; the slot also stores the word xor the key of the position. A slot that another
+ * thread is writing at the same time holds the parts of two entries, which fail the check and are treated as a miss.
+ */
+class TranspositionTable
+{
+private:
+    /** @brief One slot: the entry and the entry xor its key. */
+    struct Slot
+    {
+        atomic<uint64_t> check; /**< Key xor data. */
+        atomic<uint64_t> data;  /**< The packed entry; 0 for an empty slot. */
+    };
+
+    unique_ptr<Slot[]> slots; /**< 2^bits slots. */
+    uint64_t mask;            /**< Number of slots - 1. */
+
+public:
+    /**
+     * @brief Creates an empty table.
+     * @param bits The table has 2^bits slots of 16 bytes.
+     */
+    explicit TranspositionTable(int bits = AB_TT_BITS);
+
+    /**
+     * @brief Looks up a position.
+     * @param key Hash of the position (`GameState::hash`).
+     * @param entry Receives the entry if it is found.
+     * @return true if the table has an entry for the position.
+     */
+    bool probe(uint64_t key, TTEntry &entry) const;
+
+    /** @brief Stores the entry of a position; it replaces the entry in its slot. */
+    void store(uint64_t key, const TTEntry &entry);
+
+    /** @brief Empties the table; no search may run at the same time. */
+    void clear();
+};
+
+/**
+ * @class AlphaBeta
+ * @brief Alpha-beta searcher; keeps its transposition table and history between searches, so one object
+ * should be used for all moves of a game (and by one thread at a time).
+ */
+class AlphaBeta
+{
+private:
+    shared_ptr<TranspositionTable> table;      /**< The transposition table; shared by the threads of a parallel search. */
+    int thread_id = 0;                         /**< Index in a parallel search; helpers (id > 0) vary their depth and move order. */
+    Move killers[AB_MAX_PLY][2];               /**< Two quiet moves per ply that caused a cutoff. */
+    int history[64][64];                       /**< Cutoffs of quiet moves by source and destination square. */
+    long long nodes = 0;                       /**< Nodes of the running search. */
+    chrono::steady_clock::time_point deadline; /**< End of the running search. */
+    bool timed = false;                        /**< True if the running search has a time limit. */
+    const atomic<bool> *abort = nullptr;       /**< Stops the running search when set (may be nullptr). */
+    long long quiescence_nodes = AB_QS_NODES;  /**< Node budget of the quiescence search at every leaf. */
+    bool stopped = false;                      /**< Set when the time is up; the running depth is thrown away. */
+    Move root_move;                            /**< Best move at the root of the running depth. */
+
+    /** @brief Searches `state` to `depth` plies; returns the score from the point of view of the player to move. */
+    int negamax(GameState &state, int depth, int ply, int alpha, int beta);
+
+public:
+    /**
+     * @brief Creates a searcher with its own transposition table.
+     * @param tt_bits The transposition table has 2^tt_bits entries.
+     */
+    explicit AlphaBeta(int tt_bits = AB_TT_BITS);
+
+    /**
+     * @brief Creates one thread of a parallel search.
+     * @param table The table of all threads.
+     * @param thread_id Index of the thread; 0 searches like a single searcher.
+     */
+    AlphaBeta(shared_ptr<TranspositionTable> table, int thread_id);
+
+    /**
+     * @brief Finds the best move of a position with iterative deepening.
+     * @param state The position; the player to move is `state.get_current_player()`.
+     * @param seconds Time limit; 0 for none (then `max_depth` ends the search).
+     * @param max_depth Deepest depth that is searched.
+     * @param abort If not nullptr, the search ends when it is set.
+     * @return The best move and the statistics of the search.
+     */
+    AlphaBetaResult search(const GameState &state, double seconds, int max_depth = AB_MAX_PLY - 1, const atomic<bool> *abort = nullptr);
+
+    /** @brief Forgets the transposition table, killer moves and history (e.g. before a new game). */
+    void clear();
+
+    /** @brief Forgets the killer moves and history, but not the (maybe shared) transposition table. */
+    void clear_heuristics();
+
+    /** @brief Sets the node budget of the quiescence search at every leaf (default AB_QS_NODES). */
+    void set_quiescence_nodes(long long nodes) { quiescence_nodes = nodes; }
+};
+
+/**
+ * @struct LazySMPResult
+ * @brief Result of a parallel search.
+ */
+struct LazySMPResult
+{
+    AlphaBetaResult best;            /**< The result of the thread that finished the deepest depth; `nodes` counts all threads. */
+    vector<AlphaBetaResult> threads; /**< The result of every thread, for its nodes per second. */
+};
+
+/**
+ * @class ParallelAlphaBeta
+ * @brief Lazy SMP: every thread runs the iterative-deepening search on the same position. Odd helper threads
+ * search one ply deeper and all helpers order the quiet moves a little differently, so they fill the shared
+ * transposition table with results the main thread uses instead of searching them again.
+ */
+class ParallelAlphaBeta
+{
+private:
+    shared_ptr<TranspositionTable> table;  /**< The table of all threads. */
+    vector<unique_ptr<AlphaBeta>> threads; /**< One searcher per thread; index 0 is the main thread. */
+
+public:
+    /**
+     * @brief Creates the searchers.
+     * @param num_threads Number of threads; 0 for one per core.
+     * @param tt_bits The shared transposition table has 2^tt_bits entries.
+     */
+    explicit ParallelAlphaBeta(int num_threads = AB_THREADS, int tt_bits = AB_TT_BITS);
+
+    /**
+     * @brief Searches a position on all threads; the calling thread is the main thread.
+     * @param state The position; the player to move is `state.get_current_player()`.
+     * @param seconds Time limit; 0 for none (then `max_depth` ends the search).
+     * @param max_depth Deepest depth the main thread searches.
+     * @return The best move and the statistics of every thread.
+     */
+    LazySMPResult search(const GameState &state, double seconds, int max_depth = AB_MAX_PLY - 1);
+
+    /** @brief Forgets the transposition table, killer moves and history (e.g. before a new game). */
+    void clear();
+
+    /** @brief Returns the number of threads. */
+    int num_threads() const { return static_cast<int>(threads.size()); }
+};
+
+/**
+ * @brief Formats the statistics of a parallel search, e.g. "depth 9, 2100000 nodes in 0.05 s, 4 thread(s): 520000 515000 530000 510000 nodes/s"
+ * (the nodes per second of every thread).
+ */
+string lazy_smp_summary(const LazySMPResult &result);
+
+#endif
@@ -0,0 +1,222 @@
+/**
+ * @file bitbase.hpp
+ * @brief Endgame bitbases: the exact result (win, loss or draw for the side to move) of every position with few pieces,
+ * computed by retrograde analysis and stored in one memory mapped file per material signature.
+ *
+ * A material signature is the number of men and kings of both players. The positions of a signature are indexed by
+ * placing the groups P1 men, P1 kings, P2 men, P2 kings one after the other on the 32 dark squares: every group is
+ * ranked as a combination of the squares the groups before it left free, and the index is the mixed radix number of
+ * these ranks, times 2 for the player to move. Positions with a man on its promotion row can not occur and are stored
+ * as draws.
+ *
+ * Layout of a table file `bitbase_<P1 men><P1 kings><P2 men><P2 kings>.bin` (all integers little endian):
+ * - header (BITBASE_HEADER_SIZE bytes): magic "MCBB", u16 version, u16 flags (0), u8[4] the material signature,
+ *   u32 0, u64 number of positions
+ * - 2 bits per position, four positions per byte starting with the low bits: BITBASE_DRAW, BITBASE_WIN or BITBASE_LOSS
+ * - u64 FNV-1a checksum of everything before it
+ *
+ * The results follow the rules of this engine: a player without pieces loses, and a player to move without a legal
+ * move loses if it is PLAYER2 and wins if it is PLAYER1 (see `GameState::TerminalState`). A position is a draw if
+ * neither side can force a win.
+ */
+#ifndef BITBASE_HPP
+#define BITBASE_HPP
+
+#include "classes.hpp"
+#include "tree_format.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+using namespace std;
+
+/** @def BITBASE_MAGIC
+ *  @brief First four bytes of a bitbase table file.
+ */
+#define BITBASE_MAGIC "MCBB"
+/** @def BITBASE_FORMAT_VERSION
+ *  @brief Version of the table format written by generate_bitbases.
+ */
+#define BITBASE_FORMAT_VERSION 1
+/** @def BITBASE_HEADER_SIZE
+ *  @brief Size of the header, i.e. the offset of the first position.
+ */
+#define BITBASE_HEADER_SIZE 24
+/** @def BITBASE_MAX_PIECES
+ *  @brief Largest number of pieces the indexing supports.
+ */
+#define BITBASE_MAX_PIECES 8
+/** @def BITBASE_DEFAULT_PIECES
+ *  @brief Default number of pieces `checkers_exec bitbase` generates tables for.
+ */
+#define BITBASE_DEFAULT_PIECES 4
+/** @def BITBASE_DIR
+ *  @brief Directory the engine loads its bitbases from.
+ */
+#define BITBASE_DIR "bitbases"
+/** @def BITBASE_DRAW
+ *  @brief Stored result: neither side can force a win.
+ */
+#define BITBASE_DRAW 0
+/** @def BITBASE_WIN
+ *  @brief Stored result: the side to move wins.
+ */
+#define BITBASE_WIN 1
+/** @def BITBASE_LOSS
+ *  @brief Stored result: the side to move loses.
+ */
+#define BITBASE_LOSS 2
+/** @def BITBASE_UNKNOWN
+ *  @brief Returned by a probe if there is no table for the position.
+ */
+#define BITBASE_UNKNOWN -1
+
+/**
+ * @struct Material
+ * @brief A material signature: the number of men and kings of each player.
+ */
+struct Material
+{
+    int men[2] = {0, 0};   /**< Men of PLAYER1 and PLAYER2. */
+    int kings[2] = {0, 0}; /**< Kings of PLAYER1 and PLAYER2. */
+
+    /** @brief Returns the number of pieces on the board. */
+    int total() const { return men[0] + kings[0] + men[1] + kings[1]; }
+
+    /** @brief Returns a key that identifies the signature, e.g. for a map. */
+    uint32_t key() const { return (men[0] << 12) | (kings[0] << 8) | (men[1] << 4) | kings[1]; }
+
+    /** @brief Returns the signature as four digits, e.g. "1011" for a P1 man against a P2 man and a P2 king. */
+    string name() const;
+};
+
+/**
+ * @brief Returns the material signature of a position.
+ * @param state The position.
+ */
+Material material_of(GameState &state);
+
+/**
+ * @brief Returns the number of positions of a material signature (both players to move).
+ * @param material The signature.
+ */
+uint64_t bitbase_num_positions(const Material &material);
+
+/**
+ * @brief Returns the index of a position in the table of its material signature.
+ * @param state The position.
+ * @param material The signature of the position (see `material_of`).
+ */
+uint64_t bitbase_index(GameState &state, const Material &material);
+
+/**
+ * @brief Sets up the position with the given index.
+ * @param material The material signature.
+ * @param index The index, below `bitbase_num_positions(material)`.
+ * @param state Receives the position; its possible moves are not generated.
+ * @return false if the index belongs to a position with a man on its promotion row.
+ */
+bool bitbase_position(const Material &material, uint64_t index, GameState &state);
+
+/**
+ * @class Bitbase
+ * @brief The mapped bitbase tables of a directory; positions are looked up by material signature and index.
+ */
+class Bitbase
+{
+private:
+    map<uint32_t, shared_ptr<MappedFile>> tables; /**< The table files by `Material::key`. */
+    int pieces = 0;                               /**< Most pieces of any table. */
+
+public:
+    /**
+     * @brief Maps every table file of a directory read only (see `MappedFile::open`).
+     * @param dir The directory.
+     * @throws runtime_error if a file of the directory is not a valid table.
+     * @return The bitbase or nullptr if the directory has no tables.
+     */
+    static shared_ptr<Bitbase> open(const string &dir);
+
+    /**
+     * @brief Adds one table file.
+     * @param file The whole file content.
+     * @throws runtime_error if the content is not a valid table.
+     */
+    void add_table(shared_ptr<MappedFile> file);
+
+    /** @brief Returns the number of tables. */
+    size_t num_tables() const { return tables.size(); }
+
+    /** @brief Returns the most pieces of any table; positions with more pieces are never found. */
+    int max_pieces() const { return pieces; }
+
+    /**
+     * @brief Looks up the result of a position.
+     * @param state The position.
+     * @return BITBASE_WIN, BITBASE_LOSS or BITBASE_DRAW for the player to move, or BITBASE_UNKNOWN if there is no table for it.
+     */
+    int probe(GameState &state) const;
+
+    /**
+     * @brief Looks up the result of a position by its index.
+     * @param material The material signature.
+     * @param index The index of the position (see `bitbase_index`).
+     * @return The stored result, or BITBASE_UNKNOWN if there is no table for the signature.
+     */
+    int probe_index(const Material &material, uint64_t index) const;
+
+    /**
+     * @brief Returns the winner of a position that is in a table.
+     * @param state The position.
+     * @param winner Receives PLAYER1, PLAYER2 or NOPLAYER for a draw.
+     * @return false if the position has too many pieces or there is no table for it.
+     */
+    bool winner(GameState &state, int &winner) const;
+};
+
+/**
+ * @brief Returns the bitbase the engine probes: the one set with `set_bitbase`, or else the tables in BITBASE_DIR,
+ * which are loaded on the first call.
+ * @return The bitbase or nullptr if there is none.
+ */
+const Bitbase *get_bitbase();
+
+/**
+ * @brief Replaces the bitbase the engine probes.
+ * @param bitbase The new bitbase; nullptr turns probing off.
+ */
+void set_bitbase(shared_ptr<Bitbase> bitbase);
+
+/**
+ * @struct BitbaseTableStats
+ * @brief Result of generating one table.
+ */
+struct BitbaseTableStats
+{
+    Material material;      /**< The material signature. */
+    uint64_t positions = 0; /**< Positions of the table, including the impossible ones. */
+    uint64_t wins = 0;      /**< Positions the side to move wins. */
+    uint64_t losses = 0;    /**< Positions the side to move loses. */
+    uint64_t draws = 0;     /**< Positions that are drawn. */
+    int passes = 0;         /**< Passes over the unresolved positions until nothing changed. */
+    double seconds = 0;     /**< Time it took. */
+};
+
+/**
+ * @brief Generates the tables of all material signatures with at most `max_pieces` pieces and writes them to `dir`.
+ * The signatures are solved smallest first, so every capture and promotion leads into a table that is already done.
+ * Each table is solved by passes over its unresolved positions, which are split between `threads` threads: a position
+ * is won if a move leads to a position lost for the opponent, and lost if every move leads to a position won for the
+ * opponent. The positions that are still unresolved when a pass changes nothing are draws.
+ * @param dir The output directory; it is created if it does not exist.
+ * @param max_pieces Most pieces of a table (at most BITBASE_MAX_PIECES).
+ * @param threads Number of threads (0 = one per core).
+ * @param on_table Called after every table.
+ * @throws runtime_error if a table can not be written.
+ * @return The statistics of all tables.
+ */
+vector<BitbaseTableStats> generate_bitbases(const string &dir, int max_pieces, int threads = 0,
+                                            const function<void(const BitbaseTableStats &)> &on_table = nullptr);
+
+#endif
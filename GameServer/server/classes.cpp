@@ -248,6 +248,44 @@ void GameState::list_all_possible_moves(int player)
     }
 }
 
+void GameState::list_all_captures(int player)
+{
+    possible_moves.clear();
+    int enemy = player == PLAYER1 ? PLAYER2 : PLAYER1;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            Piece *piece = board.get_Piece(y, x);
+            if (piece->get_id() != player)
+            {
+                continue;
+            }
+            for (int dy : {1, -1})
+            {
+                // men only jump forward: player 1 down the board, player 2 up
+                if (!piece->get_king() && dy != (player == PLAYER1 ? 1 : -1))
+                {
+                    continue;
+                }
+                for (int dx : {-1, 1})
+                {
+                    int enemy_y = y + dy, enemy_x = x + dx;
+                    int jump_y = y + 2 * dy, jump_x = x + 2 * dx;
+                    if (jump_y < 0 || jump_y > 7 || jump_x < 0 || jump_x > 7)
+                    {
+                        continue;
+                    }
+                    if (board.get_Piece(enemy_y, enemy_x)->get_id() == enemy && board.get_Piece(jump_y, jump_x)->is_empty())
+                    {
+                        possible_moves.push_back(Move(y, x, jump_y, jump_x, true, enemy_y, enemy_x));
+                    }
+                }
+            }
+        }
+    }
+}
+
 void GameState::list_possible_moves(int from_y, int from_x, int player)
 {
     bool jump = false;
@@ -379,6 +417,53 @@ string GameState::get_state_info()
     return s;
 }
 
+/**
+ * @brief Random keys for the Zobrist hash: one per square and piece kind, and one for player 2 to move.
+ * splitmix64 with a fixed seed, so the keys never change (opening books store the hashes).
+ */
+struct ZobristKeys
+{
+    uint64_t pieces[64][4]; // [square][(player - 1) * 2 + king]
+    uint64_t player2;
+    ZobristKeys()
+    {
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        auto next = [&seed]()
+        {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+        for (int square = 0; square < 64; square++)
+        {
+            for (int kind = 0; kind < 4; kind++)
+            {
+                pieces[square][kind] = next();
+            }
+        }
+        player2 = next();
+    }
+};
+
+uint64_t GameState::hash() const
+{
+    static const ZobristKeys keys;
+    uint64_t h = current_player == PLAYER2 ? keys.player2 : 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            Piece p = board.clone_Piece(y, x);
+            if (p.get_id() == PLAYER1 || p.get_id() == PLAYER2)
+            {
+                h ^= keys.pieces[y * 8 + x][(p.get_id() - 1) * 2 + (p.get_king() ? 1 : 0)];
+            }
+        }
+    }
+    return h;
+}
+
 void Move::perform_move(Board *b, Move mv)
 {
     // Get the piece which is being moved
@@ -435,9 +520,6 @@ double MCTS_leaf::cal_rating()
             double nk = static_cast<double>(total_games);
             // Use this node's win rate (vk = wins / total_games)
             double vk = static_cast<double>(wins) / nk;
-            // Exploration constant C (assuming it's defined elsewhere, e.g., as sqrt(2))
-            // If C is not defined, you need to define it. Example: const double C = sqrt(2.0);
-            const double C = sqrt(2.0); // Define C if not already defined globally/in scope
             double exploration_term = C * sqrt(log(np) / nk);
             rating = vk + exploration_term;
         }
@@ -485,141 +567,3 @@ void MCTS_leaf::save_leaf(ofstream &out)
     // save is_computer
     out << to_string(is_computer) << "]";
 }
-
-MCTS_leaf *load_leaf(string params, MCTS_leaf *parent)
-{
-    // the input string will be in the format:
-    // char t = 'r' or 'c'
-    // r/c[g/m[gamestate/move],wins,total_games,is_terminal,is_computer]
-    char type = params[0];  // this is to see if the char is a 'r' or 'c'
-    char type1 = params[2]; // this is to see if the char is a 'g' or 'm'
-
-    params.erase(0, 3); // erase the first 3 characters (r/g[ or c/m[)
-    if (type == 'c' && type1 == 'm' && parent != nullptr)
-    {
-        /* it will be in the format: "[...],wins,total_games,is_terminal,is_computer]" */
-        params.erase(0, 1); // erase the first bracket
-        // extract the values from the string
-        int src_y = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int src_x = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int dest_y = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int dest_x = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        bool jump = stoi(params.substr(0, params.find(','))) == 0 ? false : true;
-        params.erase(0, params.find(',') + 1);
-        int enemy_y = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int enemy_x = stoi(params.substr(0, params.find(']')));
-        params.erase(0, params.find(']') + 2); // erase the last bracket and comma
-        // create a new move object
-        Move new_move(src_y, src_x, dest_y, dest_x, jump, enemy_y, enemy_x);
-        /* now the format will be "wins,...,is_computer"*/
-        // get the wins
-        int tmp_wins = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int tmp_total_games = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        bool tmp_is_terminal = stoi(params.substr(0, params.find(','))) == 0 ? false : true;
-        params.erase(0, params.find(',') + 1); // param string should now be empty
-        bool tmp_is_computer = stoi(params.substr(0, params.find(']'))) == 0 ? false : true;
-        params.erase(0, params.find(']') + 1); // erase the last bracket
-
-        // clone gamestate from the parent
-        GameState tmp_state = parent->state.clone();
-        // switch the player
-        tmp_state.switch_player();
-        // perform the move
-        Board *tmp_board = tmp_state.get_board();
-        new_move.perform_move(tmp_board, new_move);
-
-        // create a new MCTS_leaf object and attach to tree
-        MCTS_leaf *new_leaf = new MCTS_leaf(tmp_state, new_move, parent, {}, tmp_wins, tmp_total_games, tmp_is_computer, tmp_is_terminal);
-        // set the parent of the new leaf
-        new_leaf->parent = parent;
-
-        return new_leaf; // caller function should add this leaf to the parent
-    }
-    else if (type == 'r' && type1 == 'g' && parent == nullptr)
-    {
-        /* it will be in the format: "b[p[...],p[...]],curr_player],wins,total_games,rating,is_terminal]" */
-        // get board (go until 'p')
-        params.erase(0, 3);  // erase the first 2 characters (b[)        // extract the board string
-        int tmp_counter = 1; // holds counter for bracket, so we can find mathcing bracket
-        int i = 0;           // index for the string
-        // parse until counter is 0
-        while (tmp_counter != 0)
-        {
-            if (params[i] == '[')
-            {
-                tmp_counter++;
-            }
-            else if (params[i] == ']')
-            {
-                tmp_counter--;
-            }
-            i++;
-        }
-        int board_end = i; // end of the board (includes the last bracket; "...]]")
-
-        string board_str = params.substr(0, board_end); // board_str will have the format p[...],...,p[...]]
-        // parse the board and create a new board object
-        array<array<Piece, 8>, 8> new_board_data;
-        for (int i = 0; i < 8; i++)
-        {
-            for (int j = 0; j < 8; j++)
-            {
-                // erease the first 2 characters (p[)
-                board_str.erase(0, 2);
-                /* Each piece will now have the format: "...],p[...],...,p[...]]" */
-                // get the player id
-                int player_id = stoi(board_str.substr(0, board_str.find(',')));
-                board_str.erase(0, board_str.find(',') + 1);
-                // get the y coordinate
-                int y = stoi(board_str.substr(0, board_str.find(',')));
-                board_str.erase(0, board_str.find(',') + 1);
-                // get the x coordinate
-                int x = stoi(board_str.substr(0, board_str.find(',')));
-                board_str.erase(0, board_str.find(',') + 1);
-                // get the is_king
-                bool is_king = stoi(board_str.substr(0, board_str.find(']'))) == 0 ? false : true;
-                board_str.erase(0, board_str.find(']') + 2);
-                // create a new piece object
-                Piece new_piece(player_id, y, x, is_king);
-                // set the piece in the new board
-                new_board_data[i][j] = new_piece;
-            }
-        }
-        // create a new board object
-        Board new_board_obj(new_board_data);
-
-        params.erase(0, board_end + 1);
-        /* now the string params reads "curr_player],wins,total_games,rating,is_terminal,is_computer]" */
-        int curr_player = stoi(params.substr(0, params.find(']')));
-        // create a new game state object
-        GameState new_game_state(new_board_obj, curr_player);
-
-        params.erase(0, params.find(']') + 2); // erease the last bracket and comma
-
-        /* now the string param reads "wins,...,is_terminal"*/
-        int tmp_wins = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        int tmp_total_games = stoi(params.substr(0, params.find(',')));
-        params.erase(0, params.find(',') + 1);
-        bool tmp_is_terminal = stoi(params.substr(0, params.find(','))) == 0 ? false : true;
-        params.erase(0, params.find(',') + 1); // param string should now be empty
-        bool tmp_is_computer = stoi(params.substr(0, params.find(']'))) == 0 ? false : true;
-        params.erase(0, params.find(']') + 1); // erase the last bracket
-
-        // create a new MCTS_leaf object return it
-        MCTS_leaf *new_leaf = new MCTS_leaf(new_game_state, Move(-1, -1, -1, -1, false, -1, -1), parent, {}, tmp_wins, tmp_total_games, tmp_is_computer, tmp_is_terminal);
-        return new_leaf; // caller function should add this leaf to the parent
-    }
-    else
-    {
-        throw runtime_error("Invalid input format for MCTS_leaf");
-        return nullptr;
-    }
-}
\ No newline at end of file
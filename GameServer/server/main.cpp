@@ -1,5 +1,16 @@
 #include "../request_helpers.hpp"
 
+#ifdef TESTING
+#include "tests.hpp"
+#define TEST()                    \
+    {                             \
+        printf("Testing mode\n"); \
+        return all_tests();       \
+    }
+#else
+#define TEST()
+#endif
+
 using namespace std;
 
 void thread_function(Player *);
@@ -14,6 +25,7 @@ mutex all_sessions_mutex;
 
 int main()
 {
+    TEST();
     print_banner();
     int sock = init_server_sock(); // initialize the server socket
     if (sock < 0)
@@ -21,6 +33,8 @@ int main()
         cerr << ERROR << "Error initializing server socket" << RESET << endl;
         return -1; // exit if socket initialization failed
     }
+    // load the tree that all AI sessions share once, before the first client connects
+    open_shared_tree();
 
     fd_set read_fds;   // file descriptor set for select
     struct timeval tv; // Struct to specify timeout
@@ -80,6 +94,12 @@ int main()
     }
     DEBUG_PRINT("All threads joined successfully\n");
 
+    // save the shared tree a last time and free it
+    close_shared_tree();
+    // wait for trees that are still being freed in the background
+    wait_for_background_destruction();
+    wait_for_background_compaction();
+
     // delete the player object after the thread is done
     {
         lock_guard<mutex> lock(all_players_mutex);
@@ -198,7 +218,7 @@ void thread_function(Player *player)
     /* ---------------- Send question single-player or multiplayer --------------------------*/
     DEBUG_PRINT("------------------ Asking client if they want to play against player or against AI -----------------\n");
     question = "Do you want to play against another player or against AI?";
-    options = {"Player", "AI"}; // options for the question
+    options = {"Player", "AI (MCTS)", "AI (alpha-beta)"}; // options for the question
     if (send_to(client_sock, "QUESTION", question_to_string(question, options)) < 0)
     {
         cerr << ERROR << "Error sending question to client: " << strerror(errno) << RESET << endl;
@@ -229,9 +249,9 @@ void thread_function(Player *player)
 
 #pragma region Put Player into Session
 
-    if (player->get_chosen_game_mode() == 1)
+    if (player->get_chosen_game_mode() == 1 || player->get_chosen_game_mode() == 2)
     {
-        // 1 means player chose to play against AI
+        // 1 and 2 mean player chose to play against AI (MCTS or alpha-beta)
         {
             lock_guard<mutex> lock(all_sessions_mutex);
             Session *new_session = new Session(player, nullptr); // create a new session with the player as player1
@@ -290,7 +310,7 @@ void thread_function(Player *player)
     /* ---------------- Start game thread --------------------------*/
     DEBUG_PRINT("------------------ Starting game thread -----------------\n");
     // The client chose to play against AI
-    if (player->get_chosen_game() == 0 && player->get_chosen_game_mode() == 1)
+    if (player->get_chosen_game() == 0 && (player->get_chosen_game_mode() == 1 || player->get_chosen_game_mode() == 2))
     {
         // The client should already be in a full session with the AI
         // Send the client a message that the game is starting
@@ -426,12 +446,24 @@ int gameplay_ai(Player *player)
     */
     int surrendered = -1;
 
+    // the searches of this session run on this thread, without the shared tree lock,
+    // so they draw from a generator of their own instead of the shared rand()
+    seed_thread_random(static_cast<unsigned int>(rand()));
+
     // send "GAME_START" to the client
 
 #pragma region Load MCTS Tree
-    // load the tree from file and reconstruct tree
-    MCTS_leaf *mcts_tree = load_or_create_mcts_tree();
+    // all AI sessions share one tree, which is loaded once; every access to its nodes holds shared_tree_mutex,
+    // but the searches run on session-local copies (train_shared), so they do not wait for each other
+    MCTS_leaf *mcts_tree = open_shared_tree();
 #pragma endregion
+    // game mode 2: the AI searches with alpha-beta on AB_THREADS threads; the tree only follows the game
+    bool use_alphabeta = player->get_chosen_game_mode() == 2;
+    unique_ptr<ParallelAlphaBeta> alphabeta;
+    if (use_alphabeta)
+    {
+        alphabeta.reset(new ParallelAlphaBeta(AB_THREADS));
+    }
     DEBUG_PRINT("MCTS tree loaded successfully\n");
 
 #pragma region Send which player they are
@@ -443,7 +475,7 @@ int gameplay_ai(Player *player)
     {
         cerr << ERROR << "Error sending player id to client: " << strerror(errno) << RESET << endl;
         close(player_socket);
-        return save_and_exit(mcts_tree);
+        return 0;
     }
 #pragma endregion
     DEBUG_PRINT("Player id sent to client successfully\n");
@@ -451,7 +483,10 @@ int gameplay_ai(Player *player)
 #pragma region Game Loop
     // Game loop
     MCTS_leaf *current_node = mcts_tree;
-    ptr_session->curr_state = current_node->state; // copy the session from the current node to the player session
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        ptr_session->curr_state = current_node->state; // copy the session from the current node to the player session
+    }
     int tmpres = -1;                               // variable to store the result of the send_to function
     bool want_to_play_on = true;                   // flag to check if the players want to play again
     while (want_to_play_on)
@@ -460,10 +495,19 @@ int gameplay_ai(Player *player)
         while (true)
         {
             DEBUG_PRINT("Inside game loop\n");
-            // populate possible moves for the current node
-            current_node->state.list_all_possible_moves(current_node->state.get_current_player());
-            // if current node is terminal, end the game
-            int terminal = current_node->state.TerminalState();
+            int terminal;
+            int node_player;
+            string gamestate_str;
+            {
+                lock_guard<mutex> lock(shared_tree_mutex);
+                // populate possible moves for the current node
+                current_node->state.list_all_possible_moves(current_node->state.get_current_player());
+                // if current node is terminal, end the game
+                terminal = current_node->state.TerminalState();
+                node_player = current_node->state.get_current_player();
+                // encode gamestate to string, so it can be sent without holding the lock
+                gamestate_str = current_node->state.get_state_info();
+            }
             if (terminal != -1)
             {
                 ptr_session->curr_state.get_board()->print_Board(); // print the board for debugging purposes
@@ -485,14 +529,17 @@ int gameplay_ai(Player *player)
                 if (answer1 == "Yes")
                 {
                     {
-                        // if player wants to play again, save the mcts tree to file
-                        save_and_exit(mcts_tree); // save the MCTS tree to file
-                        // restart the game
-                        DEBUG_PRINT("MCTS tree saved to file\n");
-                        // reset the game state
-                        ptr_session->curr_state = load_or_create_mcts_tree()->state; // reset the game state to the initial state
+                        // the shared tree stays in memory and is saved by the saver thread,
+                        // so the next game simply starts at its root again
+                        lock_guard<mutex> lock(shared_tree_mutex);
+                        current_node = mcts_tree;
+                        ptr_session->curr_state = current_node->state; // reset the game state to the initial state
                     }
                     ptr_session->current_player = player; // reset the current player to player1
+                    if (alphabeta)
+                    {
+                        alphabeta->clear();
+                    }
                     continue;                             // continue the game loop
                 }
                 else
@@ -503,15 +550,12 @@ int gameplay_ai(Player *player)
                 break; // exit the game loop
             }
             // Player's turn
-            if (current_node->state.get_current_player() == player->get_id())
+            if (node_player == player->get_id())
             {
                 sleep(1);    // sleep for 1 second to give the player time to read the message
                 tmpres = -1; // reset tmpres for the next send_to
 
                 /* ------------------- send gamestate (board and moves) ------------------- */
-                // encode gamestate to string
-                string gamestate_str = current_node->state.get_state_info();
-                string board_str = current_node->state.get_board()->get_board_info();
                 while (tmpres == -1)
                 {
                     tmpres = send_to(player->get_socket(), "CHECKERS_STATE", gamestate_str);
@@ -525,72 +569,65 @@ int gameplay_ai(Player *player)
                 {
                     send_to(player->get_socket(), "GOODBYE", "oooooooooooooooooooooo\n");
                     DEBUG_PRINT("Player requested to quit the game\n");
-                    return save_and_exit(mcts_tree);
+                    return 0;
                 }
                 /* ------------------- perform move on the gamestate ------------------- */
-                // perform the move by searching the children of the current node and finding the one that matches the move
-                string selected_move_str = ptr_session->prev_move.get_move_info();
-                // select a move that has not been explored yet
-                // load all of the children into a set
-                map<string, MCTS_leaf *> moves_children;
-                for (MCTS_leaf *child : current_node->children)
+                // select the child with this move, or create it if the AI has not explored the move yet
+                bool new_node;
+                current_node = play_player_move(current_node, ptr_session->prev_move, new_node);
                 {
-                    moves_children.insert({child->get_move_info(), child});
-                }
-                // check if this move has already been explored by the AI
-                bool found = false;
-                for (Move move : current_node->state.possible_moves)
-                {
-                    // map.find() returns an iterator to the element if found, or end() if not found
-                    auto it = moves_children.find(selected_move_str);
-                    if (it != moves_children.end())
-                    {
-                        // if the child move matches, we can select it
-                        found = true;
-                        current_node = it->second;
-                        break;
-                    }
+                    lock_guard<mutex> lock(shared_tree_mutex);
+                    ptr_session->curr_state = current_node->state; // copy the session from the current node to the player session
                 }
-                if (!found)
+                if (new_node)
                 {
-                    Move selected_move = ptr_session->prev_move; // get the move from the session
-                    // if the AI has not explored this move yet, we need to create a new child node
-                    // create a new game state with the selected move
-                    GameState new_game_state = current_node->state.clone();
-                    // change the player of the new game state
-                    new_game_state.switch_player();
-                    // perform move
-                    Board *tmp_board = new_game_state.get_board();
-                    selected_move.perform_move(tmp_board, selected_move);
-                    // populate the possible moves of the new game state
-                    new_game_state.list_all_possible_moves(new_game_state.get_current_player());
-                    // create a new child node with the new game state and add to the tree
-                    MCTS_leaf *new_child = new MCTS_leaf(new_game_state, selected_move, current_node);
-                    current_node->children.push_back(new_child);
-                    current_node = new_child;
-                    // update the session with the new game state
-                    ptr_session->curr_state = current_node->state; // copy the session from the current node to the player session
-
-                    // train the AI on this new node
-                    train(current_node, 20);
+                    // train the AI on this new node, without holding the lock
+                    train_shared(current_node, get_search_params().reply_iterations, get_search_params());
                 }
             }
             else
             {
                 // AI's turn
                 DEBUG_PRINT("AI's turn!\n");
+                if (use_alphabeta)
+                {
+                    LazySMPResult result;
+                    current_node = play_alphabeta_move(current_node, *alphabeta, AB_MOVE_SECONDS, result);
+                    cout << INFO << "alpha-beta: " << lazy_smp_summary(result) << RESET << endl;
+                    lock_guard<mutex> lock(shared_tree_mutex);
+                    ptr_session->curr_state = current_node->state; // copy the session from the new node to the player session
+                    continue;
+                }
+                const OpeningBook *book = get_opening_book();
                 // AI will play
-                // select the best move from the MCTS tree
-                MCTS_leaf *newnode = select_most_visited_child(current_node);
+                // in the opening, the move is taken from the book without searching
+                Move book_move;
+                MCTS_leaf *newnode;
+                {
+                    lock_guard<mutex> lock(shared_tree_mutex);
+                    if (book != nullptr && book->best_move(current_node->state, book_move))
+                    {
+                        newnode = find_or_add_child(current_node, book_move);
+                    }
+                    else
+                    {
+                        // select the best move from the MCTS tree
+                        newnode = select_most_visited_child(current_node);
+                    }
+                }
                 // if newnode is current_node
                 if (newnode == current_node)
                 {
                     // we are not at the terminal state,
                     // which means the AI has not expolred this part of the tree yet.
-                    // so we need to expand the tree by training the ai
-                    train(newnode, 30);
+                    // so we need to expand the tree by training the ai, without holding the lock
+                    train_shared(current_node, get_search_params().move_iterations, get_search_params());
+                }
+                lock_guard<mutex> lock(shared_tree_mutex);
+                if (newnode == current_node)
+                {
                     // select the best child of the new node
-                    newnode = select_most_visited_child(newnode);
+                    newnode = select_most_visited_child(current_node);
                 }
                 current_node = newnode;
                 // update the game session
@@ -600,7 +637,8 @@ int gameplay_ai(Player *player)
     }
 #pragma endregion
 
-    return save_and_exit(mcts_tree);
+    // the tree is not saved here; the saver thread writes the changes of all sessions
+    return 0;
 }
 #pragma endregion
 
@@ -1,10 +1,99 @@
 #include "mcts_algorithm.hpp"
+#include "tree_format.hpp"
+#include "alphabeta.hpp"
+#include "bitbase.hpp"
+#include <fcntl.h>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
 
 using namespace std;
-mutex file_save_mutex; // mutex to protect file operations
+
+// state of the random number generator of this thread; 0 if the thread uses rand()
+thread_local uint32_t thread_random_state = 0;
+
+void seed_thread_random(unsigned int seed)
+{
+    // xorshift must not start at 0
+    thread_random_state = seed != 0 ? seed : 0x9E3779B9u;
+}
+
+/** @brief Returns a random number in [0, RAND_MAX] from the generator of this thread, or rand() if it has none. */
+static inline int mcts_random()
+{
+    if (thread_random_state == 0)
+    {
+        return rand();
+    }
+    // xorshift32
+    thread_random_state ^= thread_random_state << 13;
+    thread_random_state ^= thread_random_state >> 17;
+    thread_random_state ^= thread_random_state << 5;
+    return static_cast<int>(thread_random_state % (static_cast<uint32_t>(RAND_MAX) + 1));
+}
+
+// parameters of the train() call running on this thread; nullptr outside of train()
+thread_local const SearchParams *active_search_params = nullptr;
+
+/** @brief Returns the parameters of the running train() call, or the defaults outside of it. */
+static const SearchParams &search_params()
+{
+    static const SearchParams defaults;
+    return active_search_params != nullptr ? *active_search_params : defaults;
+}
+
+bool read_search_params(const string &path, SearchParams &params)
+{
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    string line;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string key;
+        if (!(fields >> key) || key[0] == '#')
+        {
+            continue;
+        }
+        string value;
+        fields >> value;
+        try
+        {
+            if (key == "c")
+                params.c = stod(value);
+            else if (key == "rollout" && value == "random")
+                params.rollout = ROLLOUT_RANDOM;
+            else if (key == "rollout" && value == "promote")
+                params.rollout = ROLLOUT_PROMOTE;
+            else if (key == "rollout_cutoff")
+                params.rollout_cutoff = stoi(value);
+            else if (key == "reply_iterations")
+                params.reply_iterations = stoi(value);
+            else if (key == "move_iterations")
+                params.move_iterations = stoi(value);
+            else if (key == "new_tree_iterations")
+                params.new_tree_iterations = stoi(value);
+            else
+                throw invalid_argument(key);
+        }
+        catch (const logic_error &)
+        {
+            // stoi and stod throw invalid_argument or out_of_range
+            throw runtime_error("Invalid line in " + path + ": " + line);
+        }
+    }
+    return true;
+}
 
 MCTS_leaf *select_most_visited_child(MCTS_leaf *root_node)
 {
+    if (root_node != nullptr)
+    {
+        ensure_children(root_node);
+    }
     if (root_node == nullptr || root_node->children.empty())
     {
         return root_node; // Return node itself if null or no children
@@ -25,31 +114,129 @@ MCTS_leaf *select_most_visited_child(MCTS_leaf *root_node)
     return most_visited_child; // Return the child with the most visits
 }
 
+// visit counts below this use the lookup tables in select_best_child
+#define UCB_TABLE_SIZE 4096
+
+/**
+ * @brief Lookup tables for 1/n and 1/sqrt(n) with n < UCB_TABLE_SIZE.
+ * Built once on first use; index 0 is never read because unvisited children are handled separately.
+ */
+struct UCB_tables
+{
+    double inv[UCB_TABLE_SIZE];
+    double inv_sqrt[UCB_TABLE_SIZE];
+    UCB_tables()
+    {
+        inv[0] = 0;
+        inv_sqrt[0] = 0;
+        for (int n = 1; n < UCB_TABLE_SIZE; n++)
+        {
+            inv[n] = 1.0 / n;
+            inv_sqrt[n] = 1.0 / sqrt(static_cast<double>(n));
+        }
+    }
+};
+
+MCTS_leaf *find_or_add_child(MCTS_leaf *node, const Move &move)
+{
+    ensure_children(node);
+    Move new_move = move;
+    string move_info = new_move.get_move_info();
+    for (MCTS_leaf *child : node->children)
+    {
+        if (child->get_move_info() == move_info)
+        {
+            return child;
+        }
+    }
+    GameState new_game_state = node->state.clone();
+    new_game_state.switch_player();
+    new_move.perform_move(new_game_state.get_board(), new_move);
+    new_game_state.list_all_possible_moves(new_game_state.get_current_player());
+    MCTS_leaf *new_child = new MCTS_leaf(new_game_state, new_move, node);
+    node->children.push_back(new_child);
+    return new_child;
+}
+
 MCTS_leaf *select_best_child(MCTS_leaf *root_node)
 {
+    if (root_node != nullptr)
+    {
+        ensure_children(root_node);
+    }
     if (root_node == nullptr || root_node->children.size() == 0)
     {
         return root_node;
     }
-    // maximize for the current player, so we need to check the current player
-    int current_player = root_node->state.get_current_player(); // get the current player
-    MCTS_leaf *best_child = nullptr;                            // initialize best child
+    static const UCB_tables tables;
+    // per-thread scratch buffers, so the statistics of all children are contiguous
+    thread_local vector<double> wins_buf, inv_buf, inv_sqrt_buf, rating_buf;
 
-    // check all children and select the one with the highest UCB value
-    double max_rating = -1;                      // initialize max rating
-    for (MCTS_leaf *child : root_node->children) // loop through all children
+    size_t num_children = root_node->children.size();
+    // an unvisited parent means all children are unvisited; unvisited children are rated infinity
+    // and the first one of them is picked (same as cal_rating())
+    if (root_node->total_games <= 0)
     {
-        double calculated_rating = child->cal_rating(); // calculate the rating of the child
-        // check if the rating is greater than the max rating
-        if (calculated_rating > max_rating)
+        return root_node->children[0];
+    }
+    wins_buf.resize(num_children);
+    inv_buf.resize(num_children);
+    inv_sqrt_buf.resize(num_children);
+    rating_buf.resize(num_children);
+
+    // gather the statistics of the children into the buffers
+    for (size_t i = 0; i < num_children; i++)
+    {
+        MCTS_leaf *child = root_node->children[i];
+        int nk = child->total_games;
+        if (nk == 0)
         {
-            max_rating = calculated_rating;
-            best_child = child;
+            // rated infinity, nothing can beat it
+            return child;
         }
+        wins_buf[i] = static_cast<double>(child->wins);
+        if (nk < UCB_TABLE_SIZE)
+        {
+            inv_buf[i] = tables.inv[nk];
+            inv_sqrt_buf[i] = tables.inv_sqrt[nk];
+        }
+        else
+        {
+            inv_buf[i] = 1.0 / nk;
+            inv_sqrt_buf[i] = 1.0 / sqrt(static_cast<double>(nk));
+        }
+    }
+
+    // UCB1: wins/nk + C * sqrt(log(np) / nk) = wins * (1/nk) + (C * sqrt(log(np))) * (1/sqrt(nk))
+    // the log only depends on the parent, so it is computed once per node instead of once per child
+    const double exploration = search_params().c * sqrt(log(static_cast<double>(root_node->total_games)));
+    const double *wins = wins_buf.data();
+    const double *inv = inv_buf.data();
+    const double *inv_sqrt = inv_sqrt_buf.data();
+    double *rating = rating_buf.data();
+    // branch-free loop over contiguous arrays, so the compiler can vectorize it
+    for (size_t i = 0; i < num_children; i++)
+    {
+        rating[i] = wins[i] * inv[i] + exploration * inv_sqrt[i];
     }
-    // root_node = best_child;
 
-    return best_child;
+    // pick the first child with the highest rating
+    size_t best_index = 0;
+    for (size_t i = 1; i < num_children; i++)
+    {
+        if (rating[i] > rating[best_index])
+        {
+            best_index = i;
+        }
+    }
+    return root_node->children[best_index];
+}
+
+/** @brief Returns true if the endgame bitbase has the exact result of `state`; `winner` receives it. */
+static bool bitbase_winner(GameState &state, int &winner)
+{
+    const Bitbase *bitbase = get_bitbase();
+    return bitbase != nullptr && bitbase->winner(state, winner);
 }
 
 MCTS_leaf *selection(MCTS_leaf *root)
@@ -58,13 +245,30 @@ MCTS_leaf *selection(MCTS_leaf *root)
         return nullptr;
     // iterative implementation
     MCTS_leaf *current_node = root;
+    ensure_children(current_node); // children still in a mapped file
     while (current_node->num_children() > 0)
     {
+        // nodes loaded from a file do not have their moves generated yet
+        if (current_node->state.possible_moves.empty())
+        {
+            current_node->state.list_all_possible_moves(current_node->state.get_current_player());
+        }
         if (current_node->state.TerminalState() != -1)
         {
             // if the game is over, break
             break;
         }
+        // below a position the bitbase has solved there is nothing to learn; simulation() returns its result
+        int winner;
+        if (current_node != root && bitbase_winner(current_node->state, winner))
+        {
+            break;
+        }
+        // stop at nodes that still have unexplored moves, so expansion() can add one of them
+        if (current_node->num_children() < current_node->state.num_possible_moves())
+        {
+            break;
+        }
         // select the best child
         MCTS_leaf *nextnode = select_best_child(current_node);
         if (nextnode == nullptr || nextnode == current_node)
@@ -74,12 +278,14 @@ MCTS_leaf *selection(MCTS_leaf *root)
             break;
         }
         current_node = nextnode;
+        ensure_children(current_node);
     }
     return current_node;
 }
 
 MCTS_leaf *expansion(MCTS_leaf *root_node)
 {
+    ensure_children(root_node);
     // generate list of possible moves just to be sure
     root_node->state.list_all_possible_moves(root_node->state.get_current_player());
     // check if there are any possible moves
@@ -95,7 +301,7 @@ MCTS_leaf *expansion(MCTS_leaf *root_node)
     {
         // we haven't explored any of the children yet,
         // so we select a random move from the possible moves
-        int random_move_index = rand() % num_moves;
+        int random_move_index = mcts_random() % num_moves;
         new_move = root_node->state.possible_moves.at(random_move_index);
     }
     else
@@ -141,18 +347,67 @@ MCTS_leaf *expansion(MCTS_leaf *root_node)
     return new_child;
 }
 
+/** @brief Returns the index of the first move in `state` that crowns a king, or -1 if there is none. */
+static int find_promoting_move(GameState &state)
+{
+    int player = state.get_current_player();
+    int last_row = player == PLAYER1 ? 7 : 0;
+    for (size_t i = 0; i < state.possible_moves.size(); i++)
+    {
+        const Move &move = state.possible_moves[i];
+        if (move.get_dest_y() == last_row && !state.get_board()->get_Piece(move.get_src_y(), move.get_src_x())->get_king())
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the player who is ahead when a rollout is cut off, or NOPLAYER if it is even.
+ * A pending exchange is played out first (jumps are mandatory), so the position is not scored in the middle of it.
+ */
+static int cutoff_winner(GameState &state)
+{
+    long long budget = AB_QS_NODES;
+    int score = quiescence(state, 0, -AB_INFINITY, AB_INFINITY, budget);
+    if (score == 0)
+    {
+        return NOPLAYER;
+    }
+    int player = state.get_current_player();
+    return score > 0 ? player : (player == PLAYER1 ? PLAYER2 : PLAYER1);
+}
+
 int simulation(MCTS_leaf *leaf_node)
 {
+    const SearchParams &params = search_params();
+    int plies = 0;
     // initialize a temporary game state
     GameState tmp_game_state = leaf_node->state.clone();
     // // change the player of the new game state
     // tmp_game_state.switch_player();
+    // clone() does not copy the possible moves, and TerminalState() needs them;
+    // without this every rollout ended before the first move
+    tmp_game_state.list_all_possible_moves(tmp_game_state.get_current_player());
     // status of the game
     int status = tmp_game_state.TerminalState();
     // while the game is not over, keep playing by executing random moves until the game is over
     // each state is not saved on the tree
     while (status == -1)
     {
+        // with few pieces left the bitbase knows the exact result, so the rest of the rollout is not played
+        int winner;
+        if (bitbase_winner(tmp_game_state, winner))
+        {
+            return winner;
+        }
+        if (params.rollout_cutoff > 0 && plies >= params.rollout_cutoff)
+        {
+            // stop the rollout and score it by material, after the captures
+            return cutoff_winner(tmp_game_state);
+        }
+        plies++;
         // list all possible moves of the leaf node
         tmp_game_state.list_all_possible_moves(tmp_game_state.get_current_player());
         // check if there are any possible moves
@@ -161,8 +416,12 @@ int simulation(MCTS_leaf *leaf_node)
         // create a new board and perform a random move on that
         if (num_moves > 0)
         {
-            // select a random move from the possible moves
-            int random_move_index = rand() % num_moves;
+            // select a random move from the possible moves (or a promotion, if the policy prefers them)
+            int random_move_index = params.rollout == ROLLOUT_PROMOTE ? find_promoting_move(tmp_game_state) : -1;
+            if (random_move_index < 0)
+            {
+                random_move_index = mcts_random() % num_moves;
+            }
             Move random_move = tmp_game_state.possible_moves.at(random_move_index);
             // DEBUG_PRINT("while simulating: chose random move: ");
             // random_move.print_move();
@@ -196,6 +455,7 @@ void backpropagation(MCTS_leaf *leaf_node, int result)
     {
         // update the total games and wins
         current_node->total_games++;
+        current_node->dirty = true; // for the journal
         int player_who_moved = (current_node->state.get_current_player() == PLAYER1) ? PLAYER2 : PLAYER1;
 
         if (player_who_moved == result)
@@ -211,8 +471,11 @@ void backpropagation(MCTS_leaf *leaf_node, int result)
     }
 }
 
-void train(MCTS_leaf *root_node, int num_iterations)
+void train(MCTS_leaf *root_node, int num_iterations, const SearchParams &params)
 {
+    // select_best_child() and simulation() read the parameters from here
+    const SearchParams *outer_params = active_search_params;
+    active_search_params = &params;
     // run the MCTS algorithm for num_iterations
     for (int i = 0; i < num_iterations; i++)
     {
@@ -223,7 +486,9 @@ void train(MCTS_leaf *root_node, int num_iterations)
             selected_node = root_node;
         }
         // expand selected node
-        MCTS_leaf *expanded_node = expansion(selected_node);
+        // a solved position (see selection()) is not expanded; it is scored by simulation() directly
+        int solved_winner;
+        MCTS_leaf *expanded_node = selected_node != root_node && bitbase_winner(selected_node->state, solved_winner) ? nullptr : expansion(selected_node);
         // if expanded_node is null, we have explored all children
         // and do not need to simulate any more
         if (expanded_node != nullptr)
@@ -243,10 +508,121 @@ void train(MCTS_leaf *root_node, int num_iterations)
         // // update the rating of all of the nodes in the tree
         // update_rating(root_node);
     }
+    active_search_params = outer_params;
     return;
 }
 
-void save_tree(MCTS_leaf *root_node, ofstream &out)
+// size of the buffer used by save_tree; it is written out whenever less than a node's worth is left
+#define SAVE_BUFFER_SIZE (1 << 16)
+#define SAVE_MAX_NODE_SIZE 2048 // the root node (64 pieces) is the longest, about 1.2 KB
+
+/**
+ * @brief Output buffer for save_tree; numbers are formatted in place with to_chars.
+ */
+struct TextWriter
+{
+    ostream &out;
+    vector<char> buf;
+    size_t len = 0;
+
+    TextWriter(ostream &o) : out(o), buf(SAVE_BUFFER_SIZE) {}
+
+    void flush()
+    {
+        out.write(buf.data(), len);
+        len = 0;
+    }
+
+    /** @brief Makes room for one more node. */
+    void reserve_node()
+    {
+        if (len + SAVE_MAX_NODE_SIZE > buf.size())
+        {
+            flush();
+        }
+    }
+
+    void put(char c) { buf[len++] = c; }
+
+    void put(const char *s, size_t n)
+    {
+        memcpy(buf.data() + len, s, n);
+        len += n;
+    }
+
+    void put_int(int value)
+    {
+        len = to_chars(buf.data() + len, buf.data() + buf.size(), value).ptr - buf.data();
+    }
+};
+
+/**
+ * @brief Writes one node exactly like MCTS_leaf::save_leaf does.
+ */
+static void write_leaf(TextWriter &w, MCTS_leaf *node)
+{
+    w.reserve_node();
+    if (node->parent == nullptr)
+    {
+        // r[g[b[p[id, y, x, king],...],current_player],
+        w.put("r[g[b[", 6);
+        Board *board = node->state.get_board();
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                if (y > 0 || x > 0)
+                {
+                    w.put(',');
+                }
+                const Piece &p = board->get_modifiable_piece(y, x);
+                w.put("p[", 2);
+                w.put_int(p.get_id());
+                w.put(", ", 2);
+                w.put_int(p.get_y());
+                w.put(", ", 2);
+                w.put_int(p.get_x());
+                w.put(", ", 2);
+                w.put(p.get_king() ? '1' : '0');
+                w.put(']');
+            }
+        }
+        w.put("],", 2);
+        w.put_int(node->state.get_current_player());
+        w.put("],", 2);
+    }
+    else
+    {
+        // c[m[src_y,src_x,dest_y,dest_x,jump,enemy_y,enemy_x],
+        Move mv = node->get_move();
+        w.put("c[m[", 4);
+        w.put_int(mv.get_src_y());
+        w.put(',');
+        w.put_int(mv.get_src_x());
+        w.put(',');
+        w.put_int(mv.get_dest_y());
+        w.put(',');
+        w.put_int(mv.get_dest_x());
+        w.put(',');
+        w.put(mv.get_jump_type() ? '1' : '0');
+        w.put(',');
+        w.put_int(mv.get_enemy_y());
+        w.put(',');
+        w.put_int(mv.get_enemy_x());
+        w.put("],", 2);
+    }
+    // wins,total_games,is_terminal,is_computer]
+    w.put_int(node->wins);
+    w.put(',');
+    w.put_int(node->total_games);
+    w.put(',');
+    w.put(node->get_is_terminal() ? '1' : '0');
+    w.put(',');
+    w.put(node->get_is_computer() ? '1' : '0');
+    w.put(']');
+}
+
+void save_tree(MCTS_leaf *root_node, ostream &out, SavePruning *pruning)
 {
     // save the tree
     if (root_node == nullptr)
@@ -254,101 +630,275 @@ void save_tree(MCTS_leaf *root_node, ofstream &out)
         out << "#";
         return;
     }
-    root_node->save_leaf(out);
-    for (MCTS_leaf *child : root_node->children)
+    TextWriter w(out);
+    // preorder with an explicit stack of (node, index of the next child to write);
+    // a node's "$" is written once all of its children are done
+    vector<pair<MCTS_leaf *, size_t>> stack;
+    uint64_t nodes_written = 1;
+    uint64_t nodes_dropped = 0;
+    ensure_children(root_node);
+    write_leaf(w, root_node);
+    stack.push_back({root_node, 0});
+    while (!stack.empty())
     {
-        save_tree(child, out);
+        MCTS_leaf *node = stack.back().first;
+        size_t next = stack.back().second++;
+        if (next == node->children.size())
+        {
+            w.reserve_node();
+            w.put('$');
+            stack.pop_back();
+            continue;
+        }
+        MCTS_leaf *child = node->children[next];
+        if (child == nullptr)
+        {
+            w.reserve_node();
+            w.put('#');
+            continue;
+        }
+        // the stack holds the path from the root, so the child is stack.size() plies below it
+        if (pruning != nullptr && !pruning->keep(child->total_games, static_cast<int>(stack.size())))
+        {
+            nodes_dropped += count_tree_nodes(child);
+            continue;
+        }
+        ensure_children(child);
+        write_leaf(w, child);
+        nodes_written++;
+        stack.push_back({child, 0});
+    }
+    w.flush();
+    if (pruning != nullptr)
+    {
+        pruning->nodes_written = nodes_written;
+        pruning->nodes_dropped = nodes_dropped;
     }
-    out << "$";
-    return;
 }
 
-MCTS_leaf *load_tree_helper(MCTS_leaf *root_node, string &full_input)
+/**
+ * @brief Cursor over the text tree format.
+ * Every character is looked at once, numbers are read in place with from_chars.
+ */
+struct TextCursor
 {
-    // check for null_pointers
-    if (full_input[0] == '#')
+    string_view input;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const string &what) const
     {
-        full_input.erase(0, 1);
-        return nullptr;
+        throw runtime_error(what + " at position " + to_string(pos) + ".");
     }
-    // check for end of child list -- this would be an error
-    if (full_input[0] == '$')
+
+    char peek() const
     {
-        throw runtime_error("Unexpected $ found.");
+        if (pos >= input.size())
+        {
+            fail("Unexpected end of tree");
+        }
+        return input[pos];
     }
-    // verify beginning of string
-    size_t bracket_start = full_input.find('[');
-    if ((full_input[0] != 'r' && full_input[0] != 'c') || bracket_start == string::npos)
+
+    void expect(char c)
     {
-        throw runtime_error("Unexpected character found. Expected r[ or c[.");
+        if (peek() != c)
+        {
+            fail(string("Expected '") + c + "'");
+        }
+        pos++;
     }
 
-    // find matching end bracket
-    int tmp_counter = 1; // holds counter for bracket, so we can find matching bracket
-    size_t bracket_end = string::npos;
-    for (int i = bracket_start + 1; i < full_input.length(); i++)
+    int read_int()
     {
-        if (full_input[i] == '[')
+        // Piece::info_to_file writes ", " between the fields
+        while (pos < input.size() && input[pos] == ' ')
         {
-            tmp_counter++;
+            pos++;
         }
-        else if (full_input[i] == ']')
+        int value = 0;
+        auto result = from_chars(input.data() + pos, input.data() + input.size(), value);
+        if (result.ec != errc())
         {
-            tmp_counter--;
+            fail("Expected a number");
         }
-        if (tmp_counter == 0)
+        pos = result.ptr - input.data();
+        return value;
+    }
+
+    /** @brief Reads "wins,total_games,is_terminal,is_computer]", the end of every node. */
+    void read_stats(int &wins, int &total_games, bool &is_terminal, bool &is_computer)
+    {
+        wins = read_int();
+        expect(',');
+        total_games = read_int();
+        expect(',');
+        is_terminal = read_int() != 0;
+        expect(',');
+        is_computer = read_int() != 0;
+        expect(']');
+    }
+};
+
+/**
+ * @brief Parses one node ("r[g...]" or "c[m...]", see MCTS_leaf::save_leaf) at the cursor.
+ * @param parent nullptr for the root node.
+ */
+static MCTS_leaf *parse_leaf(TextCursor &cur, MCTS_leaf *parent)
+{
+    int wins, total_games;
+    bool is_terminal, is_computer;
+    char type = cur.peek();
+    if (type == 'c' && parent != nullptr)
+    {
+        // c[m[src_y,src_x,dest_y,dest_x,jump,enemy_y,enemy_x],wins,total_games,is_terminal,is_computer]
+        cur.pos++;
+        cur.expect('[');
+        cur.expect('m');
+        cur.expect('[');
+        int v[7];
+        for (int i = 0; i < 7; i++)
         {
-            bracket_end = i;
-            break;
+            if (i > 0)
+            {
+                cur.expect(',');
+            }
+            v[i] = cur.read_int();
         }
+        cur.expect(']');
+        cur.expect(',');
+        cur.read_stats(wins, total_games, is_terminal, is_computer);
+        Move new_move(v[0], v[1], v[2], v[3], v[4] != 0, v[5], v[6]);
+        // clone gamestate from the parent, switch the player and perform the move
+        GameState tmp_state = parent->state.clone();
+        tmp_state.switch_player();
+        new_move.perform_move(tmp_state.get_board(), new_move);
+        MCTS_leaf *new_leaf = new MCTS_leaf(tmp_state, new_move, parent, {}, wins, total_games, is_computer, is_terminal);
+        new_leaf->mark_saved();
+        return new_leaf;
     }
-    if (bracket_end == string::npos)
+    if (type == 'r' && parent == nullptr)
     {
-        throw runtime_error("No matching end bracket found.");
+        // r[g[b[p[id, y, x, king],...64 pieces...],current_player],wins,total_games,is_terminal,is_computer]
+        cur.pos++;
+        cur.expect('[');
+        cur.expect('g');
+        cur.expect('[');
+        cur.expect('b');
+        cur.expect('[');
+        array<array<Piece, 8>, 8> board_data;
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                if (i > 0 || j > 0)
+                {
+                    cur.expect(',');
+                }
+                cur.expect('p');
+                cur.expect('[');
+                int player_id = cur.read_int();
+                cur.expect(',');
+                int y = cur.read_int();
+                cur.expect(',');
+                int x = cur.read_int();
+                cur.expect(',');
+                bool is_king = cur.read_int() != 0;
+                cur.expect(']');
+                board_data[i][j] = Piece(player_id, y, x, is_king);
+            }
+        }
+        cur.expect(']');
+        cur.expect(',');
+        int curr_player = cur.read_int();
+        cur.expect(']');
+        cur.expect(',');
+        cur.read_stats(wins, total_games, is_terminal, is_computer);
+        GameState new_game_state(Board(board_data), curr_player);
+        MCTS_leaf *new_leaf = new MCTS_leaf(new_game_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, wins, total_games, is_computer, is_terminal);
+        new_leaf->mark_saved();
+        return new_leaf;
     }
+    if (type == '$')
+    {
+        cur.fail("Unexpected $ found");
+    }
+    cur.fail("Invalid input format for MCTS_leaf");
+}
 
-    /* we have found our data */
-    // extract the data from the string
-    string to_pass = full_input.substr(0, bracket_end + 1);
-    // erase the data from the string
-    full_input.erase(0, bracket_end + 1);
-    // create new leaf
-
-    MCTS_leaf *new_leaf = load_leaf(to_pass, root_node);
-    new_leaf->parent = root_node;
-    // create all of the children
-    while (full_input[0] != '$')
+/**
+ * @brief Parses a node and its whole subtree ("node child child ... $") at the cursor.
+ * Uses an explicit stack of open nodes instead of recursion; on error the partial subtree is freed.
+ * @return The node, or nullptr for "#".
+ */
+static MCTS_leaf *parse_subtree(TextCursor &cur, MCTS_leaf *parent)
+{
+    if (cur.peek() == '#')
+    {
+        cur.pos++;
+        return nullptr;
+    }
+    MCTS_leaf *top = parse_leaf(cur, parent);
+    vector<MCTS_leaf *> open_nodes = {top};
+    try
     {
-        // load the next child
-        MCTS_leaf *child = load_tree_helper(new_leaf, full_input);
-        if (child != nullptr)
+        while (!open_nodes.empty())
         {
-            new_leaf->children.push_back(child);
+            char c = cur.peek();
+            if (c == '$')
+            {
+                // end of the children of the innermost open node
+                cur.pos++;
+                open_nodes.pop_back();
+            }
+            else if (c == '#')
+            {
+                cur.pos++;
+            }
+            else
+            {
+                MCTS_leaf *child = parse_leaf(cur, open_nodes.back());
+                open_nodes.back()->children.push_back(child);
+                open_nodes.push_back(child);
+            }
         }
     }
-    // we have hit a $ (this should be the case)
-    full_input.erase(0, 1); // erase the $
+    catch (const exception &e)
+    {
+        destroy_tree(top);
+        throw;
+    }
+    return top;
+}
+
+MCTS_leaf *load_leaf(string params, MCTS_leaf *parent)
+{
+    TextCursor cur{params};
+    return parse_leaf(cur, parent);
+}
 
-    // return the reconstructed leaf
+MCTS_leaf *load_tree_helper(MCTS_leaf *root_node, string &full_input)
+{
+    TextCursor cur{full_input};
+    MCTS_leaf *new_leaf = parse_subtree(cur, root_node);
+    // the caller expects the parsed part to be consumed
+    full_input.erase(0, cur.pos);
     return new_leaf;
 }
 
 MCTS_leaf *load_tree(string full_input)
 {
-    MCTS_leaf *root_node = nullptr;
     try
     {
-        root_node = load_tree_helper(root_node, full_input);
-        return root_node;
+        if (is_binary_tree(full_input))
+        {
+            return load_tree_binary(full_input);
+        }
+        TextCursor cur{full_input};
+        return parse_subtree(cur, nullptr);
     }
     catch (const exception &e)
     {
         cerr << e.what() << '\n';
-        // clean up the tree if one was created
-        if (root_node != nullptr)
-        {
-            destroy_tree(root_node);
-        }
         return nullptr;
     }
 }
@@ -359,19 +909,17 @@ MCTS_leaf *load_or_create_mcts_tree()
     MCTS_leaf *mcts_tree;
     while (true)
     {
-        ifstream input_file("mcts_tree.txt");
-        if (input_file.is_open())
+        // binary files are mapped, so this does not depend on the size of the tree
+        mcts_tree = open_tree_with_journal("mcts_tree.txt");
+        if (mcts_tree != nullptr)
         {
             DEBUG_PRINT("Loading MCTS tree from file...\n");
-            string raw_input;
-            getline(input_file, raw_input);
-            mcts_tree = load_tree(raw_input);
             break;
         }
         else
         {
             DEBUG_PRINT("No MCTS tree file found. Creating a new one...\n");
-            // If no tree, create a new one and train it for 1000 iterations
+            // If no tree, create a new one and train it (1000 iterations by default)
             // default board setup
             Board board = array<array<Piece, 8>, 8>{{{Piece(NOPLAYER, 0, 0), Piece(PLAYER1, 0, 1), Piece(NOPLAYER, 0, 2), Piece(PLAYER1, 0, 3), Piece(NOPLAYER, 0, 4), Piece(PLAYER1, 0, 5), Piece(NOPLAYER, 0, 6), Piece(PLAYER1, 0, 7)},
                                                      {Piece(PLAYER1, 1, 0), Piece(NOPLAYER, 1, 1), Piece(PLAYER1, 1, 2), Piece(NOPLAYER, 1, 3), Piece(PLAYER1, 1, 4), Piece(NOPLAYER, 1, 5), Piece(PLAYER1, 1, 6), Piece(NOPLAYER, 1, 7)},
@@ -386,62 +934,413 @@ MCTS_leaf *load_or_create_mcts_tree()
             mcts_tree = new MCTS_leaf(game_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, true, false);
             DEBUG_PRINT("Created new MCTS tree with root node.\n");
             DEBUG_PRINT("Training new MCTS tree...\n");
-            train(mcts_tree, 1000);
+            train(mcts_tree, get_search_params().new_tree_iterations, get_search_params());
             DEBUG_PRINT("Training complete. Saving new MCTS tree...\n");
-            save_and_exit(mcts_tree);
+            while (!save_tree_file(mcts_tree, "mcts_tree.txt"))
+            {
+                DEBUG_PRINT("Can not open file to save MCTS tree, retrying...\n");
+                this_thread::sleep_for(chrono::milliseconds(100));
+            }
+            destroy_tree(mcts_tree);
             DEBUG_PRINT("New MCTS tree created and trained and saved.\n");
         }
     }
     return mcts_tree;
 }
 
-int save_and_exit(MCTS_leaf *mcts_tree)
+void destroy_tree(MCTS_leaf *root_node)
+{
+    if (root_node == nullptr)
+    {
+        return;
+    }
+
+    // walk the tree with an explicit stack instead of recursing once per level,
+    // so deep trees grown by long rollouts cannot overflow the call stack
+    vector<MCTS_leaf *> to_delete;
+    to_delete.push_back(root_node);
+    while (!to_delete.empty())
+    {
+        MCTS_leaf *current_node = to_delete.back();
+        to_delete.pop_back();
+        // hand the children over to the stack without copying the vector
+        for (MCTS_leaf *child : current_node->children)
+        {
+            if (child != nullptr)
+            {
+                to_delete.push_back(child);
+            }
+        }
+        delete current_node;
+    }
+}
+
+// ----- background destruction of trees -----
+// a single worker thread frees the trees that were handed over, one after the other
+deque<MCTS_leaf *> trees_to_destroy;    // trees waiting to be freed
+mutex destroy_queue_mutex;              // protects trees_to_destroy and the flags below
+condition_variable destroy_queue_cv;    // wakes up the worker when there is something to do
+thread destroy_worker;                  // the worker thread; only started when needed
+bool destroy_worker_running = false;    // true while the worker thread is alive
+bool destroy_worker_stop = false;       // set to tell the worker to exit once the queue is empty
+
+void destroy_worker_loop()
 {
-    ofstream output_file("mcts_tree.txt");
-    bool file_opened = false;
-    while (!file_opened)
+    while (true)
     {
-        if (output_file.is_open())
+        MCTS_leaf *tree = nullptr;
         {
-            DEBUG_PRINT("Can open file to save MCTS tree.\n");
-            save_tree(mcts_tree, output_file);
-            output_file.close();
-            file_opened = true;
+            unique_lock<mutex> lock(destroy_queue_mutex);
+            destroy_queue_cv.wait(lock, []
+                                  { return !trees_to_destroy.empty() || destroy_worker_stop; });
+            if (trees_to_destroy.empty())
+            {
+                // stop was requested and there is nothing left to free
+                return;
+            }
+            tree = trees_to_destroy.front();
+            trees_to_destroy.pop_front();
         }
+        destroy_tree(tree);
     }
-    DEBUG_PRINT("saved tree to file!\n");
-    // destroy the tree
-    destroy_tree(mcts_tree);
-    DEBUG_PRINT("Tree destroyed!\n");
-    return 0;
 }
 
-void destroy_tree(MCTS_leaf *root_node)
+void destroy_tree_in_background(MCTS_leaf *root_node, int min_games)
 {
     if (root_node == nullptr)
     {
         return;
     }
+    // every iteration adds at most one node, so the number of games is a cheap estimate of the tree size
+    if (root_node->total_games < min_games)
+    {
+        destroy_tree(root_node);
+        return;
+    }
+    {
+        lock_guard<mutex> lock(destroy_queue_mutex);
+        trees_to_destroy.push_back(root_node);
+        if (!destroy_worker_running)
+        {
+            destroy_worker_stop = false;
+            destroy_worker = thread(destroy_worker_loop);
+            destroy_worker_running = true;
+        }
+    }
+    destroy_queue_cv.notify_one();
+}
 
-    // Create a copy of the children pointers
-    vector<MCTS_leaf *> children_to_delete = root_node->children;
-    // Clear the original vector
-    root_node->children.clear();
+void wait_for_background_destruction()
+{
+    {
+        lock_guard<mutex> lock(destroy_queue_mutex);
+        if (!destroy_worker_running)
+        {
+            return;
+        }
+        destroy_worker_stop = true;
+    }
+    destroy_queue_cv.notify_one();
+    destroy_worker.join();
+    lock_guard<mutex> lock(destroy_queue_mutex);
+    destroy_worker_running = false;
+}
+
+mutex compaction_mutex;              // protects the flags below
+thread compaction_worker;            // the thread of the last compaction
+bool compaction_running = false;     // true while a compaction is in progress
 
-    // Recursively delete using the copied pointers
-    for (MCTS_leaf *child : children_to_delete)
+void compact_journal_in_background(const string &path)
+{
+    lock_guard<mutex> lock(compaction_mutex);
+    if (compaction_running)
+    {
+        return;
+    }
+    if (compaction_worker.joinable())
     {
-        // Add an extra null check just in case, though ideally unnecessary
-        if (child != nullptr)
+        compaction_worker.join(); // the last one is done, collect it
+    }
+    compaction_running = true;
+    compaction_worker = thread([path]()
+                               {
+        DEBUG_PRINT("Compacting the tree journal...\n");
+        compact_journal(path);
+        lock_guard<mutex> lock(compaction_mutex);
+        compaction_running = false; });
+}
+
+void wait_for_background_compaction()
+{
+    lock_guard<mutex> lock(compaction_mutex);
+    if (compaction_worker.joinable())
+    {
+        compaction_worker.join();
+    }
+}
+
+// ----- the opening book -----
+const OpeningBook *get_opening_book()
+{
+    // initialized once (thread safe); a missing or broken book only means the AI always searches
+    static shared_ptr<OpeningBook> book = []() -> shared_ptr<OpeningBook>
+    {
+        try
+        {
+            shared_ptr<OpeningBook> loaded = OpeningBook::open(OPENING_BOOK_FILE);
+            if (loaded != nullptr)
+            {
+                DEBUG_PRINT("Loaded opening book with " + to_string(loaded->get_num_positions()) + " positions\n");
+            }
+            return loaded;
+        }
+        catch (const exception &e)
+        {
+            cerr << "Ignoring opening book " << OPENING_BOOK_FILE << ": " << e.what() << '\n';
+            return nullptr;
+        }
+    }();
+    return book.get();
+}
+
+// ----- the search parameters -----
+const SearchParams &get_search_params()
+{
+    // initialized once (thread safe); a broken file only means the defaults are used
+    static const SearchParams params = []()
+    {
+        SearchParams loaded;
+        try
         {
-            destroy_tree(child);
+            if (read_search_params(SEARCH_PARAMS_FILE, loaded))
+            {
+                DEBUG_PRINT("Loaded search parameters from " SEARCH_PARAMS_FILE "\n");
+            }
         }
+        catch (const exception &e)
+        {
+            cerr << "Ignoring search parameters " << SEARCH_PARAMS_FILE << ": " << e.what() << '\n';
+            loaded = SearchParams();
+        }
+        return loaded;
+    }();
+    return params;
+}
+
+// ----- the shared tree of all AI sessions -----
+MCTS_leaf *shared_tree = nullptr;   // root of the shared tree, loaded once by open_shared_tree
+mutex shared_tree_mutex;            // protects every node of the shared tree; not held while searching
+thread tree_saver;                  // saves the shared tree every TREE_SAVE_INTERVAL seconds
+mutex tree_saver_mutex;             // protects tree_saver_stop
+condition_variable tree_saver_cv;   // wakes up the saver early when the server shuts down
+bool tree_saver_stop = false;       // set to tell the saver to exit
+bool tree_writer = false;           // this process holds TREE_LOCK_FILE and saves the shared tree
+int tree_lock_fd = -1;              // descriptor of TREE_LOCK_FILE; closing it releases the lock
+
+/**
+ * @brief Tries to become the one process on this host that saves the tree (an exclusive flock on TREE_LOCK_FILE).
+ * The lock is released by the system when the process exits, even if it crashes.
+ */
+static bool lock_tree_writer()
+{
+    int fd = open(TREE_LOCK_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    tree_lock_fd = fd;
+    return true;
+}
+
+void tree_saver_loop()
+{
+    unique_lock<mutex> lock(tree_saver_mutex);
+    while (!tree_saver_cv.wait_for(lock, chrono::seconds(TREE_SAVE_INTERVAL), []
+                                   { return tree_saver_stop; }))
+    {
+        lock.unlock();
+        save_shared_tree();
+        lock.lock();
+    }
+}
+
+MCTS_leaf *open_shared_tree()
+{
+    lock_guard<mutex> lock(shared_tree_mutex);
+    if (shared_tree == nullptr)
+    {
+        tree_writer = lock_tree_writer();
+        // the tree file is mapped shared, so every server process on this host reads the same pages
+        shared_tree = load_or_create_mcts_tree();
+        if (!tree_writer)
+        {
+            DEBUG_PRINT("Another server process saves the MCTS tree; this one hands its games over to it\n");
+        }
+        tree_saver_stop = false;
+        tree_saver = thread(tree_saver_loop);
+    }
+    return shared_tree;
+}
+
+void train_shared(MCTS_leaf *node, int num_iterations, const SearchParams &params)
+{
+    MCTS_leaf *local_root = nullptr;
+    MCTS_leaf *local_node = nullptr;
+    MCTS_leaf *root = node;
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        vector<MCTS_leaf *> path;
+        for (MCTS_leaf *n = node; n != nullptr; n = n->parent)
+        {
+            path.push_back(n);
+        }
+        root = path.back();
+        // the copies start without games, so everything the search adds to them is a change
+        for (auto it = path.rbegin(); it != path.rend(); ++it)
+        {
+            GameState state = (*it)->state.clone();
+            state.list_all_possible_moves(state.get_current_player());
+            MCTS_leaf *copy = new MCTS_leaf(state, (*it)->get_move(), local_node, {}, 0, 0, (*it)->get_is_computer(), false);
+            if (local_node != nullptr)
+            {
+                local_node->children.push_back(copy);
+            }
+            else
+            {
+                local_root = copy;
+            }
+            local_node = copy;
+        }
+    }
+    train(local_node, num_iterations, params);
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        // children another session added in the meantime are combined by their moves
+        add_tree_changes(root, local_root);
+    }
+    destroy_tree(local_root);
+}
+
+MCTS_leaf *play_player_move(MCTS_leaf *node, const Move &move, bool &is_new)
+{
+    lock_guard<mutex> lock(shared_tree_mutex);
+    ensure_children(node);
+    size_t num_children = node->children.size();
+    MCTS_leaf *child = find_or_add_child(node, move);
+    is_new = node->children.size() > num_children;
+    return child;
+}
+
+MCTS_leaf *play_alphabeta_move(MCTS_leaf *node, ParallelAlphaBeta &alphabeta, double seconds, LazySMPResult &result)
+{
+    // the search runs on a copy of the position, so it does not hold the lock
+    GameState position = [node]()
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        return node->state.clone();
+    }();
+    result = alphabeta.search(position, seconds);
+    if (!result.best.found)
+    {
+        return node;
     }
+    lock_guard<mutex> lock(shared_tree_mutex);
+    return find_or_add_child(node, result.best.best);
+}
 
-    // Delete the current node
-    delete root_node;
+/**
+ * @brief Appends the changes of the shared tree to the pending journal, for the process that saves the tree.
+ * Used instead of saving in processes that do not hold the lock on TREE_LOCK_FILE.
+ */
+static void hand_over_shared_tree()
+{
+    TreeCheckpoint checkpoint;
+    checkpoint.path = "mcts_tree.txt";
+    int num_games;
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        if (shared_tree == nullptr || !shared_tree->dirty)
+        {
+            return;
+        }
+        num_games = shared_tree->total_games - shared_tree->saved_games;
+        take_checkpoint(shared_tree, checkpoint);
+    }
+    if (!write_pending_changes(checkpoint))
+    {
+        cerr << "Unable to write the pending changes of mcts_tree.txt, " << num_games << " games of this process are lost.\n";
+    }
+}
 
-    // No return needed for void function
+void save_shared_tree()
+{
+    if (!tree_writer)
+    {
+        hand_over_shared_tree();
+        return;
+    }
+    // the games of the other server processes on this host
+    string pending = take_pending_changes("mcts_tree.txt");
+    // the files are looked at and written without the lock; the sessions only wait while the changes are copied
+    TreeCheckpoint checkpoint = prepare_checkpoint("mcts_tree.txt");
+    {
+        lock_guard<mutex> lock(shared_tree_mutex);
+        if (shared_tree != nullptr && !pending.empty())
+        {
+            add_pending_changes(shared_tree, pending);
+        }
+        if (shared_tree == nullptr || !shared_tree->dirty)
+        {
+            return;
+        }
+        take_checkpoint(shared_tree, checkpoint);
+    }
+    while (!write_checkpoint(checkpoint))
+    {
+        DEBUG_PRINT("Can not open file to save MCTS tree, retrying...\n");
+        this_thread::sleep_for(chrono::milliseconds(100));
+        if (!checkpoint.full)
+        {
+            // a journal block is useless without its snapshot file; write the whole tree instead
+            checkpoint.full = true;
+            lock_guard<mutex> lock(shared_tree_mutex);
+            take_checkpoint(shared_tree, checkpoint);
+        }
+    }
+    DEBUG_PRINT("saved tree to file!\n");
+    // the compaction only reads the files, so it does not need the tree
+    if (journal_needs_compaction("mcts_tree.txt"))
+    {
+        compact_journal_in_background("mcts_tree.txt");
+    }
+}
+
+void close_shared_tree()
+{
+    if (tree_saver.joinable())
+    {
+        {
+            lock_guard<mutex> lock(tree_saver_mutex);
+            tree_saver_stop = true;
+        }
+        tree_saver_cv.notify_one();
+        tree_saver.join();
+    }
+    save_shared_tree();
+    lock_guard<mutex> lock(shared_tree_mutex);
+    destroy_tree_in_background(shared_tree);
+    shared_tree = nullptr;
+    if (tree_lock_fd >= 0)
+    {
+        close(tree_lock_fd);
+        tree_lock_fd = -1;
+    }
+    tree_writer = false;
 }
 
 array<array<Piece, 8>, 8> create_board(string choice)
@@ -451,9 +1350,9 @@ array<array<Piece, 8>, 8> create_board(string choice)
         // Minimal board for testing jumps
         array<array<Piece, 8>, 8> m_board_j = {{{Piece(NOPLAYER, 0, 0), Piece(NOPLAYER, 0, 1), Piece(NOPLAYER, 0, 2), Piece(NOPLAYER, 0, 3), Piece(NOPLAYER, 0, 4), Piece(NOPLAYER, 0, 5), Piece(NOPLAYER, 0, 6), Piece(NOPLAYER, 0, 7)},
                                                 {Piece(NOPLAYER, 1, 0), Piece(NOPLAYER, 1, 1), Piece(NOPLAYER, 1, 2), Piece(NOPLAYER, 1, 3), Piece(NOPLAYER, 1, 4), Piece(NOPLAYER, 1, 5), Piece(NOPLAYER, 1, 6), Piece(NOPLAYER, 1, 7)},
-                                                {Piece(NOPLAYER, 2, 0), Piece(NOPLAYER, 2, 1), Piece(NOPLAYER, 2, 2), Piece(NOPLAYER, 2, 3), Piece(NOPLAYER, 2, 4), Piece(NOPLAYER, 2, 5), Piece(NOPLAYER, 2, 6), Piece(NOPLAYER, 2, 7)},
+                                                {Piece(NOPLAYER, 2, 0), Piece(NOPLAYER, 2, 1), Piece(NOPLAYER, 2, 2), Piece(PLAYER1, 2, 3), Piece(NOPLAYER, 2, 4), Piece(NOPLAYER, 2, 5), Piece(NOPLAYER, 2, 6), Piece(NOPLAYER, 2, 7)},
                                                 {Piece(NOPLAYER, 3, 0), Piece(NOPLAYER, 3, 1), Piece(PLAYER2, 3, 2), Piece(NOPLAYER, 3, 3), Piece(NOPLAYER, 3, 4), Piece(NOPLAYER, 3, 5), Piece(NOPLAYER, 3, 6), Piece(NOPLAYER, 3, 7)},
-                                                {Piece(NOPLAYER, 4, 0), Piece(PLAYER1, 4, 1), Piece(NOPLAYER, 4, 2), Piece(NOPLAYER, 4, 3), Piece(NOPLAYER, 4, 4), Piece(NOPLAYER, 4, 5), Piece(NOPLAYER, 4, 6), Piece(NOPLAYER, 4, 7)},
+                                                {Piece(NOPLAYER, 4, 0), Piece(NOPLAYER, 4, 1), Piece(NOPLAYER, 4, 2), Piece(NOPLAYER, 4, 3), Piece(NOPLAYER, 4, 4), Piece(NOPLAYER, 4, 5), Piece(NOPLAYER, 4, 6), Piece(NOPLAYER, 4, 7)},
                                                 {Piece(NOPLAYER, 5, 0), Piece(NOPLAYER, 5, 1), Piece(NOPLAYER, 5, 2), Piece(NOPLAYER, 5, 3), Piece(NOPLAYER, 5, 4), Piece(NOPLAYER, 5, 5), Piece(NOPLAYER, 5, 6), Piece(NOPLAYER, 5, 7)},
                                                 {Piece(NOPLAYER, 6, 0), Piece(NOPLAYER, 6, 1), Piece(NOPLAYER, 6, 2), Piece(NOPLAYER, 6, 3), Piece(NOPLAYER, 6, 4), Piece(NOPLAYER, 6, 5), Piece(NOPLAYER, 6, 6), Piece(NOPLAYER, 6, 7)},
                                                 {Piece(NOPLAYER, 7, 0), Piece(NOPLAYER, 7, 1), Piece(NOPLAYER, 7, 2), Piece(NOPLAYER, 7, 3), Piece(NOPLAYER, 7, 4), Piece(NOPLAYER, 7, 5), Piece(NOPLAYER, 7, 6), Piece(NOPLAYER, 7, 7)}}};
@@ -2,8 +2,16 @@
 #define MCTS_ALGORITHM_HPP
 
 #include "classes.hpp"
+#include "tree_format.hpp"
+#include "opening_book.hpp"
+#include "alphabeta.hpp"
 #include <unordered_set>
 #include <map>
+#include <string_view>
+#include <charconv>
+#include <deque>
+#include <condition_variable>
+#include <chrono>
 
 
 using namespace std;
@@ -18,14 +26,26 @@ using namespace std;
  */
 MCTS_leaf* select_most_visited_child(MCTS_leaf*);
 
+/**
+ * @brief Returns the child of a node that is reached with the given move and creates it if it does not exist yet.
+ * @param node The parent node.
+ * @param move The move; it must be legal in the state of the node.
+ * @return Pointer to the child node.
+ */
+MCTS_leaf *find_or_add_child(MCTS_leaf *node, const Move &move);
+
 
 /**
  * @brief Selects the child node with the highest UCB rating.
  *
  * Iterates through the children of the given node and returns the one with the maximum rating.
+ * Unvisited children are rated infinity, so the first unvisited child is returned right away.
+ * Otherwise `log(parent visits)` is computed once, the statistics of all children are gathered into
+ * contiguous buffers and 1/n, 1/sqrt(n) are taken from lookup tables for small visit counts.
  * If the node has no children, it will return the node itself.
  * @param root_node The parent node whose children are to be evaluated.
  * @return Pointer to the child node with the highest UCB rating or the input node if no children.
+ * The exploration constant is the one of the running `train()` call, or C outside of it.
  */
 MCTS_leaf *select_best_child(MCTS_leaf*);
 
@@ -34,7 +54,8 @@ MCTS_leaf *select_best_child(MCTS_leaf*);
  *
  * Recursively traverses the tree starting from the root, always choosing the child
  * with the highest UCB rating (using `select_best_child`) until a leaf node
- * (a node with no children) is reached.
+ * (a node with no children), a terminal node or a node with unexplored moves is reached.
+ * It also stops below the root at a position the endgame bitbase (`get_bitbase`) has solved.
  * @param root The starting node for the selection process (usually the tree root).
  * @return Pointer to the selected leaf node.
  */
@@ -53,16 +74,73 @@ MCTS_leaf *selection(MCTS_leaf*);
  */
 MCTS_leaf *expansion(MCTS_leaf*);
 
+/** @def ROLLOUT_RANDOM
+ *  @brief Rollout policy: every move of a simulation is chosen at random.
+ */
+#define ROLLOUT_RANDOM 0
+/** @def ROLLOUT_PROMOTE
+ *  @brief Rollout policy: a move that crowns a king is played whenever there is one, otherwise a random move.
+ */
+#define ROLLOUT_PROMOTE 1
+
+/** @def SEARCH_PARAMS_FILE
+ *  @brief Config file with the search parameters (written by `checkers_exec tune`); the server reads it at startup if it exists.
+ */
+#define SEARCH_PARAMS_FILE "search_params.cfg"
+
+/**
+ * @struct SearchParams
+ * @brief Parameters of the search, passed to `train()`.
+ *
+ * The file is a text file with one `key value` line per parameter
+ * (c, rollout, rollout_cutoff, reply_iterations, move_iterations, new_tree_iterations); lines starting with # are comments.
+ */
+struct SearchParams
+{
+    double c = C;                     /**< Exploration constant of the UCB formula. */
+    int rollout = ROLLOUT_RANDOM;     /**< Rollout policy (ROLLOUT_RANDOM or ROLLOUT_PROMOTE). */
+    int rollout_cutoff = 0;           /**< Plies after which a rollout stops and the side that is ahead after the captures wins; 0 plays to the end. */
+    int reply_iterations = 20;        /**< Iterations after the player made a move the tree did not have. */
+    int move_iterations = 30;         /**< Iterations before the AI moves from a node without children. */
+    int new_tree_iterations = 1000;   /**< Iterations a newly created tree is trained for. */
+};
+
+/**
+ * @brief Reads a search parameter file; keys that are not in the file keep their values.
+ * @param path Path of the file.
+ * @param params Receives the parameters.
+ * @throws runtime_error on an unknown key or an invalid value.
+ * @return false if the file can not be opened.
+ */
+bool read_search_params(const string &path, SearchParams &params);
+
+/**
+ * @brief Returns the search parameters of the server, loaded from SEARCH_PARAMS_FILE on the first call
+ * (the defaults if there is no valid file).
+ */
+const SearchParams &get_search_params();
+
+/**
+ * @brief Gives the calling thread its own random number generator for expansion and simulation.
+ * Threads without one use rand(), which is shared by all threads and takes a lock on every call.
+ * Every AI session seeds its thread, because the sessions search at the same time (see `train_shared`).
+ * @param seed Seed of the generator; the same seed gives the same games.
+ */
+void seed_thread_random(unsigned int seed);
+
 /**
  * @brief Performs the simulation (playout) phase of the MCTS algorithm.
  *
  * Starting from the game state of the given leaf node, it simulates a complete game
- * by repeatedly choosing random moves for the current player until a terminal state is reached.
+ * by repeatedly choosing moves for the current player (see `SearchParams::rollout`) until a terminal state is reached
+ * or `SearchParams::rollout_cutoff` plies were played; then the pending captures are played out (`quiescence`)
+ * and the side that is ahead by `evaluate` (material, kings count 1.5 men) wins.
+ * As soon as a position of the game is in the endgame bitbase (`get_bitbase`), its exact result is returned instead.
  * The simulation does not modify the MCTS tree itself.
  *
  * @param leaf_node The node from which to start the simulation (usually the node added during expansion).
  * @return int The result of the simulated game: PLAYER1 (1) if Player 1 wins, PLAYER2 (2) if Player 2 wins,
- *         or NOPLAYER (0) for a draw (as determined by `GameState::TerminalState`).
+ *         or NOPLAYER (0) for a draw (as determined by `GameState::TerminalState`, or equal material at the cutoff).
  */
 int simulation(MCTS_leaf*);
 
@@ -97,8 +175,9 @@ void backpropagation(MCTS_leaf*, int);
  *
  * @param root_node The root node of the MCTS tree.
  * @param num_iterations The number of MCTS iterations to perform.
+ * @param params Exploration constant and rollout settings of the search.
  */
-void train(MCTS_leaf*, int);
+void train(MCTS_leaf*, int, const SearchParams &params = SearchParams());
 
 /**
  * @brief loads a leaf node from given input string
@@ -112,13 +191,16 @@ MCTS_leaf* load_leaf(string params,MCTS_leaf*);
  * @brief Saves the current state of the MCTS tree to a json file
  * The first node (root node) saves everything (gamestate, board, ...).
  * The rest of the nodes just save the moves (and other metadata), because the gamestate can then be reconstructed from the root node.
+ * The nodes are written iteratively into a buffer (same text as `MCTS_leaf::save_leaf`), which is passed to the stream in 64 KB blocks.
  * @param root_node The root node of the MCTS tree. 
  * @param out The output stream to write the tree data to.
+ * @param pruning If given, only the nodes it keeps are written (see `SavePruning`), and it receives the node counts.
  */
-void save_tree(MCTS_leaf*,ofstream&);
+void save_tree(MCTS_leaf*,ostream&,SavePruning *pruning = nullptr);
 
 /**
  * @brief loads tree from a file
+ * Binary files (see tree_format.hpp) are detected by their header and loaded with `load_tree_binary`.
  * @param string The whole, unfiltered input file as a string.
  * @return Pointer to the root node of the loaded tree.
  */
@@ -133,17 +215,131 @@ MCTS_leaf* load_or_create_mcts_tree();
 
 /**
  * @brief deletes the whole tree, freeing up the used memory
+ * The tree is walked iteratively with an explicit stack, so the depth of the tree does not matter.
  * @param root_node The root node of the MCTS tree.
  */
 void destroy_tree(MCTS_leaf*);
 
+/**
+ * @brief deletes the tree on a background thread, so the caller does not have to wait for it.
+ * Small trees (less than `min_games` simulated games at the root) are destroyed right away,
+ * because handing them over would cost more than freeing them.
+ * @param root_node The root node of the MCTS tree. It must not be used after this call.
+ * @param min_games Number of games at the root from which on the tree is handed to the background thread.
+ */
+void destroy_tree_in_background(MCTS_leaf*, int min_games = 10000);
+
+/**
+ * @brief waits until all trees handed to `destroy_tree_in_background` are freed and stops the background thread.
+ * @note call this before the program exits.
+ */
+void wait_for_background_destruction();
+
+/**
+ * @brief Folds the journal of `path` into a new tree file on a background thread (see `compact_journal`).
+ * Does nothing if a compaction is already running.
+ * @param path Path of the tree file.
+ */
+void compact_journal_in_background(const string &path);
+
+/**
+ * @brief waits until a running background compaction is finished.
+ * @note call this before the program exits.
+ */
+void wait_for_background_compaction();
+
+/** @def TREE_SAVE_INTERVAL
+ *  @brief Seconds between two saves of the shared tree.
+ */
+#define TREE_SAVE_INTERVAL 60
+
+/** @def TREE_LOCK_FILE
+ *  @brief File that the server process saving the shared tree holds a lock on.
+ */
+#define TREE_LOCK_FILE "mcts_tree.txt.lock"
+
+/**
+ * @brief Protects the shared tree. Lock it for every access to a node of the tree returned by `open_shared_tree`
+ * (reading or creating children, reading a node's game state, taking a checkpoint), but not while waiting
+ * for a client and not while searching: sessions search a copy of their position (see `train_shared`).
+ */
+extern mutex shared_tree_mutex;
+
+/**
+ * @brief Returns the MCTS tree that all AI sessions share.
+ * The first call loads it (see `load_or_create_mcts_tree`) and starts a thread that saves it every TREE_SAVE_INTERVAL seconds;
+ * later calls return the same tree, so there is only one copy in memory however many sessions are running.
+ * When several server processes run on one host, they all map the same tree file (the pages are shared),
+ * but only the process that gets the lock on TREE_LOCK_FILE saves; the others hand the changes of their games over
+ * to it through the pending journal of the tree (see `write_pending_changes`).
+ * @return Pointer to the root of the shared tree.
+ */
+MCTS_leaf *open_shared_tree();
+
+/**
+ * @brief Trains a session-local tree from the position of a node of the shared tree and adds its games to the shared tree.
+ * The local tree starts with a copy of the path from the root to `node`, so the games also count for the ancestors.
+ * Only copying the path and adding the changes (see `add_tree_changes`) hold `shared_tree_mutex`;
+ * the search itself runs without it, so the sessions of the server search at the same time.
+ * @param node A node of the shared tree; the caller must not hold `shared_tree_mutex`.
+ * @param num_iterations Number of MCTS iterations.
+ * @param params The search parameters.
+ */
+void train_shared(MCTS_leaf *node, int num_iterations, const SearchParams &params);
+
+/**
+ * @brief Plays the move of a client on the shared tree: selects the child of `node` with this move,
+ * or creates it if no session has explored the move yet. Locks `shared_tree_mutex` itself.
+ * @param node The node of the session in the shared tree.
+ * @param move The move of the client.
+ * @param is_new Set to true if the child was created, so the caller can train it.
+ * @return The child of `node` after `move`.
+ */
+MCTS_leaf *play_player_move(MCTS_leaf *node, const Move &move, bool &is_new);
+
+/**
+ * @brief Lets the alpha-beta AI move from a node of the shared tree.
+ * The position of `node` is copied under `shared_tree_mutex`, searched without it, and the child
+ * with the best move is then selected (or created) under the lock again.
+ * @param node The node of the session in the shared tree; the caller must not hold `shared_tree_mutex`.
+ * @param alphabeta The search of the session.
+ * @param seconds Time for the search.
+ * @param result Receives the result of the search, for its statistics.
+ * @return The child of `node` after the best move, or `node` if it has no moves.
+ */
+MCTS_leaf *play_alphabeta_move(MCTS_leaf *node, ParallelAlphaBeta &alphabeta, double seconds, LazySMPResult &result);
+
+/**
+ * @brief Returns the opening book of the server, loaded from OPENING_BOOK_FILE on the first call.
+ * The book is read-only, so all sessions can probe it at the same time without a lock.
+ * @return The book or nullptr if there is no (valid) book file.
+ */
+const OpeningBook *get_opening_book();
+
+/**
+ * @brief Saves the changes of the shared tree (a journal block, or the whole tree for text files).
+ * The changes are copied out of the tree under `shared_tree_mutex` (see `take_checkpoint`) and written
+ * after the lock is released, so sessions never wait for the disk.
+ * Only the saver thread and `close_shared_tree` call this, so there is a single writer. It first adds the changes that
+ * other server processes handed over (see `take_pending_changes`). A process that does not hold the lock on
+ * TREE_LOCK_FILE appends its changes to the pending journal instead and reports games it could not write there.
+ * Starts a background compaction when the journal got too big.
+ */
+void save_shared_tree();
+
+/**
+ * @brief Stops the saver thread, saves the shared tree a last time and frees it.
+ * @note call this after all sessions are finished and before `wait_for_background_destruction`.
+ */
+void close_shared_tree();
+
 /**
  * @brief Function to load a tree from a string.
- * Recursively reconstructs the MCTS tree from the string
+ * Reconstructs the MCTS tree from the string in a single pass, with an explicit stack instead of recursion.
  * @param root_node The parent node to which the new leaf will be added.
  * @param full_input The input string containing the leaf node data.
  * @throws runtime_error if any of the data is invalid.
- * @note This is a helper function for `load_tree`.
+ * @note The parsed part is erased from `full_input`.
  * @return MCTS_leaf* 
  */
 MCTS_leaf *load_tree_helper(MCTS_leaf*, string&);
@@ -158,14 +354,6 @@ MCTS_leaf *load_tree_helper(MCTS_leaf*, string&);
 array<array<Piece, 8>, 8> create_board(string);
 
 
-/**
- * @brief save the current MCTS tree to a file and exit the program.
- * 
- * @param mcts_tree 
- * @return int 
- */
-int save_and_exit(MCTS_leaf *mcts_tree);
-
 /**
  * @brief Clears the console screen.
  * Uses `clear` on Linux/macOS and `cls` on Windows.
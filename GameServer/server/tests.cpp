@@ -0,0 +1,84 @@
+#include "tests.hpp"
+
+int all_tests()
+{
+    printf("Testing player moves on the shared tree...\n");
+    int testres = test_player_move();
+    if (testres != 0)
+        return testres;
+    printf("Player move test passed!\n");
+    printf("------\n");
+    printf("Testing alpha-beta replies...\n");
+    testres = test_alphabeta_reply();
+    if (testres != 0)
+        return testres;
+    printf("Alpha-beta reply test passed!\n");
+    return testres;
+}
+
+int test_player_move()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    init.list_all_possible_moves(init.get_current_player());
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    Move move = init.possible_moves.at(0);
+    // a move nobody played yet creates the child
+    bool is_new = false;
+    MCTS_leaf *child = play_player_move(tree, move, is_new);
+    if (!is_new || child->parent != tree || child->get_move_info() != move.get_move_info())
+    {
+        printf("\tThe child of a new move was not created!\n");
+        return 1;
+    }
+    // the same move again selects that child
+    MCTS_leaf *again = play_player_move(tree, move, is_new);
+    if (is_new || again != child || tree->children.size() != 1)
+    {
+        printf("\tThe child of a known move was created again!\n");
+        return 1;
+    }
+    destroy_tree(tree);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_alphabeta_reply()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    init.list_all_possible_moves(init.get_current_player());
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    // another session already played this move, so the player's move selects an existing child
+    Move move = init.possible_moves.at(0);
+    MCTS_leaf *known = find_or_add_child(tree, move);
+    bool is_new = true;
+    MCTS_leaf *node = play_player_move(tree, move, is_new);
+    if (is_new || node != known)
+    {
+        printf("\tThe known move was not selected!\n");
+        return 1;
+    }
+    // the reply has to be searched from the position after the player's move
+    ParallelAlphaBeta alphabeta(2);
+    LazySMPResult result;
+    MCTS_leaf *reply = play_alphabeta_move(node, alphabeta, AB_MOVE_SECONDS, result);
+    GameState after = node->state.clone();
+    after.list_all_possible_moves(after.get_current_player());
+    bool legal = false;
+    for (Move legal_move : after.possible_moves)
+    {
+        legal = legal || (reply != node && reply->parent == node && legal_move.get_move_info() == reply->get_move_info());
+    }
+    if (!legal)
+    {
+        printf("\tThe alpha-beta reply is not a legal move after the player's move!\n");
+        return 1;
+    }
+    if (reply->state.get_current_player() != init.get_current_player())
+    {
+        printf("\tThe player's turn did not come back after the reply!\n");
+        return 1;
+    }
+    destroy_tree(tree);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
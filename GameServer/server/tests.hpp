@@ -0,0 +1,16 @@
+#ifndef TESTS_HPP
+#define TESTS_HPP
+
+#include "classes.hpp"
+#include "mcts_algorithm.hpp"
+#include "alphabeta.hpp"
+
+using namespace std;
+
+int all_tests();
+
+int test_player_move();
+
+int test_alphabeta_reply();
+
+#endif // TESTS_HPP
@@ -0,0 +1,1450 @@
+#include "tree_format.hpp"
+#include "mcts_algorithm.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#if OS_LINUX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#define NO_MOVE 0xFF          // move byte of the root node
+#define FLAG_JUMP 1           // the move is a jump
+#define FLAG_TERMINAL 2       // MCTS_leaf::is_terminal
+#define FLAG_COMPUTER 4       // MCTS_leaf::is_computer
+#define HEADER_SIZE_V1 (4 + 2 + 2 + 8 + 64 * 4 + 1) // version 2 pads the header to TREE_NODES_OFFSET
+#define CHECKSUM_SIZE 8
+
+// ----- little endian and varint helpers -----
+void put_uint(string &buf, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; i++)
+    {
+        buf.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint64_t get_uint(const string &data, size_t &pos, int num_bytes)
+{
+    if (pos + num_bytes > data.size())
+    {
+        throw runtime_error("Unexpected end of binary tree file.");
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+    }
+    pos += num_bytes;
+    return value;
+}
+
+static void put_varint(string &buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+}
+
+static uint64_t get_varint(const string &data, size_t &pos)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= data.size())
+        {
+            throw runtime_error("Unexpected end of binary tree file.");
+        }
+        unsigned char byte = static_cast<unsigned char>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw runtime_error("Invalid varint in binary tree file.");
+}
+
+uint64_t fnv1a(const char *data, size_t len, uint64_t hash)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// ----- moves -----
+uint8_t encode_move(const Move &mv)
+{
+    if (mv.get_src_y() < 0)
+    {
+        return NO_MOVE;
+    }
+    int step = mv.get_jump_type() ? 2 : 1;
+    int dy = (mv.get_dest_y() - mv.get_src_y()) / step;
+    int dx = (mv.get_dest_x() - mv.get_src_x()) / step;
+    if ((dy != 1 && dy != -1) || (dx != 1 && dx != -1))
+    {
+        throw runtime_error("Move can not be stored in the binary tree format.");
+    }
+    return static_cast<uint8_t>((mv.get_src_y() * 8 + mv.get_src_x()) * 4 + (dy > 0) * 2 + (dx > 0));
+}
+
+Move decode_move(uint8_t code, bool jump)
+{
+    int src_y = (code >> 2) / 8;
+    int src_x = (code >> 2) % 8;
+    int dy = (code & 2) ? 1 : -1;
+    int dx = (code & 1) ? 1 : -1;
+    int step = jump ? 2 : 1;
+    int dest_y = src_y + step * dy;
+    int dest_x = src_x + step * dx;
+    if (dest_y < 0 || dest_y > 7 || dest_x < 0 || dest_x > 7)
+    {
+        throw runtime_error("Invalid move in binary tree file.");
+    }
+    if (jump)
+    {
+        return Move(src_y, src_x, dest_y, dest_x, true, src_y + dy, src_x + dx);
+    }
+    return Move(src_y, src_x, dest_y, dest_x, false, -1, -1);
+}
+
+static uint8_t node_flags(MCTS_leaf *node)
+{
+    return (node->get_move().get_jump_type() ? FLAG_JUMP : 0) | (node->get_is_terminal() ? FLAG_TERMINAL : 0) | (node->get_is_computer() ? FLAG_COMPUTER : 0);
+}
+
+// ----- header -----
+static void put_header(string &buf, const GameState &root_state, uint64_t num_nodes)
+{
+    buf.append(TREE_MAGIC, 4);
+    put_uint(buf, TREE_FORMAT_VERSION, 2);
+    put_uint(buf, 0, 2);
+    put_uint(buf, num_nodes, 8);
+    GameState state = root_state;
+    Board *board = state.get_board();
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            Piece p = board->clone_Piece(y, x);
+            buf.push_back(static_cast<char>(p.get_id()));
+            buf.push_back(static_cast<char>(p.get_y()));
+            buf.push_back(static_cast<char>(p.get_x()));
+            buf.push_back(static_cast<char>(p.get_king() ? 1 : 0));
+        }
+    }
+    buf.push_back(static_cast<char>(state.get_current_player()));
+    buf.resize(TREE_NODES_OFFSET, 0);
+}
+
+/**
+ * @brief Reads the root board and the player to move that follow the node count in the header.
+ */
+static GameState read_root_state(const char *data)
+{
+    array<array<Piece, 8>, 8> board_data;
+    size_t pos = 16;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            int player_id = static_cast<signed char>(data[pos]);
+            int piece_y = static_cast<signed char>(data[pos + 1]);
+            int piece_x = static_cast<signed char>(data[pos + 2]);
+            bool is_king = data[pos + 3] != 0;
+            board_data[y][x] = Piece(player_id, piece_y, piece_x, is_king);
+            pos += 4;
+        }
+    }
+    return GameState(Board(board_data), static_cast<unsigned char>(data[pos]));
+}
+
+// ----- saving -----
+/** @brief Counts the records of the subtree of record `index` (including it) without creating nodes. */
+static uint64_t count_mapped_nodes(const MappedTree *tree, uint32_t index)
+{
+    uint64_t count = 0;
+    vector<uint32_t> stack = {index};
+    while (!stack.empty())
+    {
+        TreeRecord rec = tree->get_record(stack.back());
+        stack.pop_back();
+        count++;
+        for (uint32_t c = 0; c < rec.num_children; c++)
+        {
+            stack.push_back(rec.first_child + c);
+        }
+    }
+    return count;
+}
+
+uint64_t count_tree_nodes(MCTS_leaf *root_node)
+{
+    uint64_t count = 0;
+    vector<MCTS_leaf *> stack;
+    if (root_node != nullptr)
+    {
+        stack.push_back(root_node);
+    }
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back();
+        stack.pop_back();
+        if (node->mapped)
+        {
+            count += count_mapped_nodes(node->mapped.get(), node->mapped_index);
+            continue;
+        }
+        count++;
+        for (MCTS_leaf *child : node->children)
+        {
+            if (child != nullptr)
+            {
+                stack.push_back(child);
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief A node that still has to be written: either a node on the heap
+ * or a record of a mapped file whose node was never created.
+ */
+struct SaveItem
+{
+    MCTS_leaf *node;
+    const MappedTree *tree;
+    uint32_t index;
+    int depth; // plies below the root
+};
+
+void save_tree_binary(MCTS_leaf *root_node, ostream &out, SavePruning *pruning)
+{
+    if (root_node == nullptr)
+    {
+        throw runtime_error("Can not save an empty tree.");
+    }
+    string buf;
+    put_header(buf, root_node->state, 0);
+    uint64_t nodes_dropped = 0;
+    // breadth first, so all children of a node get consecutive indices;
+    // the queue is a vector with a read position, the written items are never touched again
+    vector<SaveItem> queue = {{root_node, nullptr, 0, 0}};
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        SaveItem item = queue[i];
+        TreeRecord rec;
+        rec.first_child = static_cast<uint32_t>(queue.size());
+        const MappedTree *children_tree = nullptr; // the children are records of this file
+        TreeRecord mapped_rec;
+        if (item.node != nullptr)
+        {
+            MCTS_leaf *node = item.node;
+            Move mv = node->get_move();
+            rec.move = encode_move(mv);
+            rec.flags = node_flags(node);
+            rec.wins = static_cast<uint32_t>(node->wins);
+            rec.total_games = static_cast<uint32_t>(node->total_games);
+            if (node->mapped)
+            {
+                // the children were never needed, copy them from the file
+                children_tree = node->mapped.get();
+                mapped_rec = children_tree->get_record(node->mapped_index);
+            }
+            else
+            {
+                for (MCTS_leaf *child : node->children)
+                {
+                    if (pruning == nullptr || pruning->keep(child->total_games, item.depth + 1))
+                    {
+                        queue.push_back({child, nullptr, 0, item.depth + 1});
+                    }
+                    else
+                    {
+                        nodes_dropped += count_tree_nodes(child);
+                    }
+                }
+            }
+        }
+        else
+        {
+            children_tree = item.tree;
+            mapped_rec = children_tree->get_record(item.index);
+            rec = mapped_rec;
+            rec.first_child = static_cast<uint32_t>(queue.size());
+        }
+        if (children_tree != nullptr)
+        {
+            for (uint32_t c = 0; c < mapped_rec.num_children; c++)
+            {
+                uint32_t index = mapped_rec.first_child + c;
+                if (pruning == nullptr || pruning->keep(children_tree->get_record(index).total_games, item.depth + 1))
+                {
+                    queue.push_back({nullptr, children_tree, index, item.depth + 1});
+                }
+                else
+                {
+                    nodes_dropped += count_mapped_nodes(children_tree, index);
+                }
+            }
+        }
+        rec.num_children = static_cast<uint16_t>(queue.size() - rec.first_child);
+        buf.push_back(static_cast<char>(rec.move));
+        buf.push_back(static_cast<char>(rec.flags));
+        put_uint(buf, rec.num_children, 2);
+        put_uint(buf, rec.first_child, 4);
+        put_uint(buf, rec.wins, 4);
+        put_uint(buf, rec.total_games, 4);
+    }
+    // now the number of nodes is known
+    string count;
+    put_uint(count, queue.size(), 8);
+    buf.replace(8, 8, count);
+    put_uint(buf, fnv1a(buf.data(), buf.size()), 8);
+    out.write(buf.data(), buf.size());
+    if (pruning != nullptr)
+    {
+        pruning->nodes_written = queue.size();
+        pruning->nodes_dropped = nodes_dropped;
+    }
+}
+
+/**
+ * @brief Writes (or appends) `data` to `path` and waits until it is on the disk.
+ * Without the fsync a crash shortly after a rename could leave an empty file behind.
+ */
+static bool write_file_synced(const string &path, const string &data, bool append)
+{
+#if OS_LINUX
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    bool synced = fsync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+#else
+    ofstream out(path, append ? ios::binary | ios::app : ios::binary | ios::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out.write(data.data(), data.size());
+    out.close();
+    return !out.fail();
+#endif
+}
+
+/**
+ * @brief Renames `from` over `to`. On POSIX that is one step, and a failed rename leaves the old `to` in place.
+ * Windows can not rename over an existing file, so there `to` is removed first and is gone if the rename still fails.
+ */
+static bool rename_file(const string &from, const string &to)
+{
+    if (rename(from.c_str(), to.c_str()) == 0)
+    {
+        return true;
+    }
+#if !OS_LINUX
+    remove(to.c_str());
+    return rename(from.c_str(), to.c_str()) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Replaces `path` with `data`: writes `tmp_path`, then renames it over `path`.
+ * Readers (and a crash) see either the old or the new content, never a partly written file.
+ */
+static bool replace_file(const string &path, const string &tmp_path, const string &data)
+{
+    if (!write_file_synced(tmp_path, data, false))
+    {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    if (!rename_file(tmp_path, path))
+    {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/** @brief Serializes the whole tree in memory, in the text or the binary format. */
+static string serialize_tree(MCTS_leaf *root_node, bool text)
+{
+    ostringstream out;
+    if (text)
+    {
+        save_tree(root_node, out);
+    }
+    else
+    {
+        save_tree_binary(root_node, out);
+    }
+    return out.str();
+}
+
+bool save_tree_file(MCTS_leaf *root_node, const string &path)
+{
+    bool text = ifstream(path).is_open() && !is_binary_tree_file(path);
+    return replace_file(path, path + ".tmp", serialize_tree(root_node, text));
+}
+
+// ----- loading -----
+/**
+ * @brief Creates a node from the fields of a record.
+ * The state of a child is rebuilt from the parent (clone, switch player, perform move), like load_leaf does.
+ */
+static MCTS_leaf *new_node(MCTS_leaf *parent, const GameState *root_state, uint8_t move_code, uint8_t flags, int wins, int total_games)
+{
+    bool is_terminal = flags & FLAG_TERMINAL;
+    bool is_computer = flags & FLAG_COMPUTER;
+    MCTS_leaf *node;
+    if (parent == nullptr)
+    {
+        if (move_code != NO_MOVE)
+        {
+            throw runtime_error("Root node of binary tree file has a move.");
+        }
+        node = new MCTS_leaf(*root_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, wins, total_games, is_computer, is_terminal);
+        node->mark_saved();
+        return node;
+    }
+    if (move_code == NO_MOVE)
+    {
+        throw runtime_error("Child node of binary tree file has no move.");
+    }
+    Move mv = decode_move(move_code, flags & FLAG_JUMP);
+    GameState tmp_state = parent->state.clone();
+    tmp_state.switch_player();
+    mv.perform_move(tmp_state.get_board(), mv);
+    node = new MCTS_leaf(tmp_state, mv, parent, {}, wins, total_games, is_computer, is_terminal);
+    node->mark_saved();
+    return node;
+}
+
+/**
+ * @brief Reads one version 1 node record and creates the node.
+ */
+static MCTS_leaf *get_node_v1(const string &data, size_t &pos, MCTS_leaf *parent, const GameState *root_state, uint64_t &num_children)
+{
+    uint8_t move_code = static_cast<uint8_t>(get_uint(data, pos, 1));
+    uint8_t flags = static_cast<uint8_t>(get_uint(data, pos, 1));
+    int wins = static_cast<int>(get_varint(data, pos));
+    int total_games = static_cast<int>(get_varint(data, pos));
+    num_children = get_varint(data, pos);
+    return new_node(parent, root_state, move_code, flags, wins, total_games);
+}
+
+/**
+ * @brief Loads a version 1 file (preorder records with varints); the checksum is already checked.
+ */
+static MCTS_leaf *load_tree_v1(const string &data)
+{
+    if (data.size() < HEADER_SIZE_V1 + CHECKSUM_SIZE)
+    {
+        throw runtime_error("Not a binary tree file.");
+    }
+    size_t checksum_pos = data.size() - CHECKSUM_SIZE;
+    size_t pos = 8;
+    uint64_t num_nodes = get_uint(data, pos, 8);
+    GameState root_state = read_root_state(data.data());
+    pos = HEADER_SIZE_V1;
+
+    uint64_t num_children = 0;
+    MCTS_leaf *root_node = get_node_v1(data, pos, nullptr, &root_state, num_children);
+    uint64_t loaded = 1;
+    try
+    {
+        // stack of nodes whose children are still being read, with the number of children left
+        vector<pair<MCTS_leaf *, uint64_t>> stack = {{root_node, num_children}};
+        while (!stack.empty())
+        {
+            if (stack.back().second == 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second--;
+            MCTS_leaf *parent = stack.back().first;
+            MCTS_leaf *child = get_node_v1(data, pos, parent, nullptr, num_children);
+            parent->children.push_back(child);
+            loaded++;
+            stack.push_back({child, num_children});
+        }
+        // the nodes must end exactly where the checksum starts
+        if (loaded != num_nodes || pos != checksum_pos)
+        {
+            throw runtime_error("Node count mismatch in binary tree file.");
+        }
+    }
+    catch (const exception &e)
+    {
+        destroy_tree(root_node);
+        throw;
+    }
+    return root_node;
+}
+
+/**
+ * @brief Creates the root node of a mapped tree; its children stay in the mapping.
+ */
+static MCTS_leaf *new_mapped_root(const shared_ptr<MappedTree> &tree)
+{
+    TreeRecord rec = tree->get_record(0);
+    GameState root_state = tree->get_root_state();
+    MCTS_leaf *root_node = new_node(nullptr, &root_state, rec.move, rec.flags, rec.wins, rec.total_games);
+    if (rec.num_children > 0)
+    {
+        root_node->mapped = tree;
+        root_node->mapped_index = 0;
+    }
+    return root_node;
+}
+
+MCTS_leaf *load_tree_binary(const string &data)
+{
+    if (data.size() < 8 + CHECKSUM_SIZE || !is_binary_tree(data))
+    {
+        throw runtime_error("Not a binary tree file.");
+    }
+    size_t checksum_pos = data.size() - CHECKSUM_SIZE;
+    size_t pos = checksum_pos;
+    if (get_uint(data, pos, 8) != fnv1a(data.data(), checksum_pos))
+    {
+        throw runtime_error("Checksum mismatch in binary tree file.");
+    }
+    pos = 4;
+    uint64_t version = get_uint(data, pos, 2);
+    if (version == 1)
+    {
+        return load_tree_v1(data);
+    }
+    // version 2: read it like a mapped file and create all nodes right away
+    MCTS_leaf *root_node = new_mapped_root(MappedTree::from_buffer(data));
+    try
+    {
+        load_all_mapped(root_node);
+    }
+    catch (const exception &e)
+    {
+        destroy_tree(root_node);
+        throw;
+    }
+    return root_node;
+}
+
+void load_mapped_children(MCTS_leaf *node)
+{
+    if (!node->mapped)
+    {
+        return;
+    }
+    // take the reference, so the children are created only once even if this throws
+    shared_ptr<const MappedTree> tree = std::move(node->mapped);
+    TreeRecord rec = tree->get_record(node->mapped_index);
+    node->children.reserve(node->children.size() + rec.num_children);
+    for (uint32_t i = 0; i < rec.num_children; i++)
+    {
+        uint32_t index = rec.first_child + i;
+        TreeRecord child_rec = tree->get_record(index);
+        MCTS_leaf *child = new_node(node, nullptr, child_rec.move, child_rec.flags, child_rec.wins, child_rec.total_games);
+        if (child_rec.num_children > 0)
+        {
+            child->mapped = tree;
+            child->mapped_index = index;
+        }
+        node->children.push_back(child);
+    }
+}
+
+void load_all_mapped(MCTS_leaf *root_node)
+{
+    vector<MCTS_leaf *> stack = {root_node};
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back();
+        stack.pop_back();
+        ensure_children(node);
+        for (MCTS_leaf *child : node->children)
+        {
+            stack.push_back(child);
+        }
+    }
+}
+
+MCTS_leaf *map_tree_file(const string &path, int preload_plies)
+{
+    shared_ptr<MappedTree> tree = MappedTree::open(path);
+    if (tree == nullptr)
+    {
+        return nullptr;
+    }
+    // a search jumps between the levels of the file, reading ahead would only load records nobody needs
+    tree->advise_random_access();
+    MCTS_leaf *root_node = new_mapped_root(tree);
+    // every game starts with the first plies, so they are created right away
+    vector<MCTS_leaf *> ply = {root_node};
+    for (int depth = 0; depth < preload_plies && !ply.empty(); depth++)
+    {
+        vector<MCTS_leaf *> next_ply;
+        for (MCTS_leaf *node : ply)
+        {
+            ensure_children(node);
+            next_ply.insert(next_ply.end(), node->children.begin(), node->children.end());
+        }
+        ply = move(next_ply);
+    }
+    return root_node;
+}
+
+MCTS_leaf *open_tree_file(const string &path)
+{
+    try
+    {
+        ifstream in(path, ios::binary);
+        char head[6] = {};
+        if (!in.is_open())
+        {
+            return nullptr;
+        }
+        in.read(head, 6);
+        in.close();
+        if (is_binary_tree(string(head, 4)) && static_cast<unsigned char>(head[4]) == TREE_FORMAT_VERSION && head[5] == 0)
+        {
+            return map_tree_file(path);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return nullptr;
+    }
+    string content;
+    if (!read_tree_file(path, content))
+    {
+        return nullptr;
+    }
+    return load_tree(content);
+}
+
+// ----- journal -----
+#define JOURNAL_MAGIC "MCTJ"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 16
+
+// appends and the swap at the end of a compaction must not interleave
+static mutex journal_mutex;
+
+static string journal_path(const string &path)
+{
+    return path + ".journal";
+}
+
+static uint64_t file_size(const string &path)
+{
+    ifstream in(path, ios::binary | ios::ate);
+    return in.is_open() ? static_cast<uint64_t>(in.tellg()) : 0;
+}
+
+static string journal_header(uint64_t id)
+{
+    string header(JOURNAL_MAGIC, 4);
+    put_uint(header, JOURNAL_VERSION, 2);
+    put_uint(header, 0, 2);
+    put_uint(header, id, 8);
+    return header;
+}
+
+// the journal of the new snapshot while a compaction swaps the files (see finish_compaction)
+static string next_journal_path(const string &path)
+{
+    return journal_path(path) + ".next";
+}
+
+/**
+ * @brief Reads the snapshot id in the header of a journal file; 0 if the file is missing or invalid.
+ */
+static uint64_t journal_file_id(const string &journal_file)
+{
+    ifstream in(journal_file, ios::binary);
+    string header(JOURNAL_HEADER_SIZE, '\0');
+    if (!in.read(&header[0], JOURNAL_HEADER_SIZE) || header.compare(0, 4, JOURNAL_MAGIC) != 0)
+    {
+        return 0;
+    }
+    size_t pos = 4;
+    if (get_uint(header, pos, 2) != JOURNAL_VERSION)
+    {
+        return 0;
+    }
+    pos = 8;
+    return get_uint(header, pos, 8);
+}
+
+/**
+ * @brief Reads the snapshot id the journal of `path` belongs to; 0 if the journal is missing or invalid.
+ */
+static uint64_t journal_snapshot_id(const string &path)
+{
+    return journal_file_id(journal_path(path));
+}
+
+/**
+ * @brief Finishes a compaction that stopped between renaming the new snapshot and renaming its journal.
+ * compact_journal writes the journal of the new snapshot to `<file>.journal.next` before it renames the snapshot,
+ * so if that journal belongs to the current snapshot, it replaces the old journal. Otherwise the snapshot was not
+ * renamed and the file is ignored (the next compaction overwrites it). The caller holds journal_mutex.
+ */
+static void finish_compaction(const string &path)
+{
+    string next_path = next_journal_path(path);
+    uint64_t id = snapshot_id(path);
+    if (id == 0 || journal_file_id(next_path) != id)
+    {
+        return;
+    }
+    // if this fails, the next call tries again
+    rename_file(next_path, journal_path(path));
+}
+
+static void put_svarint(string &buf, int64_t value)
+{
+    // zigzag, so small negative deltas stay small
+    put_varint(buf, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+static int64_t get_svarint(const string &data, size_t &pos)
+{
+    uint64_t value = get_varint(data, pos);
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+uint64_t snapshot_id(const string &path)
+{
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open() || !is_binary_tree_file(path))
+    {
+        return 0;
+    }
+    uint64_t size = static_cast<uint64_t>(in.tellg());
+    if (size < TREE_NODES_OFFSET + CHECKSUM_SIZE)
+    {
+        return 0;
+    }
+    string trailer(CHECKSUM_SIZE, '\0');
+    in.seekg(size - CHECKSUM_SIZE);
+    in.read(&trailer[0], CHECKSUM_SIZE);
+    size_t pos = 0;
+    return get_uint(trailer, pos, 8);
+}
+
+/**
+ * @brief Builds one journal block with a record for every dirty node and marks the nodes as saved.
+ * Only dirty nodes are visited: backpropagation marks the whole path to the root,
+ * so clean nodes have no dirty descendants.
+ */
+static string journal_block(MCTS_leaf *root_node, uint64_t &num_records)
+{
+    string payload;
+    num_records = 0;
+    if (root_node == nullptr || !root_node->dirty)
+    {
+        return payload;
+    }
+    // the path of move codes from the root to the node on top of the stack
+    string path;
+    vector<pair<MCTS_leaf *, size_t>> stack = {{root_node, 0}};
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back().first;
+        size_t next = stack.back().second++;
+        if (next == 0)
+        {
+            // preorder, so a new parent is always created before its children when replaying
+            put_varint(payload, path.size());
+            payload += path;
+            payload.push_back(static_cast<char>(node_flags(node)));
+            put_svarint(payload, static_cast<int64_t>(node->wins) - node->saved_wins);
+            put_svarint(payload, static_cast<int64_t>(node->total_games) - node->saved_games);
+            node->mark_saved();
+            num_records++;
+        }
+        // find the next dirty child
+        while (next < node->children.size() && (node->children[next] == nullptr || !node->children[next]->dirty))
+        {
+            next = stack.back().second++;
+        }
+        if (next >= node->children.size())
+        {
+            stack.pop_back();
+            if (!path.empty())
+            {
+                path.pop_back();
+            }
+            continue;
+        }
+        MCTS_leaf *child = node->children[next];
+        path.push_back(static_cast<char>(encode_move(child->get_move())));
+        stack.push_back({child, 0});
+    }
+    return payload;
+}
+
+/**
+ * @brief Applies one journal record to the tree; a missing last node is created.
+ * @param keep_dirty false: the changed node counts as saved (replaying a journal);
+ * true: the node and its path are marked dirty, so the next save writes the change.
+ * @return false if the record does not fit the tree.
+ */
+static bool apply_record(MCTS_leaf *root_node, const string &data, size_t &pos, bool keep_dirty = false)
+{
+    uint64_t depth = get_varint(data, pos);
+    if (pos + depth > data.size())
+    {
+        throw runtime_error("Unexpected end of journal record.");
+    }
+    string path = data.substr(pos, depth);
+    pos += depth;
+    uint8_t flags = static_cast<uint8_t>(get_uint(data, pos, 1));
+    int64_t d_wins = get_svarint(data, pos);
+    int64_t d_games = get_svarint(data, pos);
+
+    MCTS_leaf *node = root_node;
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        uint8_t code = static_cast<uint8_t>(path[i]);
+        ensure_children(node);
+        MCTS_leaf *next = nullptr;
+        for (MCTS_leaf *child : node->children)
+        {
+            if (child != nullptr && encode_move(child->get_move()) == code)
+            {
+                next = child;
+                break;
+            }
+        }
+        if (next == nullptr)
+        {
+            if (i + 1 != path.size())
+            {
+                return false;
+            }
+            next = new_node(node, nullptr, code, flags, 0, 0);
+            node->children.push_back(next);
+        }
+        node = next;
+    }
+    node->wins += static_cast<int>(d_wins);
+    node->total_games += static_cast<int>(d_games);
+    if (!keep_dirty)
+    {
+        node->mark_saved();
+        return true;
+    }
+    for (MCTS_leaf *dirty_node = node; dirty_node != nullptr; dirty_node = dirty_node->parent)
+    {
+        dirty_node->dirty = true;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies all complete blocks of `data` (journal content without the header) to the tree.
+ * A torn block at the end (e.g. after a crash while appending) is ignored.
+ * @return Number of applied records.
+ */
+static long long apply_journal(MCTS_leaf *root_node, const string &data, bool keep_dirty = false)
+{
+    long long applied = 0;
+    size_t pos = 0;
+    while (pos + 4 <= data.size())
+    {
+        size_t block_pos = pos;
+        uint64_t len = get_uint(data, block_pos, 4);
+        if (block_pos + len + CHECKSUM_SIZE > data.size())
+        {
+            break;
+        }
+        string payload = data.substr(block_pos, len);
+        size_t sum_pos = block_pos + len;
+        if (get_uint(data, sum_pos, 8) != fnv1a(payload.data(), payload.size()))
+        {
+            break;
+        }
+        size_t record_pos = 0;
+        while (record_pos < payload.size())
+        {
+            if (apply_record(root_node, payload, record_pos, keep_dirty))
+            {
+                applied++;
+            }
+        }
+        pos = sum_pos;
+    }
+    return applied;
+}
+
+long long add_tree_changes(MCTS_leaf *into, MCTS_leaf *from)
+{
+    uint64_t num_records = 0;
+    string payload = journal_block(from, num_records);
+    long long applied = 0;
+    size_t pos = 0;
+    while (pos < payload.size())
+    {
+        if (apply_record(into, payload, pos, true))
+        {
+            applied++;
+        }
+    }
+    return applied;
+}
+
+/** @brief Frames a journal payload as a block: u32 length, payload, u64 checksum. */
+static string frame_block(const string &payload)
+{
+    string block;
+    put_uint(block, payload.size(), 4);
+    block += payload;
+    put_uint(block, fnv1a(payload.data(), payload.size()), 8);
+    return block;
+}
+
+/** @brief Appends one block to the journal of `path`; the caller holds journal_mutex. */
+static bool write_journal_block(const string &path, const string &block)
+{
+    finish_compaction(path);
+    uint64_t id = snapshot_id(path);
+    if (id == 0)
+    {
+        return false;
+    }
+    // a journal of another snapshot was already folded into this one, start a new journal
+    if (journal_snapshot_id(path) != id)
+    {
+        return replace_file(journal_path(path), journal_path(path) + ".tmp", journal_header(id) + block);
+    }
+    return write_file_synced(journal_path(path), block, true);
+}
+
+long long append_journal(MCTS_leaf *root_node, const string &path)
+{
+    lock_guard<mutex> lock(journal_mutex);
+    if (snapshot_id(path) == 0)
+    {
+        return -1;
+    }
+    uint64_t num_records = 0;
+    string payload = journal_block(root_node, num_records);
+    if (num_records == 0)
+    {
+        return 0;
+    }
+    return write_journal_block(path, frame_block(payload)) ? static_cast<long long>(num_records) : -1;
+}
+
+long long replay_journal(MCTS_leaf *root_node, const string &path)
+{
+    string data;
+    {
+        lock_guard<mutex> lock(journal_mutex);
+        finish_compaction(path);
+        uint64_t id = snapshot_id(path);
+        if (id == 0 || journal_snapshot_id(path) != id || !read_tree_file(journal_path(path), data))
+        {
+            return 0;
+        }
+    }
+    return apply_journal(root_node, data.substr(JOURNAL_HEADER_SIZE));
+}
+
+MCTS_leaf *open_tree_with_journal(const string &path)
+{
+    MCTS_leaf *root_node = open_tree_file(path);
+    if (root_node == nullptr)
+    {
+        return nullptr;
+    }
+    try
+    {
+        replay_journal(root_node, path);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Ignoring the rest of the journal: " << e.what() << '\n';
+    }
+    return root_node;
+}
+
+TreeCheckpoint prepare_checkpoint(const string &path)
+{
+    TreeCheckpoint checkpoint;
+    checkpoint.path = path;
+    checkpoint.full = snapshot_id(path) == 0;
+    checkpoint.text = checkpoint.full && ifstream(path).is_open() && !is_binary_tree_file(path);
+    return checkpoint;
+}
+
+void take_checkpoint(MCTS_leaf *root_node, TreeCheckpoint &checkpoint)
+{
+    if (!checkpoint.full)
+    {
+        string payload = journal_block(root_node, checkpoint.num_records);
+        checkpoint.data = checkpoint.num_records > 0 ? frame_block(payload) : "";
+        return;
+    }
+    checkpoint.data = serialize_tree(root_node, checkpoint.text);
+    checkpoint.num_records = 0;
+    // everything is in the copy now; without this the next journal would count all games a second time
+    vector<MCTS_leaf *> stack = {root_node};
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back();
+        stack.pop_back();
+        if (node == nullptr || !node->dirty)
+        {
+            continue;
+        }
+        node->mark_saved();
+        stack.insert(stack.end(), node->children.begin(), node->children.end());
+    }
+}
+
+bool write_checkpoint(const TreeCheckpoint &checkpoint)
+{
+    lock_guard<mutex> lock(journal_mutex);
+    if (!checkpoint.full)
+    {
+        return checkpoint.data.empty() || write_journal_block(checkpoint.path, checkpoint.data);
+    }
+    if (!replace_file(checkpoint.path, checkpoint.path + ".tmp", checkpoint.data))
+    {
+        return false;
+    }
+    remove(journal_path(checkpoint.path).c_str());
+    return true;
+}
+
+bool save_tree_incremental(MCTS_leaf *root_node, const string &path)
+{
+    TreeCheckpoint checkpoint = prepare_checkpoint(path);
+    take_checkpoint(root_node, checkpoint);
+    if (write_checkpoint(checkpoint))
+    {
+        return true;
+    }
+    if (checkpoint.full)
+    {
+        return false;
+    }
+    // the block was taken out of the tree already; write the whole tree so it is not lost
+    checkpoint.full = true;
+    take_checkpoint(root_node, checkpoint);
+    return write_checkpoint(checkpoint);
+}
+
+// ----- changes of other processes -----
+static string pending_path(const string &path)
+{
+    return path + ".pending";
+}
+
+#if OS_LINUX
+/**
+ * @brief Opens the pending journal of `path` and waits for an exclusive lock on it, so appends and
+ * `take_pending_changes` of different processes do not interleave. Closing the descriptor releases the lock.
+ * @return The descriptor or -1.
+ */
+static int lock_pending_file(const string &path)
+{
+    int fd = ::open(pending_path(path).c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    while (flock(fd, LOCK_EX) != 0)
+    {
+        if (errno != EINTR)
+        {
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+#endif
+
+bool write_pending_changes(const TreeCheckpoint &checkpoint)
+{
+    if (checkpoint.full)
+    {
+        return false;
+    }
+    if (checkpoint.data.empty())
+    {
+        return true;
+    }
+#if OS_LINUX
+    int fd = lock_pending_file(checkpoint.path);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool written = write_file_synced(pending_path(checkpoint.path), checkpoint.data, true);
+    ::close(fd);
+    return written;
+#else
+    return write_file_synced(pending_path(checkpoint.path), checkpoint.data, true);
+#endif
+}
+
+string take_pending_changes(const string &path)
+{
+    string data;
+#if OS_LINUX
+    int fd = lock_pending_file(path);
+    if (fd < 0)
+    {
+        return data;
+    }
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) != 0)
+    {
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            // nothing is dropped; the next call reads the file again
+            ::close(fd);
+            return "";
+        }
+        data.append(buf, static_cast<size_t>(n));
+    }
+    if (!data.empty() && ftruncate(fd, 0) != 0)
+    {
+        // the blocks stay in the file and would be added twice
+        data.clear();
+    }
+    ::close(fd);
+#else
+    if (read_tree_file(pending_path(path), data))
+    {
+        remove(pending_path(path).c_str());
+    }
+#endif
+    return data;
+}
+
+long long add_pending_changes(MCTS_leaf *root_node, const string &data)
+{
+    return apply_journal(root_node, data, true);
+}
+
+bool journal_needs_compaction(const string &path)
+{
+    uint64_t journal_size = file_size(journal_path(path));
+    return journal_size > JOURNAL_HEADER_SIZE && journal_size * JOURNAL_COMPACT_FRACTION > file_size(path);
+}
+
+bool compact_journal(const string &path)
+{
+    // remember how much of the journal goes into the new snapshot; games that end meanwhile append behind it
+    uint64_t old_id;
+    uint64_t folded_size;
+    {
+        lock_guard<mutex> lock(journal_mutex);
+        finish_compaction(path);
+        old_id = snapshot_id(path);
+        if (old_id == 0 || journal_snapshot_id(path) != old_id)
+        {
+            return false;
+        }
+        folded_size = file_size(journal_path(path));
+    }
+    string data;
+    if (!read_tree_file(journal_path(path), data) || data.size() < folded_size)
+    {
+        return false;
+    }
+    MCTS_leaf *root_node = open_tree_file(path);
+    if (root_node == nullptr)
+    {
+        return false;
+    }
+    string tmp_path = path + ".compact";
+    try
+    {
+        apply_journal(root_node, data.substr(JOURNAL_HEADER_SIZE, folded_size - JOURNAL_HEADER_SIZE));
+        if (!write_file_synced(tmp_path, serialize_tree(root_node, false), false))
+        {
+            throw runtime_error("Unable to write " + tmp_path + ".");
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        destroy_tree(root_node);
+        remove(tmp_path.c_str());
+        return false;
+    }
+    destroy_tree(root_node);
+
+    lock_guard<mutex> lock(journal_mutex);
+    if (snapshot_id(path) != old_id)
+    {
+        // the snapshot was replaced by a full save in the meantime
+        remove(tmp_path.c_str());
+        return false;
+    }
+    // keep the blocks that were appended while the snapshot was written
+    string tail;
+    read_tree_file(journal_path(path), tail);
+    tail.erase(0, min<size_t>(folded_size, tail.size()));
+    uint64_t new_id = snapshot_id(tmp_path);
+    // the journal of the new snapshot is written before the snapshot is renamed, so a crash leaves either the old
+    // snapshot with the old journal or the new snapshot with its journal in <file>.journal.next (see finish_compaction)
+    string next_path = next_journal_path(path);
+    if (!write_file_synced(next_path, journal_header(new_id) + tail, false))
+    {
+        cerr << "Unable to write " << next_path << ", the journal is not compacted.\n";
+        remove(next_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    if (!rename_file(tmp_path, path))
+    {
+        cerr << "Unable to replace " << path << ", the journal is not compacted.\n";
+        remove(next_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    finish_compaction(path);
+    if (journal_snapshot_id(path) != new_id)
+    {
+        cerr << "Unable to replace " << journal_path(path) << ", it is taken from " << next_path << " on the next load.\n";
+        return false;
+    }
+    return true;
+}
+
+// ----- mapped files -----
+MappedFile::~MappedFile()
+{
+#if OS_LINUX
+    if (map_addr != nullptr)
+    {
+        munmap(map_addr, length);
+    }
+#endif
+}
+
+shared_ptr<MappedFile> MappedFile::open(const string &path)
+{
+#if OS_LINUX
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return from_buffer("");
+    }
+    // shared and read only: the page cache holds one copy for all processes and the file is never changed through it
+    void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid without the descriptor
+    if (addr == MAP_FAILED)
+    {
+        throw runtime_error("Unable to map " + path + ".");
+    }
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    file->map_addr = addr;
+    file->content = static_cast<const char *>(addr);
+    file->length = static_cast<size_t>(st.st_size);
+    return file;
+#else
+    string data;
+    if (!read_tree_file(path, data))
+    {
+        return nullptr;
+    }
+    return from_buffer(std::move(data));
+#endif
+}
+
+shared_ptr<MappedFile> MappedFile::from_buffer(string data)
+{
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    file->buffer = std::move(data);
+    file->content = file->buffer.data();
+    file->length = file->buffer.size();
+    return file;
+}
+
+void MappedFile::advise_random_access() const
+{
+#if OS_LINUX
+    if (map_addr != nullptr)
+    {
+        madvise(map_addr, length, MADV_RANDOM);
+    }
+#endif
+}
+
+shared_ptr<MappedTree> MappedTree::open(const string &path)
+{
+    shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (file == nullptr)
+    {
+        return nullptr;
+    }
+    shared_ptr<MappedTree> tree = make_shared<MappedTree>();
+    tree->parse_header(file);
+    return tree;
+}
+
+shared_ptr<MappedTree> MappedTree::from_buffer(string data)
+{
+    shared_ptr<MappedTree> tree = make_shared<MappedTree>();
+    tree->parse_header(MappedFile::from_buffer(std::move(data)));
+    return tree;
+}
+
+void MappedTree::parse_header(shared_ptr<MappedFile> mapped_file)
+{
+    file = mapped_file;
+    data = file->data();
+    size = file->size();
+    if (size < TREE_NODES_OFFSET + CHECKSUM_SIZE || memcmp(data, TREE_MAGIC, 4) != 0)
+    {
+        throw runtime_error("Not a binary tree file.");
+    }
+    string head(data, 16);
+    size_t pos = 4;
+    uint64_t version = get_uint(head, pos, 2);
+    if (version != TREE_FORMAT_VERSION)
+    {
+        throw runtime_error("Unsupported binary tree file version " + to_string(version) + ".");
+    }
+    pos = 8;
+    num_nodes = get_uint(head, pos, 8);
+    // checked without multiplying, so a huge count can not overflow
+    if (num_nodes == 0 || num_nodes != (size - TREE_NODES_OFFSET - CHECKSUM_SIZE) / TREE_RECORD_SIZE ||
+        (size - TREE_NODES_OFFSET - CHECKSUM_SIZE) % TREE_RECORD_SIZE != 0)
+    {
+        throw runtime_error("Node count mismatch in binary tree file.");
+    }
+}
+
+TreeRecord MappedTree::get_record(uint64_t index) const
+{
+    if (index >= num_nodes)
+    {
+        throw runtime_error("Node index out of range in binary tree file.");
+    }
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data + TREE_NODES_OFFSET + index * TREE_RECORD_SIZE);
+    auto u32 = [p](int offset)
+    { return static_cast<uint32_t>(p[offset]) | static_cast<uint32_t>(p[offset + 1]) << 8 |
+             static_cast<uint32_t>(p[offset + 2]) << 16 | static_cast<uint32_t>(p[offset + 3]) << 24; };
+    TreeRecord rec;
+    rec.move = p[0];
+    rec.flags = p[1];
+    rec.num_children = static_cast<uint16_t>(p[2] | p[3] << 8);
+    rec.first_child = u32(4);
+    rec.wins = u32(8);
+    rec.total_games = u32(12);
+    // children always come after their parent, so following them can not loop
+    if (rec.num_children > 0 && (rec.first_child <= index || rec.first_child + static_cast<uint64_t>(rec.num_children) > num_nodes))
+    {
+        throw runtime_error("Invalid child index in binary tree file.");
+    }
+    return rec;
+}
+
+GameState MappedTree::get_root_state() const
+{
+    return read_root_state(data);
+}
+
+bool MappedTree::verify_checksum() const
+{
+    size_t checksum_pos = size - CHECKSUM_SIZE;
+    string tail(data + checksum_pos, CHECKSUM_SIZE);
+    size_t pos = 0;
+    return get_uint(tail, pos, 8) == fnv1a(data, checksum_pos);
+}
+
+// ----- files -----
+bool is_binary_tree(const string &data)
+{
+    return data.compare(0, 4, TREE_MAGIC) == 0;
+}
+
+bool is_binary_tree_file(const string &path)
+{
+    ifstream in(path, ios::binary);
+    char magic[4] = {};
+    if (!in.read(magic, 4))
+    {
+        return false;
+    }
+    return is_binary_tree(string(magic, 4));
+}
+
+bool read_tree_file(const string &path, string &content)
+{
+    ifstream in(path, ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    in.seekg(0, ios::end);
+    content.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0, ios::beg);
+    in.read(&content[0], content.size());
+    // text files are a single line; drop a trailing newline if an editor added one
+    if (!is_binary_tree(content) && !content.empty() && content.back() == '\n')
+    {
+        content.pop_back();
+    }
+    return true;
+}
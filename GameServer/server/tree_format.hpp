@@ -0,0 +1,465 @@
+/**
+ * @file tree_format.hpp
+ * @brief Compact binary file format for MCTS trees, which can also be memory mapped.
+ *
+ * Layout of version 2 (all integers little endian):
+ * - header (TREE_NODES_OFFSET bytes): magic "MCTB", u16 version, u16 flags (0), u64 number of nodes,
+ *   the root board as 64 * (i8 player, i8 y, i8 x, u8 king), u8 current player, zero padding
+ * - all nodes in breadth first order, so the children of a node are stored next to each other.
+ *   Every node is a fixed TREE_RECORD_SIZE byte record:
+ *   u8 move, u8 flags (1 = jump, 2 = terminal, 4 = computer), u16 number of children,
+ *   u32 index of the first child, u32 wins, u32 total_games
+ * - u64 FNV-1a checksum of everything before it
+ *
+ * A move is stored as (source square * 4 + direction), the direction being (dy > 0) * 2 + (dx > 0);
+ * destination and jumped square follow from the jump flag. The root has no move (0xFF).
+ *
+ * Because every record can be found by its index, a tree file can be mapped into memory (`map_tree_file`)
+ * and only the nodes a search actually visits are created on the heap. The mapping is read only;
+ * all changes (statistics, new children) go into the heap nodes, which are written back by the next save.
+ * Files are mapped shared (`MappedFile`), so all processes on a host that map the same tree or opening book
+ * use one copy of its pages in the page cache, while each process keeps its changes in its own heap nodes.
+ * Files are only ever replaced (written to a temporary file and renamed), never changed in place,
+ * so a process keeps reading the version it mapped.
+ *
+ * Version 1 files (preorder records with varints) can still be loaded.
+ *
+ * Journal: instead of rewriting the whole file after every game, `save_tree_incremental` appends the changes
+ * to `<file>.journal`. The journal starts with magic "MCTJ", u16 version, u16 flags (0) and the u64 checksum of
+ * the binary file it belongs to (its snapshot id). Every save appends one block: u32 length, the records,
+ * u64 FNV-1a checksum of the records. A record is one node whose statistics changed or that is new:
+ * varint depth, the move codes of the path from the root, u8 flags, zigzag varints for the change of wins
+ * and total_games. Changes (not totals) are stored, so games of several sessions add up.
+ * `compact_journal` folds the journal into a new binary file.
+ */
+#ifndef TREE_FORMAT_HPP
+#define TREE_FORMAT_HPP
+
+#include "classes.hpp"
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+/** @def TREE_MAGIC
+ *  @brief First four bytes of a binary tree file.
+ */
+#define TREE_MAGIC "MCTB"
+/** @def TREE_FORMAT_VERSION
+ *  @brief Version of the binary format written by save_tree_binary.
+ */
+#define TREE_FORMAT_VERSION 2
+/** @def TREE_NODES_OFFSET
+ *  @brief Size of the (padded) header, i.e. the offset of the first node record.
+ */
+#define TREE_NODES_OFFSET 288
+/** @def TREE_RECORD_SIZE
+ *  @brief Size of one node record in version 2.
+ */
+#define TREE_RECORD_SIZE 16
+
+/** @def TREE_PRELOAD_PLIES
+ *  @brief Number of plies below the root that map_tree_file creates right away.
+ */
+#define TREE_PRELOAD_PLIES 3
+
+/** @def JOURNAL_COMPACT_FRACTION
+ *  @brief The journal is compacted once it is larger than 1/JOURNAL_COMPACT_FRACTION of the tree file.
+ */
+#define JOURNAL_COMPACT_FRACTION 2
+
+/**
+ * @struct TreeRecord
+ * @brief One decoded node record of a version 2 tree file.
+ */
+struct TreeRecord
+{
+    uint8_t move;          /**< Encoded move, 0xFF for the root. */
+    uint8_t flags;         /**< 1 = jump, 2 = terminal, 4 = computer. */
+    uint16_t num_children; /**< Number of children. */
+    uint32_t first_child;  /**< Index of the first child; the others follow it. */
+    uint32_t wins;         /**< MCTS_leaf::wins */
+    uint32_t total_games;  /**< MCTS_leaf::total_games */
+};
+
+/**
+ * @class MappedFile
+ * @brief The content of a file, mapped shared and read only (or held in a buffer).
+ */
+class MappedFile
+{
+private:
+    const char *content = nullptr; /**< Start of the file content. */
+    size_t length = 0;             /**< Size of the file content. */
+    void *map_addr = nullptr;      /**< Address returned by mmap, nullptr if the content is in `buffer`. */
+    string buffer;                 /**< File content if it was not mapped. */
+
+public:
+    /**
+     * @brief Maps the file at `path` shared and read only; the pages are shared with every other process mapping it.
+     * Empty files and, on systems without mmap, all files are read into memory instead.
+     * @param path Path of the file.
+     * @return The mapped file or nullptr if the file can not be opened.
+     */
+    static shared_ptr<MappedFile> open(const string &path);
+
+    /**
+     * @brief Wraps file content that is already in memory.
+     * @param data The whole file content.
+     */
+    static shared_ptr<MappedFile> from_buffer(string data);
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    /** @brief Returns the start of the file content. */
+    const char *data() const { return content; }
+
+    /** @brief Returns the size of the file content. */
+    size_t size() const { return length; }
+
+    /**
+     * @brief Tells the system that the content is read in random order, so it does not read ahead.
+     * Then only the pages that are actually read become resident. Does nothing if the file is not mapped.
+     */
+    void advise_random_access() const;
+};
+
+/**
+ * @class MappedTree
+ * @brief A version 2 tree file that is mapped into memory (or held in a buffer) and read record by record.
+ *
+ * Nodes whose children have not been created yet keep a shared pointer to it in `MCTS_leaf::mapped`,
+ * so the mapping lives as long as any of them.
+ */
+class MappedTree
+{
+private:
+    shared_ptr<MappedFile> file; /**< The file content. */
+    const char *data = nullptr;  /**< Start of the file content. */
+    size_t size = 0;             /**< Size of the file content. */
+    uint64_t num_nodes = 0;      /**< Number of node records. */
+
+    /** @brief Takes the content of `file` and checks its header. */
+    void parse_header(shared_ptr<MappedFile> file);
+
+public:
+    /**
+     * @brief Maps the file at `path` read only (see `MappedFile::open`).
+     * @param path Path of a version 2 tree file.
+     * @throws runtime_error if the file is not a valid version 2 tree file.
+     * @return The mapped tree or nullptr if the file can not be opened.
+     */
+    static shared_ptr<MappedTree> open(const string &path);
+
+    /**
+     * @brief Wraps the content of a version 2 tree file that is already in memory.
+     * @param data The whole file content.
+     * @throws runtime_error if the content is not a valid version 2 tree file.
+     */
+    static shared_ptr<MappedTree> from_buffer(string data);
+
+    /** @brief Returns the number of node records. */
+    uint64_t get_num_nodes() const { return num_nodes; }
+
+    /**
+     * @brief Reads the record with the given index.
+     * @throws runtime_error if the index or the children of the record are out of range.
+     */
+    TreeRecord get_record(uint64_t index) const;
+
+    /** @brief Returns the game state of the root stored in the header. */
+    GameState get_root_state() const;
+
+    /** @brief Checks the checksum at the end of the file (reads the whole file). */
+    bool verify_checksum() const;
+
+    /**
+     * @brief Tells the system that the records are read in random order (see `MappedFile::advise_random_access`).
+     */
+    void advise_random_access() const { file->advise_random_access(); }
+};
+
+/**
+ * @brief Appends `value` as a little endian integer of `num_bytes` bytes.
+ */
+void put_uint(string &buf, uint64_t value, int num_bytes);
+
+/**
+ * @brief FNV-1a hash of `data`. Pass the hash of the previous chunk as `hash` to hash a file piece by piece.
+ */
+uint64_t fnv1a(const char *data, size_t len, uint64_t hash = 14695981039346656037ULL);
+
+/**
+ * @brief Encodes a move as one byte: (source square * 4 + direction), the direction being (dy > 0) * 2 + (dx > 0).
+ * The root move (source -1) is encoded as 0xFF.
+ * @throws runtime_error if the move is not a diagonal step or jump.
+ */
+uint8_t encode_move(const Move &mv);
+
+/**
+ * @brief Decodes a move that was encoded with `encode_move`.
+ * @param code The encoded move.
+ * @param jump Whether the move is a jump (not part of the code).
+ * @throws runtime_error if the destination is off the board.
+ */
+Move decode_move(uint8_t code, bool jump);
+
+/**
+ * @brief Checks whether the given file content is a binary tree (starts with TREE_MAGIC).
+ * @param data The file content (or at least its first bytes).
+ */
+bool is_binary_tree(const string &data);
+
+/**
+ * @brief Checks whether the file at `path` exists and contains a binary tree.
+ * @param path Path of the tree file.
+ */
+bool is_binary_tree_file(const string &path);
+
+/**
+ * @brief Reads a whole tree file (text or binary) into a string.
+ * @param path Path of the tree file.
+ * @param content Receives the file content.
+ * @return true if the file could be opened, false otherwise.
+ */
+bool read_tree_file(const string &path, string &content);
+
+/**
+ * @struct SavePruning
+ * @brief Options of a pruned save and its report.
+ *
+ * A node with fewer than `min_visits` games or deeper than `max_depth` is not written, and neither is its subtree.
+ * Nothing is lost from the statistics that are written: the games of a dropped subtree are already counted
+ * in its parent. The root is always written.
+ */
+struct SavePruning
+{
+    int min_visits = 0;         /**< Nodes with fewer games are dropped. */
+    int max_depth = -1;         /**< Nodes more plies than this below the root are dropped; -1 for no limit. */
+    uint64_t nodes_written = 0; /**< Set by the save: number of nodes written. */
+    uint64_t nodes_dropped = 0; /**< Set by the save: number of nodes dropped. */
+
+    /** @brief Returns true if a node with `total_games` games, `depth` plies below the root, is written. */
+    bool keep(int total_games, int depth) const
+    {
+        return total_games >= min_visits && (max_depth < 0 || depth <= max_depth);
+    }
+};
+
+/**
+ * @brief Counts the nodes of a tree, including those that are still only in a mapped file (without creating them).
+ * @param root_node The root of the tree.
+ */
+uint64_t count_tree_nodes(MCTS_leaf *root_node);
+
+/**
+ * @brief Saves the tree in the binary format (version 2).
+ * Children that are still in a mapped file are copied from there without creating nodes for them.
+ * @param root_node The root node of the MCTS tree.
+ * @param out The output stream; it should be opened in binary mode.
+ * @param pruning If given, only the nodes it keeps are written, and it receives the node counts.
+ */
+void save_tree_binary(MCTS_leaf *, ostream &, SavePruning *pruning = nullptr);
+
+/**
+ * @brief Saves the tree to `path` by writing `path`.tmp and renaming it over `path`.
+ * Trees that still map the old file keep reading the old content, because the old file is never overwritten.
+ * An existing text file is written as text again, everything else in the binary format.
+ * @param root_node The root node of the MCTS tree.
+ * @param path Path of the tree file.
+ * @return true on success, false if the file can not be written.
+ */
+bool save_tree_file(MCTS_leaf *, const string &path);
+
+/**
+ * @brief Loads a whole tree from the content of a binary tree file (version 1 or 2).
+ * @param data The whole file content.
+ * @throws runtime_error if the header, the node data or the checksum is invalid.
+ * @return Pointer to the root node of the loaded tree.
+ */
+MCTS_leaf *load_tree_binary(const string &);
+
+/**
+ * @brief Maps a version 2 tree file and creates its root node and the nodes of the first `preload_plies` plies.
+ * All deeper nodes are created from the mapped records when they are first needed (see `ensure_children`),
+ * so this takes the same time for every tree size. The checksum is not checked, only the structure
+ * of the records that are read.
+ * @param path Path of the tree file.
+ * @param preload_plies Number of plies below the root that are created right away.
+ * @throws runtime_error if the file is not a valid version 2 tree file.
+ * @return The root node or nullptr if the file can not be opened.
+ */
+MCTS_leaf *map_tree_file(const string &path, int preload_plies = TREE_PRELOAD_PLIES);
+
+/**
+ * @brief Opens a tree file of any format: version 2 files are mapped, everything else is loaded with `load_tree`.
+ * @param path Path of the tree file.
+ * @return The root node or nullptr if the file can not be opened or is invalid.
+ */
+MCTS_leaf *open_tree_file(const string &path);
+
+/**
+ * @brief Creates the children of a node from its mapped record.
+ * Does nothing if the children of the node are already on the heap.
+ * @param node The node whose children are needed.
+ * @throws runtime_error if the mapped records are invalid.
+ */
+void load_mapped_children(MCTS_leaf *node);
+
+/**
+ * @brief Makes sure `node->children` is complete; call it before reading the children of a node.
+ * @param node The node whose children are needed.
+ */
+inline void ensure_children(MCTS_leaf *node)
+{
+    if (node->mapped)
+    {
+        load_mapped_children(node);
+    }
+}
+
+/**
+ * @brief Creates all nodes of the subtree that are still only in a mapped file.
+ * @param root_node The root of the subtree.
+ */
+void load_all_mapped(MCTS_leaf *root_node);
+
+/**
+ * @brief Returns the id of a binary (version 2) tree file, which is its checksum; 0 for other files.
+ * @param path Path of the tree file.
+ */
+uint64_t snapshot_id(const string &path);
+
+/**
+ * @brief Appends the changes of all dirty nodes to `path`.journal and marks them as saved.
+ * Only the dirty part of the tree is visited.
+ * @param root_node The root node of the MCTS tree (the same tree that was loaded from `path`).
+ * @param path Path of the binary tree file the journal belongs to.
+ * @return Number of written records, or -1 if `path` is not a binary tree file or the journal can not be written.
+ */
+long long append_journal(MCTS_leaf *, const string &path);
+
+/**
+ * @brief Applies `path`.journal to a tree loaded from `path`, if the journal belongs to that file.
+ * Nodes that are in the journal but not in the tree are created.
+ * @param root_node The root node of the tree loaded from `path`.
+ * @param path Path of the binary tree file.
+ * @throws runtime_error if a record is invalid.
+ * @return Number of applied records.
+ */
+long long replay_journal(MCTS_leaf *, const string &path);
+
+/**
+ * @brief Opens a tree file like `open_tree_file` and applies its journal.
+ * @param path Path of the tree file.
+ * @return The root node or nullptr if the file can not be opened or is invalid.
+ */
+MCTS_leaf *open_tree_with_journal(const string &path);
+
+/**
+ * @brief Adds the changes that were made to `from` since it was loaded (or since the last call) to `into`.
+ * Both trees must start at the same position: `from` is a copy of `into`, e.g. loaded from the same file (trees that
+ * several threads train independently), or a copy of the path from the root of `into` to one node with zeroed
+ * statistics. The changed nodes of `from` are marked as saved; the changed nodes of `into` are marked dirty, so the
+ * next save of `into` writes them. Nodes that are missing in `into` are created.
+ * @param into The tree that receives the changes.
+ * @param from The tree whose changes are added.
+ * @return Number of nodes that were changed in `into`.
+ */
+long long add_tree_changes(MCTS_leaf *into, MCTS_leaf *from);
+
+/**
+ * @struct TreeCheckpoint
+ * @brief Everything one save writes, copied out of the tree, so it can be written while the tree is in use.
+ *
+ * A save is split into three steps: `prepare_checkpoint` looks at the files, `take_checkpoint` copies the data
+ * out of the tree (memory only, so a lock on the tree is held only for that) and `write_checkpoint` writes it.
+ */
+struct TreeCheckpoint
+{
+    string path;              /**< Path of the tree file. */
+    bool full = false;        /**< true: `data` replaces the tree file; false: `data` is appended to the journal. */
+    bool text = false;        /**< Full checkpoints of a text tree file are written as text again. */
+    string data;              /**< The whole file or one journal block; empty if nothing changed. */
+    uint64_t num_records = 0; /**< Number of journal records in `data`. */
+};
+
+/**
+ * @brief Decides how the tree at `path` is saved: as a journal block if `path` is a binary file, otherwise as a whole file.
+ * @param path Path of the tree file.
+ */
+TreeCheckpoint prepare_checkpoint(const string &path);
+
+/**
+ * @brief Copies the data of the checkpoint out of the tree and marks the copied nodes as saved. Does no disk I/O.
+ * The copy is consistent as long as nobody changes the tree during this call.
+ * @param root_node The root node of the tree.
+ * @param checkpoint The prepared checkpoint; set `full` to copy the whole tree.
+ */
+void take_checkpoint(MCTS_leaf *, TreeCheckpoint &checkpoint);
+
+/**
+ * @brief Writes a checkpoint. Whole files are written to `path`.tmp, flushed to the disk and renamed over `path`;
+ * journal blocks are appended and flushed. A crash at any point leaves the old file or the new one,
+ * and at most a torn last journal block, which is ignored when the journal is replayed.
+ * @param checkpoint The checkpoint from `take_checkpoint`.
+ * @return true on success. A journal block can not be written without its binary file; take a full checkpoint then.
+ */
+bool write_checkpoint(const TreeCheckpoint &checkpoint);
+
+/**
+ * @brief Saves only the changes since the tree was loaded: appends them to the journal if `path` is a binary file,
+ * otherwise saves the whole tree and removes the old journal (see `TreeCheckpoint`).
+ * @param root_node The root node of the tree, as returned by `open_tree_with_journal`.
+ * @param path Path of the tree file.
+ * @return true on success.
+ */
+bool save_tree_incremental(MCTS_leaf *, const string &path);
+
+/**
+ * @brief Appends a journal block from `take_checkpoint` to `path`.pending instead of the journal.
+ * Processes that share the tree file but do not save it hand their changes over this way; the process that saves
+ * adds them to its tree (see `take_pending_changes`). Appends of several processes are serialized by a file lock.
+ * @param checkpoint A checkpoint with `full` set to false.
+ * @return true on success; false for a full checkpoint or if the file can not be written.
+ */
+bool write_pending_changes(const TreeCheckpoint &checkpoint);
+
+/**
+ * @brief Reads the blocks that other processes appended to `path`.pending and empties the file.
+ * @param path Path of the tree file.
+ * @return The blocks for `add_pending_changes`; empty if there are none or the file can not be read.
+ */
+string take_pending_changes(const string &path);
+
+/**
+ * @brief Adds the blocks of `take_pending_changes` to the tree. The changed nodes are marked dirty,
+ * so the next checkpoint writes them to the journal. Torn blocks are skipped.
+ * @param root_node The root node of the tree.
+ * @param data The blocks.
+ * @return Number of nodes that were changed.
+ */
+long long add_pending_changes(MCTS_leaf *, const string &data);
+
+/**
+ * @brief Checks whether the journal of `path` has grown past JOURNAL_COMPACT_FRACTION of the tree file.
+ * @param path Path of the tree file.
+ */
+bool journal_needs_compaction(const string &path);
+
+/**
+ * @brief Writes a new binary tree file with the journal applied and starts a new journal.
+ * Blocks that are appended while the new file is written are kept in the new journal.
+ * Trees that still map the old file are not affected (the file is replaced by a rename).
+ * The new journal is written to `<file>.journal.next` before the new file is renamed into place and renamed
+ * after it; if the process stops in between, the next load or append finishes the swap, so the tree file and
+ * its journal always belong together.
+ * @param path Path of the binary tree file.
+ * @return true if the file was compacted; false (with a message on stderr) if a file could not be written or replaced.
+ */
+bool compact_journal(const string &path);
+
+#endif
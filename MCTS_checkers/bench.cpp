@@ -0,0 +1,282 @@
+/**
+ * @file bench.cpp
+ * @brief Microbenchmarks for the hot paths of the engine.
+ *
+ * Every benchmark runs on positions that are generated from a fixed seed, so two runs
+ * (e.g. before and after an optimization) measure the same work.
+ * The output is one CSV line per benchmark:
+ * benchmark,iterations,ns_per_op,ops_per_sec
+ *
+ * Usage: checkers_bench [filter]
+ * If a filter is given, only benchmarks whose name contains it are run.
+ */
+#include "classes.hpp"
+#include "mcts_algorithm.hpp"
+#include "tree_format.hpp"
+#include "opening_book.hpp"
+#include "alphabeta.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+#define BENCH_SEED 42           // seed for rand(), so every run plays the same games
+#define BENCH_MIN_TIME_MS 300   // every benchmark runs at least this long
+#define BENCH_NUM_POSITIONS 64  // number of positions for the per-position benchmarks
+#define BENCH_BIG_TREE_ITER 20000 // iterations used to grow the tree for save/load
+
+string bench_filter = ""; // only run benchmarks containing this string
+
+/**
+ * @brief Runs `op` in growing batches until BENCH_MIN_TIME_MS is reached and prints the result.
+ * @param name Name of the benchmark (first CSV column).
+ * @param op The operation to measure; it is called once per iteration.
+ */
+template <typename F>
+void run_bench(const string &name, F op)
+{
+    if (name.find(bench_filter) == string::npos)
+    {
+        return;
+    }
+    srand(BENCH_SEED);
+    long long iterations = 0;
+    long long batch = 1;
+    auto start = chrono::steady_clock::now();
+    double elapsed_ns = 0;
+    while (elapsed_ns < BENCH_MIN_TIME_MS * 1e6)
+    {
+        for (long long i = 0; i < batch; i++)
+        {
+            op();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+    double ns_per_op = elapsed_ns / iterations;
+    printf("%s,%lld,%.1f,%.1f\n", name.c_str(), iterations, ns_per_op, 1e9 / ns_per_op);
+    fflush(stdout);
+}
+
+/**
+ * @brief Creates a new tree with the default board as root.
+ */
+MCTS_leaf *new_default_tree()
+{
+    GameState game_state(Board(create_board("default")), PLAYER1);
+    return new MCTS_leaf(game_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, true, false);
+}
+
+/**
+ * @brief Plays random games from the default board and collects positions along the way.
+ * Every position has its possible moves generated and is not terminal.
+ * @param count Number of positions to collect.
+ */
+vector<GameState> sample_positions(size_t count)
+{
+    srand(BENCH_SEED);
+    vector<GameState> positions;
+    while (positions.size() < count)
+    {
+        GameState state(Board(create_board("default")), PLAYER1);
+        state.list_all_possible_moves(state.get_current_player());
+        while (state.TerminalState() == -1 && positions.size() < count)
+        {
+            // keep every third position, so the sample covers openings, middle games and endgames
+            if (rand() % 3 == 0)
+            {
+                positions.push_back(state);
+            }
+            Move mv = state.possible_moves[rand() % state.possible_moves.size()];
+            GameState next = state.clone();
+            next.switch_player();
+            mv.perform_move(next.get_board(), mv);
+            next.list_all_possible_moves(next.get_current_player());
+            state = next;
+        }
+    }
+    return positions;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        bench_filter = argv[1];
+    }
+    vector<GameState> positions = sample_positions(BENCH_NUM_POSITIONS);
+    size_t pos_index = 0;
+
+    printf("benchmark,iterations,ns_per_op,ops_per_sec\n");
+
+    // ----- move generation -----
+    run_bench("list_all_possible_moves", [&]()
+              {
+        GameState &state = positions[pos_index++ % positions.size()];
+        state.list_all_possible_moves(state.get_current_player()); });
+
+    // ----- cloning a state -----
+    run_bench("gamestate_clone", [&]()
+              {
+        GameState copy = positions[pos_index++ % positions.size()].clone();
+        (void)copy; });
+
+    // ----- performing a move (on a copy of the board, so every position stays the same) -----
+    run_bench("perform_move", [&]()
+              {
+        GameState &state = positions[pos_index++ % positions.size()];
+        Board board = *state.get_board();
+        Move mv = state.possible_moves[0];
+        mv.perform_move(&board, mv); });
+
+    // ----- one full random rollout -----
+    vector<MCTS_leaf *> leaves;
+    for (GameState &state : positions)
+    {
+        leaves.push_back(new MCTS_leaf(state, Move(-1, -1, -1, -1, false, -1, -1)));
+    }
+    run_bench("simulation", [&]()
+              { simulation(leaves[pos_index++ % leaves.size()]); });
+    for (MCTS_leaf *leaf : leaves)
+    {
+        delete leaf;
+    }
+
+    // ----- training from an empty tree at several budgets; one op is one train() call -----
+    for (int budget : {100, 1000, 10000})
+    {
+        run_bench("train_" + to_string(budget), [&]()
+                  {
+            MCTS_leaf *tree = new_default_tree();
+            train(tree, budget);
+            destroy_tree(tree); });
+    }
+
+    // ----- alpha-beta from the start position to a fixed depth, on 1, 2, 4, ... threads (Lazy SMP) -----
+    GameState start(Board(create_board("default")), PLAYER1);
+    int max_threads = max(1u, thread::hardware_concurrency());
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    {
+        string name = "alphabeta_depth12_t" + to_string(num_threads);
+        if (name.find(bench_filter) == string::npos)
+        {
+            continue;
+        }
+        ParallelAlphaBeta searcher(num_threads);
+        LazySMPResult last;
+        run_bench(name, [&]()
+                  {
+            searcher.clear();
+            last = searcher.search(start, 0, 12); });
+        printf("# %s: %s\n", name.c_str(), lazy_smp_summary(last).c_str());
+    }
+
+    // ----- saving and loading a big tree -----
+    // the tree is only grown if one of the benchmarks that use it is selected
+    const vector<string> tree_benchmarks = {
+        "save_tree_binary", "load_tree_binary", "map_tree_file", "save_tree_incremental", "take_checkpoint",
+        "merge_tree_files", "opening_book_probe", "load_tree_pruned"
+    };
+    if (any_of(tree_benchmarks.begin(), tree_benchmarks.end(), [](const string &name)
+               { return name.find(bench_filter) != string::npos; }))
+    {
+        srand(BENCH_SEED);
+        MCTS_leaf *big_tree = new_default_tree();
+        train(big_tree, BENCH_BIG_TREE_ITER);
+        const string file_name = "checkers_bench_tree.txt";
+        run_bench("save_tree", [&]()
+                  {
+            ofstream out(file_name);
+            save_tree(big_tree, out); });
+        string raw_input;
+        {
+            // load_tree needs the text file, even if save_tree was filtered out
+            ofstream out(file_name);
+            save_tree(big_tree, out);
+        }
+        {
+            ifstream in(file_name);
+            getline(in, raw_input);
+        }
+        run_bench("load_tree", [&]()
+                  {
+            MCTS_leaf *loaded = load_tree(raw_input);
+            destroy_tree(loaded); });
+        run_bench("save_tree_binary", [&]()
+                  {
+            ofstream out(file_name, ios::binary);
+            save_tree_binary(big_tree, out); });
+        {
+            // the benchmarks below need the binary file, even if save_tree_binary was filtered out
+            ofstream out(file_name, ios::binary);
+            save_tree_binary(big_tree, out);
+        }
+        string binary_input;
+        read_tree_file(file_name, binary_input);
+        run_bench("load_tree_binary", [&]()
+                  {
+            MCTS_leaf *loaded = load_tree(binary_input);
+            destroy_tree(loaded); });
+        // the same tree without its one-visit leaves (saved with --min-visits 2), loaded from text
+        SavePruning pruning;
+        pruning.min_visits = 2;
+        ostringstream pruned_binary_out;
+        save_tree_binary(big_tree, pruned_binary_out, &pruning);
+        string pruned_binary = pruned_binary_out.str();
+        ostringstream pruned_text_out;
+        save_tree(big_tree, pruned_text_out, &pruning);
+        string pruned_text = pruned_text_out.str();
+        run_bench("load_tree_pruned", [&]()
+                  {
+            MCTS_leaf *loaded = load_tree(pruned_text);
+            destroy_tree(loaded); });
+        printf("# pruned (min visits 2): %llu of %llu nodes, text file %zu bytes, binary file %zu bytes\n",
+               static_cast<unsigned long long>(pruning.nodes_written),
+               static_cast<unsigned long long>(pruning.nodes_written + pruning.nodes_dropped), pruned_text.size(), pruned_binary.size());
+        // mapping creates only the root; one selection() creates the nodes on one path
+        run_bench("map_tree_file", [&]()
+                  {
+            MCTS_leaf *mapped = map_tree_file(file_name);
+            selection(mapped);
+            destroy_tree(mapped); });
+        // one game (train iteration) on the mapped tree, then only its changes are appended to the journal
+        MCTS_leaf *journaled = map_tree_file(file_name);
+        run_bench("save_tree_incremental", [&]()
+                  {
+            train(journaled, 1);
+            save_tree_incremental(journaled, file_name); });
+        // what the server does while holding the tree lock: copy the changes of one game out of the tree
+        run_bench("take_checkpoint", [&]()
+                  {
+            train(journaled, 1);
+            TreeCheckpoint checkpoint = prepare_checkpoint(file_name);
+            take_checkpoint(journaled, checkpoint); });
+        destroy_tree(journaled);
+        remove((file_name + ".journal").c_str());
+        // two copies of the big tree (both mapped) into one file
+        run_bench("merge_tree_files", [&]()
+                  { merge_tree_files({file_name, file_name}, "checkers_bench_merged.bin"); });
+        remove("checkers_bench_merged.bin");
+        // the AI's move in an opening position: the book of the big tree, probed with the root and its children
+        ostringstream book_out;
+        export_book(big_tree, book_out, 10);
+        shared_ptr<OpeningBook> book = OpeningBook::from_buffer(book_out.str());
+        vector<GameState> book_positions = {big_tree->state};
+        for (MCTS_leaf *child : big_tree->children)
+        {
+            book_positions.push_back(child->state);
+        }
+        run_bench("opening_book_probe", [&]()
+                  {
+            Move best;
+            book->best_move(book_positions[pos_index++ % book_positions.size()], best); });
+        printf("# big tree: %d games, text file %zu bytes, binary file %zu bytes\n", big_tree->total_games, raw_input.size(), binary_input.size());
+        destroy_tree(big_tree);
+        remove(file_name.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,585 @@
+#include "bitbase.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#if OS_LINUX
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+#define BITBASE_UNRESOLVED 0 // generation: the result is not known yet
+#define BITBASE_IMPOSSIBLE 3 // generation: a man is on its promotion row
+#define BITBASE_CHUNK 4096   // positions a generator thread takes at once
+
+/** @brief Returns the row of a dark square (0-31). */
+static inline int square_y(int square)
+{
+    return square / 4;
+}
+
+/** @brief Returns the column of a dark square (0-31); the dark squares of a row are those with odd y + x. */
+static inline int square_x(int square)
+{
+    return 2 * (square % 4) + (square / 4 % 2 == 0 ? 1 : 0);
+}
+
+/** @brief Returns the binomial coefficient C(n, k) for n <= 32 and k <= BITBASE_MAX_PIECES; 0 if k > n. */
+static uint64_t binom(int n, int k)
+{
+    static const auto table = []
+    {
+        array<array<uint64_t, BITBASE_MAX_PIECES + 1>, 33> t{};
+        for (int i = 0; i <= 32; i++)
+        {
+            t[i][0] = 1;
+            for (int j = 1; j <= min(i, BITBASE_MAX_PIECES); j++)
+            {
+                t[i][j] = t[i - 1][j - 1] + t[i - 1][j];
+            }
+        }
+        return t;
+    }();
+    return table[n][k];
+}
+
+/** @brief Returns the number of pieces of group `g` (P1 men, P1 kings, P2 men, P2 kings). */
+static inline int group_size(const Material &material, int g)
+{
+    return g % 2 == 0 ? material.men[g / 2] : material.kings[g / 2];
+}
+
+/** @brief Reads a little endian integer of `num_bytes` bytes at `p`. */
+static uint64_t read_uint(const char *p, int num_bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+/** @brief Returns the path of the table of a material signature in `dir`. */
+static string table_path(const string &dir, const Material &material)
+{
+    return dir + "/bitbase_" + material.name() + ".bin";
+}
+
+// ----- indexing -----
+string Material::name() const
+{
+    return to_string(men[0]) + to_string(kings[0]) + to_string(men[1]) + to_string(kings[1]);
+}
+
+Material material_of(GameState &state)
+{
+    Material material;
+    Board *board = state.get_board();
+    for (int square = 0; square < 32; square++)
+    {
+        Piece *piece = board->get_Piece(square_y(square), square_x(square));
+        if (piece->get_id() == PLAYER1 || piece->get_id() == PLAYER2)
+        {
+            (piece->get_king() ? material.kings : material.men)[piece->get_id() - 1]++;
+        }
+    }
+    return material;
+}
+
+uint64_t bitbase_num_positions(const Material &material)
+{
+    uint64_t count = 2;
+    int free = 32;
+    for (int g = 0; g < 4; g++)
+    {
+        count *= binom(free, group_size(material, g));
+        free -= group_size(material, g);
+    }
+    return count;
+}
+
+uint64_t bitbase_index(GameState &state, const Material &material)
+{
+    // the squares of every group, in ascending order
+    int squares[4][BITBASE_MAX_PIECES];
+    int count[4] = {0, 0, 0, 0};
+    Board *board = state.get_board();
+    for (int square = 0; square < 32; square++)
+    {
+        Piece *piece = board->get_Piece(square_y(square), square_x(square));
+        if (piece->get_id() == PLAYER1 || piece->get_id() == PLAYER2)
+        {
+            int g = (piece->get_id() - 1) * 2 + (piece->get_king() ? 1 : 0);
+            squares[g][count[g]++] = square;
+        }
+    }
+    uint64_t index = 0;
+    uint32_t used = 0;
+    int free = 32;
+    for (int g = 0; g < 4; g++)
+    {
+        int n = group_size(material, g);
+        // rank of the combination among the squares the groups before left free
+        uint64_t rank = 0;
+        for (int j = 0; j < n; j++)
+        {
+            int ordinal = squares[g][j] - __builtin_popcount(used & ((1u << squares[g][j]) - 1));
+            rank += binom(ordinal, j + 1);
+        }
+        for (int j = 0; j < n; j++)
+        {
+            used |= 1u << squares[g][j];
+        }
+        index = index * binom(free, n) + rank;
+        free -= n;
+    }
+    return index * 2 + (state.get_current_player() == PLAYER2 ? 1 : 0);
+}
+
+bool bitbase_position(const Material &material, uint64_t index, GameState &state)
+{
+    int player = index % 2 == 0 ? PLAYER1 : PLAYER2;
+    index /= 2;
+    uint64_t ranks[4];
+    int free_before[4];
+    int free = 32;
+    for (int g = 0; g < 4; g++)
+    {
+        free_before[g] = free;
+        free -= group_size(material, g);
+    }
+    for (int g = 3; g >= 0; g--)
+    {
+        uint64_t size = binom(free_before[g], group_size(material, g));
+        ranks[g] = index % size;
+        index /= size;
+    }
+    array<array<Piece, 8>, 8> squares;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            squares[y][x] = Piece(NOPLAYER, y, x);
+        }
+    }
+    bool possible = true;
+    uint32_t used = 0;
+    for (int g = 0; g < 4; g++)
+    {
+        int id = g < 2 ? PLAYER1 : PLAYER2;
+        bool king = g % 2 == 1;
+        uint64_t rank = ranks[g];
+        int ordinal = free_before[g];
+        uint32_t group_used = 0;
+        for (int j = group_size(material, g); j > 0; j--)
+        {
+            // largest ordinal whose binomial still fits into the rest of the rank
+            do
+            {
+                ordinal--;
+            } while (binom(ordinal, j) > rank);
+            rank -= binom(ordinal, j);
+            // the ordinal-th free square
+            int square = 0;
+            for (int k = ordinal;; square++)
+            {
+                if ((used & (1u << square)) == 0 && k-- == 0)
+                {
+                    break;
+                }
+            }
+            group_used |= 1u << square;
+            squares[square_y(square)][square_x(square)] = Piece(id, square_y(square), square_x(square), king);
+            if (!king && square_y(square) == (id == PLAYER1 ? 7 : 0))
+            {
+                possible = false;
+            }
+        }
+        // mark the group only now, the ordinals of a group count the squares the groups before left free
+        used |= group_used;
+    }
+    state = GameState(Board(squares), player);
+    return possible;
+}
+
+// ----- probing -----
+shared_ptr<Bitbase> Bitbase::open(const string &dir)
+{
+    shared_ptr<Bitbase> bitbase = make_shared<Bitbase>();
+    // try every signature, so no directory listing is needed
+    Material material;
+    for (material.men[0] = 0; material.men[0] <= BITBASE_MAX_PIECES; material.men[0]++)
+        for (material.kings[0] = 0; material.kings[0] <= BITBASE_MAX_PIECES; material.kings[0]++)
+            for (material.men[1] = 0; material.men[1] <= BITBASE_MAX_PIECES; material.men[1]++)
+                for (material.kings[1] = 0; material.kings[1] <= BITBASE_MAX_PIECES; material.kings[1]++)
+                {
+                    if (material.men[0] + material.kings[0] == 0 || material.men[1] + material.kings[1] == 0 ||
+                        material.total() > BITBASE_MAX_PIECES)
+                    {
+                        continue;
+                    }
+                    shared_ptr<MappedFile> file = MappedFile::open(table_path(dir, material));
+                    if (file != nullptr)
+                    {
+                        bitbase->add_table(file);
+                    }
+                }
+    return bitbase->num_tables() > 0 ? bitbase : nullptr;
+}
+
+void Bitbase::add_table(shared_ptr<MappedFile> file)
+{
+    const char *data = file->data();
+    size_t size = file->size();
+    if (size < BITBASE_HEADER_SIZE + 8 || memcmp(data, BITBASE_MAGIC, 4) != 0)
+    {
+        throw runtime_error("Not a bitbase file.");
+    }
+    if (read_uint(data + 4, 2) != BITBASE_FORMAT_VERSION)
+    {
+        throw runtime_error("Unsupported bitbase version " + to_string(read_uint(data + 4, 2)) + ".");
+    }
+    Material material;
+    material.men[0] = static_cast<unsigned char>(data[8]);
+    material.kings[0] = static_cast<unsigned char>(data[9]);
+    material.men[1] = static_cast<unsigned char>(data[10]);
+    material.kings[1] = static_cast<unsigned char>(data[11]);
+    if (material.total() > BITBASE_MAX_PIECES || read_uint(data + 16, 8) != bitbase_num_positions(material) ||
+        size != BITBASE_HEADER_SIZE + (bitbase_num_positions(material) + 3) / 4 + 8)
+    {
+        throw runtime_error("Bitbase " + material.name() + " has a wrong size.");
+    }
+    if (read_uint(data + size - 8, 8) != fnv1a(data, size - 8))
+    {
+        throw runtime_error("Bitbase " + material.name() + " is corrupted (checksum mismatch).");
+    }
+    file->advise_random_access();
+    tables[material.key()] = file;
+    pieces = max(pieces, material.total());
+}
+
+int Bitbase::probe_index(const Material &material, uint64_t index) const
+{
+    auto it = tables.find(material.key());
+    if (it == tables.end())
+    {
+        return BITBASE_UNKNOWN;
+    }
+    unsigned char byte = static_cast<unsigned char>(it->second->data()[BITBASE_HEADER_SIZE + index / 4]);
+    return (byte >> (2 * (index % 4))) & 3;
+}
+
+int Bitbase::probe(GameState &state) const
+{
+    Board *board = state.get_board();
+    if (board->get_num_players(PLAYER1) + board->get_num_players(PLAYER2) > pieces)
+    {
+        return BITBASE_UNKNOWN;
+    }
+    Material material = material_of(state);
+    return probe_index(material, bitbase_index(state, material));
+}
+
+bool Bitbase::winner(GameState &state, int &winner) const
+{
+    int result = probe(state);
+    if (result == BITBASE_UNKNOWN)
+    {
+        return false;
+    }
+    int player = state.get_current_player();
+    int opponent = player == PLAYER1 ? PLAYER2 : PLAYER1;
+    winner = result == BITBASE_WIN ? player : (result == BITBASE_LOSS ? opponent : NOPLAYER);
+    return true;
+}
+
+// the bitbase of the engine; active_bitbase is read without the lock once loaded is set
+static mutex bitbase_mutex;
+static shared_ptr<Bitbase> bitbase_owner;
+static atomic<const Bitbase *> active_bitbase{nullptr};
+static atomic<bool> bitbase_loaded{false};
+
+const Bitbase *get_bitbase()
+{
+    if (!bitbase_loaded.load(memory_order_acquire))
+    {
+        lock_guard<mutex> lock(bitbase_mutex);
+        if (!bitbase_loaded.load(memory_order_relaxed))
+        {
+            try
+            {
+                bitbase_owner = Bitbase::open(BITBASE_DIR);
+            }
+            catch (const exception &e)
+            {
+                cerr << "Not using the endgame bitbase: " << e.what() << '\n';
+            }
+            active_bitbase.store(bitbase_owner.get(), memory_order_release);
+            bitbase_loaded.store(true, memory_order_release);
+        }
+    }
+    return active_bitbase.load(memory_order_acquire);
+}
+
+void set_bitbase(shared_ptr<Bitbase> bitbase)
+{
+    lock_guard<mutex> lock(bitbase_mutex);
+    bitbase_owner = bitbase;
+    active_bitbase.store(bitbase_owner.get(), memory_order_release);
+    bitbase_loaded.store(true, memory_order_release);
+}
+
+// ----- generation -----
+/**
+ * @brief Tries to resolve one position from the results of its successors.
+ * @param material The signature of the table being generated.
+ * @param index The position.
+ * @param values The results of the table being generated.
+ * @param done The tables that are already generated.
+ * @return BITBASE_WIN, BITBASE_LOSS or BITBASE_UNRESOLVED.
+ */
+static uint8_t resolve_position(const Material &material, uint64_t index, const atomic<uint8_t> *values, const Bitbase &done)
+{
+    GameState state(Board(), PLAYER1);
+    bitbase_position(material, index, state);
+    int player = state.get_current_player();
+    int opponent = player == PLAYER1 ? PLAYER2 : PLAYER1;
+    state.list_all_possible_moves(player);
+    if (state.possible_moves.empty())
+    {
+        // same as GameState::TerminalState()
+        return player == PLAYER1 ? BITBASE_WIN : BITBASE_LOSS;
+    }
+    bool all_won = true; // every move leads to a position the opponent wins
+    for (Move &move : state.possible_moves)
+    {
+        GameState child = state.clone();
+        child.switch_player();
+        move.perform_move(child.get_board(), move);
+        if (child.get_board()->get_num_players(opponent) == 0)
+        {
+            return BITBASE_WIN;
+        }
+        Material child_material = material_of(child);
+        uint64_t child_index = bitbase_index(child, child_material);
+        int result = child_material.key() == material.key() ? values[child_index].load(memory_order_relaxed)
+                                                              : done.probe_index(child_material, child_index);
+        if (result == BITBASE_LOSS)
+        {
+            return BITBASE_WIN;
+        }
+        all_won = all_won && result == BITBASE_WIN;
+    }
+    return all_won ? BITBASE_LOSS : BITBASE_UNRESOLVED;
+}
+
+/** @brief Solves the table of one material signature and writes it to `path`. */
+static BitbaseTableStats generate_table(const Material &material, const string &path, int threads, const Bitbase &done)
+{
+    auto start = chrono::steady_clock::now();
+    BitbaseTableStats stats;
+    stats.material = material;
+    stats.positions = bitbase_num_positions(material);
+    unique_ptr<atomic<uint8_t>[]> values(new atomic<uint8_t>[stats.positions]);
+    GameState state(Board(), PLAYER1);
+    for (uint64_t i = 0; i < stats.positions; i++)
+    {
+        values[i].store(bitbase_position(material, i, state) ? BITBASE_UNRESOLVED : BITBASE_IMPOSSIBLE, memory_order_relaxed);
+    }
+    // every pass resolves the positions that are one ply further from the end of the game
+    atomic<bool> changed{true};
+    while (changed.load())
+    {
+        changed.store(false);
+        stats.passes++;
+        atomic<uint64_t> next{0};
+        auto worker = [&]()
+        {
+            for (uint64_t begin = next.fetch_add(BITBASE_CHUNK); begin < stats.positions; begin = next.fetch_add(BITBASE_CHUNK))
+            {
+                uint64_t end = min<uint64_t>(begin + BITBASE_CHUNK, stats.positions);
+                for (uint64_t i = begin; i < end; i++)
+                {
+                    if (values[i].load(memory_order_relaxed) != BITBASE_UNRESOLVED)
+                    {
+                        continue;
+                    }
+                    uint8_t result = resolve_position(material, i, values.get(), done);
+                    if (result != BITBASE_UNRESOLVED)
+                    {
+                        values[i].store(result, memory_order_relaxed);
+                        changed.store(true, memory_order_relaxed);
+                    }
+                }
+            }
+        };
+        vector<thread> pool;
+        for (int t = 1; t < threads; t++)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (thread &t : pool)
+        {
+            t.join();
+        }
+    }
+
+    string buf(BITBASE_MAGIC, 4);
+    put_uint(buf, BITBASE_FORMAT_VERSION, 2);
+    put_uint(buf, 0, 2);
+    buf.push_back(static_cast<char>(material.men[0]));
+    buf.push_back(static_cast<char>(material.kings[0]));
+    buf.push_back(static_cast<char>(material.men[1]));
+    buf.push_back(static_cast<char>(material.kings[1]));
+    put_uint(buf, 0, 4);
+    put_uint(buf, stats.positions, 8);
+    size_t data_pos = buf.size();
+    buf.resize(data_pos + (stats.positions + 3) / 4, '\0');
+    for (uint64_t i = 0; i < stats.positions; i++)
+    {
+        uint8_t value = values[i].load(memory_order_relaxed);
+        if (value == BITBASE_WIN)
+        {
+            stats.wins++;
+        }
+        else if (value == BITBASE_LOSS)
+        {
+            stats.losses++;
+        }
+        else
+        {
+            // unresolved positions are draws, impossible ones are stored as draws too
+            stats.draws += value == BITBASE_UNRESOLVED;
+            value = BITBASE_DRAW;
+        }
+        buf[data_pos + i / 4] = static_cast<char>(buf[data_pos + i / 4] | (value << (2 * (i % 4))));
+    }
+    put_uint(buf, fnv1a(buf.data(), buf.size()), 8);
+
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path, ios::binary);
+        if (!out.is_open() || !out.write(buf.data(), buf.size()))
+        {
+            throw runtime_error("Unable to write " + tmp_path);
+        }
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        throw runtime_error("Unable to write " + path);
+    }
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+vector<BitbaseTableStats> generate_bitbases(const string &dir, int max_pieces, int threads,
+                                            const function<void(const BitbaseTableStats &)> &on_table)
+{
+    if (max_pieces > BITBASE_MAX_PIECES)
+    {
+        throw runtime_error("Bitbases support at most " + to_string(BITBASE_MAX_PIECES) + " pieces.");
+    }
+    if (threads <= 0)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+#if OS_LINUX
+    mkdir(dir.c_str(), 0755);
+#endif
+    // captures lead to fewer pieces and promotions to fewer men, so solve by pieces, then by men
+    vector<Material> order;
+    Material material;
+    for (int total = 2; total <= max_pieces; total++)
+        for (int men = 0; men <= total; men++)
+            for (material.men[0] = 0; material.men[0] <= men; material.men[0]++)
+            {
+                material.men[1] = men - material.men[0];
+                for (material.kings[0] = 0; material.kings[0] <= total - men; material.kings[0]++)
+                {
+                    material.kings[1] = total - men - material.kings[0];
+                    if (material.men[0] + material.kings[0] > 0 && material.men[1] + material.kings[1] > 0)
+                    {
+                        order.push_back(material);
+                    }
+                }
+            }
+    Bitbase done;
+    vector<BitbaseTableStats> all_stats;
+    for (const Material &m : order)
+    {
+        string path = table_path(dir, m);
+        all_stats.push_back(generate_table(m, path, threads, done));
+        // the finished table is read back mapped, so the memory of the generator is only the table being solved
+        done.add_table(MappedFile::open(path));
+        if (on_table)
+        {
+            on_table(all_stats.back());
+        }
+    }
+    return all_stats;
+}
+
+int bitbase_main(int argc, char *argv[])
+{
+    int pieces = BITBASE_DEFAULT_PIECES;
+    int threads = 0;
+    string dir = BITBASE_DIR;
+    for (int i = 0; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--pieces" && i + 1 < argc)
+        {
+            pieces = atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else
+        {
+            cerr << "usage: checkers_exec bitbase [--pieces N] [--threads T] [--out DIR]\n";
+            return 1;
+        }
+    }
+    if (pieces < 2 || pieces > BITBASE_MAX_PIECES)
+    {
+        cerr << "--pieces must be between 2 and " << BITBASE_MAX_PIECES << "\n";
+        return 1;
+    }
+    try
+    {
+        auto start = chrono::steady_clock::now();
+        vector<BitbaseTableStats> all_stats = generate_bitbases(dir, pieces, threads, [](const BitbaseTableStats &s)
+                                                                {
+            printf("bitbase_%s.bin: %llu positions, %llu wins, %llu losses, %llu draws, %d passes, %.1f ms\n",
+                   s.material.name().c_str(), static_cast<unsigned long long>(s.positions),
+                   static_cast<unsigned long long>(s.wins), static_cast<unsigned long long>(s.losses),
+                   static_cast<unsigned long long>(s.draws), s.passes, s.seconds * 1000);
+            fflush(stdout); });
+        uint64_t positions = 0;
+        for (const BitbaseTableStats &s : all_stats)
+        {
+            positions += s.positions;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("wrote %zu tables with %llu positions (up to %d pieces) to %s in %.1f s\n", all_stats.size(),
+               static_cast<unsigned long long>(positions), pieces, dir.c_str(), seconds);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
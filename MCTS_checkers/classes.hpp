@@ -14,6 +14,8 @@
 #include <fstream>
 #include <string>
 #include <cstring>
+#include <memory>
+#include <cstdint>
 
 /** @def OS_LINUX
  *  @brief Macro defined as 1 if compiling on Linux (GCC), 0 otherwise (assuming Windows). Used for OS-specific commands like clearing the screen.
@@ -122,7 +124,7 @@ https://gist.github.com/fnky/458719343aabd01cfb17a3a4f7296797
 
 using namespace std;
 
-// parameter C in the UCB-formula
+// parameter C in the UCB-formula; default of SearchParams::c
 extern double C;
 
 // forward declaration
@@ -131,6 +133,7 @@ class Board;
 class GameState;
 class MCTS_leaf;
 class Piece;
+class MappedTree;
 
 /**
  * @class Move
@@ -438,6 +441,15 @@ public:
      */
     void list_all_possible_moves(int player);
 
+    /**
+     * @brief Generates only the jumps of a player and stores them in `possible_moves`.
+     * Cheaper than `list_all_possible_moves`, because no other moves are generated; since jumps are mandatory,
+     * the result is the same whenever the player has a jump.
+     * @param player The ID of the player whose jumps are generated.
+     * @note `possible_moves` is empty afterwards if the player has no jump, which does not mean the game is over.
+     */
+    void list_all_captures(int player);
+
     /**
      * @brief Prints all possible moves stored in the GameState to the console.
      */
@@ -456,6 +468,13 @@ public:
     inline int get_current_player() const { return current_player; } /**< Returns the ID of the current player. */
 
     string get_state_info();
+
+    /**
+     * @brief Computes a 64 bit Zobrist hash of the position (pieces, kings and the player to move).
+     * The keys are generated from a fixed seed, so the hash is the same in every build and can be stored in files.
+     * @return The hash of the position.
+     */
+    uint64_t hash() const;
 };
 
 /**
@@ -478,6 +497,11 @@ public:
     vector<MCTS_leaf *> children; /**< Vector of pointers to child nodes. */
     int wins;                     /**< Number of simulated game wins passing through this node. */
     int total_games;              /**< Total number of simulated games passing through this node. */
+    shared_ptr<const MappedTree> mapped; /**< Mapped tree file that still holds the children of this node, nullptr once they are on the heap (see tree_format.hpp). */
+    uint32_t mapped_index = 0;           /**< Index of this node's record in `mapped`. */
+    int saved_wins = 0;                  /**< `wins` when the node was last loaded or written to the journal. */
+    int saved_games = 0;                 /**< `total_games` when the node was last loaded or written to the journal. */
+    bool dirty = true;                   /**< True for new nodes and nodes whose statistics changed since they were saved. */
 
     /**
      * @brief Constructs an MCTS_leaf node.
@@ -493,6 +517,14 @@ public:
      */
     MCTS_leaf(GameState s, Move mv, MCTS_leaf *p = nullptr, vector<MCTS_leaf *> c = {}, int w = 0, int tg = 0, bool ic = true, bool it = false) : state(s), move(mv), wins(w), total_games(tg), is_computer(ic), is_terminal(it), parent(p), children(c) {};
 
+    /** @brief Remembers the current statistics as saved and clears `dirty` (used by the loaders and the journal). */
+    void mark_saved()
+    {
+        saved_wins = wins;
+        saved_games = total_games;
+        dirty = false;
+    }
+
     /** @brief Returns the number of direct children of this node. */
     int num_children() { return children.size(); };
 
@@ -512,6 +544,10 @@ public:
     void print_move() { move.print_move(); } /**< Prints the move associated with this node. */
 
     string get_move_info() { return move.get_move_info(); } /**< Returns the move information as a string. */
+
+    Move get_move() const { return move; }                 /**< Returns the move that led to this node. */
+    bool get_is_terminal() const { return is_terminal; }   /**< Returns true if this node was saved as terminal. */
+    bool get_is_computer() const { return is_computer; }   /**< Returns true if the computer is to move in this node. */
     // string get_state_info() { return state.get_state_info(); } /**< Returns the game state information as a string. */
 };
 
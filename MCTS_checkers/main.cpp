@@ -8,6 +8,13 @@
  */
 #include "classes.hpp"
 #include "mcts_algorithm.hpp"
+#include "perft.hpp"
+#include "tree_format.hpp"
+#include "opening_book.hpp"
+#include "bitbase.hpp"
+#include "training.hpp"
+#include "selfplay.hpp"
+#include "alphabeta.hpp"
 #include <chrono>
 #include <limits>
 
@@ -28,10 +35,43 @@ using namespace std;
 void print_prj_banner();
 int choice1();
 int choice2();
-MCTS_leaf* select_most_visited_child(MCTS_leaf*);
+SearchParams load_search_params();
 
-int main()
+int main(int argc, char *argv[])
 {
+    // -------- command line modes (no menu, no banner) --------
+    if (argc > 1 && string(argv[1]) == "perft")
+    {
+        return perft_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "convert")
+    {
+        return convert_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "merge")
+    {
+        return merge_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "book")
+    {
+        return book_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "bitbase")
+    {
+        return bitbase_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "train")
+    {
+        return train_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "selfplay")
+    {
+        return selfplay_main(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "tune")
+    {
+        return tune_main(argc - 2, argv + 2);
+    }
     clear_screen();
     print_prj_banner();
     DEBUG_PRINT("Debug mode activated\n");
@@ -132,33 +172,6 @@ int main()
     return 0;
 }
 
-MCTS_leaf *select_most_visited_child(MCTS_leaf *root_node)
-{
-    if (root_node == nullptr || root_node->children.empty())
-    {
-        return root_node; // Return node itself if null or no children
-    }
-
-    MCTS_leaf *most_visited_child = nullptr;
-    int max_visits = -1; // Initialize max visits to handle nodes with 0 visits correctly
-    // Iterate through children to find the one with the most visits
-    for (MCTS_leaf *child : root_node->children)
-    {
-        if (child->total_games > max_visits)
-        {
-            max_visits = child->total_games;
-            most_visited_child = child;
-        }
-    }
-    // // If no child was selected (e.g., all have 0 visits), return the first child as a default.
-    // // This ensures we always return a child if children exist.
-    // if (most_visited_child == nullptr && !root_node->children.empty()) {
-    //      return root_node->children.front();
-    // }
-
-    return most_visited_child; // Return the child with the most visits
-}
-
 void print_prj_banner()
 {
     cout << BOLDBLUE <<
@@ -177,18 +190,18 @@ void print_prj_banner()
 // ------ SAVES AND DESTROYS TRREE -----
 int save_and_exit(MCTS_leaf* mcts_tree)
 {
-    ofstream output_file("mcts_tree.txt");
-    if (output_file.is_open())
-    {
-        save_tree(mcts_tree, output_file);
-        output_file.close();
-    }
-    else
+    // only the changed nodes are appended to the journal; the whole file is written when the journal gets too big
+    if (!save_tree_incremental(mcts_tree, "mcts_tree.txt"))
     {
         cout << "Unable to open file\n";
         destroy_tree(mcts_tree);
         return 1;
     }
+    if (journal_needs_compaction("mcts_tree.txt"))
+    {
+        DEBUG_PRINT("compacting the journal...\n");
+        compact_journal("mcts_tree.txt");
+    }
     DEBUG_PRINT("saved tree to file!\n");
     // destroy the tree
     destroy_tree(mcts_tree);
@@ -197,21 +210,37 @@ int save_and_exit(MCTS_leaf* mcts_tree)
     return 0;
 }
 
+// ------ SEARCH PARAMETERS -----
+SearchParams load_search_params()
+{
+    SearchParams params;
+    try
+    {
+        // written by `checkers_exec tune`; the defaults are used if there is no file
+        read_search_params(SEARCH_PARAMS_FILE, params);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << ", using the default search parameters\n";
+        params = SearchParams();
+    }
+    return params;
+}
+
 // ------ USER INTERACTION MODE -----
 int choice1()
 {
+    SearchParams params = load_search_params();
     // load the tree from file and reconstruct tree
     MCTS_leaf *mcts_tree;
     // if no tree is found, train the AI and save the tree to file and try again
     while (true)
     {
-        ifstream input_file("mcts_tree.txt");
-        if (input_file.is_open())
+        // binary files are mapped, only the nodes the game reaches are created
+        mcts_tree = open_tree_with_journal("mcts_tree.txt");
+        if (mcts_tree != nullptr)
         {
             cout << "loading tree from file...\n";
-            string raw_input;
-            getline(input_file, raw_input);
-            mcts_tree = load_tree(raw_input);
         }
         else
         {
@@ -258,6 +287,24 @@ int choice1()
         return save_and_exit(mcts_tree);
     }
 
+    // -------- ask which AI the player wants to play against --------
+    string engine_input;
+    while (true)
+    {
+        cout << "Which AI do you want to play against? [1] MCTS [2] alpha-beta: ";
+        cin >> engine_input;
+        if (cin.fail() || (engine_input != "1" && engine_input != "2"))
+        {
+            cin.clear();                                         // clear the error flag
+            cin.ignore(numeric_limits<streamsize>::max(), '\n'); // discard invalid input
+            cout << "Invalid input, please try again.\n";
+            continue;
+        }
+        break;
+    }
+    bool use_alphabeta = engine_input == "2";
+    AlphaBeta alphabeta;
+
     // --------- start the game ---------    
     clear_screen();
     MCTS_leaf* current_node = mcts_tree;
@@ -325,6 +372,7 @@ int choice1()
             string selected_move_str = current_node->state.possible_moves.at(usr_choice - 1).get_move_info();
             // select a move that has not been explored yet
             // load all of the children into a set
+            ensure_children(current_node);
             map<string, MCTS_leaf *> moves_children;
             for (MCTS_leaf *child : current_node->children)
             {
@@ -363,7 +411,7 @@ int choice1()
                 current_node = new_child;
 
                 // train the AI on this new node
-                train(current_node, 20);
+                train(current_node, params.reply_iterations, nullptr, params);
             }
             printf("board after your move:\n");
             current_node->state.get_board()->print_Board();
@@ -373,6 +421,18 @@ int choice1()
         else
         {
             cout << "AI's turn!\n";
+            if (use_alphabeta)
+            {
+                // the alpha-beta AI searches the position itself; the tree only follows the game
+                AlphaBetaResult result = alphabeta.search(current_node->state, AB_MOVE_SECONDS);
+                current_node = find_or_add_child(current_node, result.best);
+                cout << "AI selected move (depth " << result.depth << "): ";
+                current_node->print_move();
+                printf("board after AI's move:\n");
+                current_node->state.get_board()->print_Board();
+                cout << "--------------------------------------\n";
+                continue;
+            }
             // AI will play
             // select the best move from the MCTS tree
             MCTS_leaf* newnode = select_most_visited_child(current_node);
@@ -384,7 +444,7 @@ int choice1()
                 // we are not at the terminal state,
                 // which means the AI has not expolred this part of the tree yet.
                 // so we need to expand the tree by training the ai
-                train(newnode, 30);
+                train(newnode, params.move_iterations, nullptr, params);
                 // select the best child of the new node
                 newnode = select_most_visited_child(newnode);
             }
@@ -403,14 +463,11 @@ int choice1()
 int choice2()
 {
     // load the tree from file and reconstruct tree
-    ifstream input_file("mcts_tree.txt");
     MCTS_leaf *mcts_tree;
-    if (input_file.is_open())
+    mcts_tree = open_tree_with_journal("mcts_tree.txt");
+    if (mcts_tree != nullptr)
     {
         cout << "loading tree from file...\n";
-        string raw_input;
-        getline(input_file, raw_input);
-        mcts_tree = load_tree(raw_input);
     }
     else
     {
@@ -439,10 +496,12 @@ int choice2()
     // run mcts algorithm
     DEBUG_PRINT("-------------------------------------- STARTING TRAINING --------------------------------------\n");
     auto start = chrono::high_resolution_clock::now();
-    train(mcts_tree, num_iterations);
+    TrainStats stats;
+    train(mcts_tree, num_iterations, &stats, load_search_params());
     auto end = chrono::high_resolution_clock::now();
     auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
     DEBUG_PRINT("-------------------------------------- TRAINING DONE --------------------------------------\n");
+    print_train_stats(stats);
     cout << "simulated " << mcts_tree->total_games << " games" << " in " << duration.count() << " ms" << endl;
     cout << "Wins: " << mcts_tree->wins << endl;
     cout << "Win/Played Ratio: " << (double)mcts_tree->wins / mcts_tree->total_games * 100 << "%" << endl; 
@@ -1,32 +1,292 @@
 #include "mcts_algorithm.hpp"
+#include "tree_format.hpp"
+#include "alphabeta.hpp"
+#include "bitbase.hpp"
+#include <sstream>
 
 using namespace std;
 
+// statistics of the train() call running on this thread; nullptr if profiling is off
+thread_local TrainStats *active_train_stats = nullptr;
+
+// state of the random number generator of this thread; 0 if the thread uses rand()
+thread_local uint32_t thread_random_state = 0;
+
+void seed_thread_random(unsigned int seed)
+{
+    // xorshift never leaves a non-zero state, so 0 is free to mean "use rand()"
+    thread_random_state = seed;
+}
+
+unsigned int get_thread_random_state()
+{
+    return thread_random_state;
+}
+
+// parameters of the train() call running on this thread; nullptr outside of train()
+thread_local const SearchParams *active_search_params = nullptr;
+
+/** @brief Returns the parameters of the running train() call, or the defaults outside of it. */
+static const SearchParams &search_params()
+{
+    static const SearchParams defaults;
+    return active_search_params != nullptr ? *active_search_params : defaults;
+}
+
+bool read_search_params(const string &path, SearchParams &params)
+{
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    string line;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string key;
+        if (!(fields >> key) || key[0] == '#')
+        {
+            continue;
+        }
+        string value;
+        fields >> value;
+        try
+        {
+            if (key == "c")
+                params.c = stod(value);
+            else if (key == "rollout" && value == "random")
+                params.rollout = ROLLOUT_RANDOM;
+            else if (key == "rollout" && value == "promote")
+                params.rollout = ROLLOUT_PROMOTE;
+            else if (key == "rollout_cutoff")
+                params.rollout_cutoff = stoi(value);
+            else if (key == "reply_iterations")
+                params.reply_iterations = stoi(value);
+            else if (key == "move_iterations")
+                params.move_iterations = stoi(value);
+            else if (key == "new_tree_iterations")
+                params.new_tree_iterations = stoi(value);
+            else
+                throw invalid_argument(key);
+        }
+        catch (const logic_error &)
+        {
+            // stoi and stod throw invalid_argument or out_of_range
+            throw runtime_error("Invalid line in " + path + ": " + line);
+        }
+    }
+    return true;
+}
+
+bool write_search_params(const string &path, const SearchParams &params)
+{
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path);
+        if (!out.is_open())
+        {
+            return false;
+        }
+        out.precision(17);
+        out << "# search parameters (see SearchParams in mcts_algorithm.hpp)\n";
+        out << "c " << params.c << "\n";
+        out << "rollout " << (params.rollout == ROLLOUT_PROMOTE ? "promote" : "random") << "\n";
+        out << "rollout_cutoff " << params.rollout_cutoff << "\n";
+        out << "reply_iterations " << params.reply_iterations << "\n";
+        out << "move_iterations " << params.move_iterations << "\n";
+        out << "new_tree_iterations " << params.new_tree_iterations << "\n";
+        if (!out.good())
+        {
+            return false;
+        }
+    }
+    return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+/** @brief Returns a random number in [0, RAND_MAX] from the generator of this thread, or rand() if it has none. */
+static inline int mcts_random()
+{
+    if (thread_random_state == 0)
+    {
+        return rand();
+    }
+    // xorshift32
+    thread_random_state ^= thread_random_state << 13;
+    thread_random_state ^= thread_random_state >> 17;
+    thread_random_state ^= thread_random_state << 5;
+    return static_cast<int>(thread_random_state % (static_cast<uint32_t>(RAND_MAX) + 1));
+}
+
+// increments a counter of the active TrainStats, if there is one
+#define COUNT_STAT(FIELD, N)               \
+    if (active_train_stats != nullptr)     \
+    {                                      \
+        active_train_stats->FIELD += (N);  \
+    }
+
+// adds the time since phase_start to a timer of stats and restarts the phase clock
+#define PROFILE_PHASE(FIELD)                                 \
+    if (stats != nullptr)                                    \
+    {                                                        \
+        long long phase_end = now_ns();                      \
+        stats->FIELD += phase_end - phase_start;             \
+        phase_start = phase_end;                             \
+    }
+
+// current time in nanoseconds; only read when profiling is on
+static long long now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// visit counts below this use the lookup tables in select_best_child
+#define UCB_TABLE_SIZE 4096
+
+/**
+ * @brief Lookup tables for 1/n and 1/sqrt(n) with n < UCB_TABLE_SIZE.
+ * Built once on first use; index 0 is never read because unvisited children are handled separately.
+ */
+struct UCB_tables
+{
+    double inv[UCB_TABLE_SIZE];
+    double inv_sqrt[UCB_TABLE_SIZE];
+    UCB_tables()
+    {
+        inv[0] = 0;
+        inv_sqrt[0] = 0;
+        for (int n = 1; n < UCB_TABLE_SIZE; n++)
+        {
+            inv[n] = 1.0 / n;
+            inv_sqrt[n] = 1.0 / sqrt(static_cast<double>(n));
+        }
+    }
+};
+
+MCTS_leaf *find_or_add_child(MCTS_leaf *node, const Move &move)
+{
+    ensure_children(node);
+    Move new_move = move;
+    string move_info = new_move.get_move_info();
+    for (MCTS_leaf *child : node->children)
+    {
+        if (child->get_move_info() == move_info)
+        {
+            return child;
+        }
+    }
+    GameState new_game_state = node->state.clone();
+    new_game_state.switch_player();
+    new_move.perform_move(new_game_state.get_board(), new_move);
+    new_game_state.list_all_possible_moves(new_game_state.get_current_player());
+    MCTS_leaf *new_child = new MCTS_leaf(new_game_state, new_move, node);
+    node->children.push_back(new_child);
+    return new_child;
+}
+
 MCTS_leaf *select_best_child(MCTS_leaf *root_node)
 {
+    if (root_node != nullptr)
+    {
+        ensure_children(root_node);
+    }
     if (root_node == nullptr || root_node->children.size() == 0)
     {
         return root_node;
     }
-    // maximize for the current player, so we need to check the current player
-    int current_player = root_node->state.get_current_player(); // get the current player
-    MCTS_leaf *best_child = nullptr;             // initialize best child
+    static const UCB_tables tables;
+    // per-thread scratch buffers, so the statistics of all children are contiguous
+    thread_local vector<double> wins_buf, inv_buf, inv_sqrt_buf, rating_buf;
+
+    size_t num_children = root_node->children.size();
+    // an unvisited parent means all children are unvisited; unvisited children are rated infinity
+    // and the first one of them is picked (same as cal_rating())
+    if (root_node->total_games <= 0)
+    {
+        return root_node->children[0];
+    }
+    wins_buf.resize(num_children);
+    inv_buf.resize(num_children);
+    inv_sqrt_buf.resize(num_children);
+    rating_buf.resize(num_children);
 
-    // check all children and select the one with the highest UCB value
-    double max_rating = -1;                      // initialize max rating
-    for (MCTS_leaf *child : root_node->children) // loop through all children
+    // gather the statistics of the children into the buffers
+    for (size_t i = 0; i < num_children; i++)
     {
-        double calculated_rating = child->cal_rating(); // calculate the rating of the child
-        // check if the rating is greater than the max rating
-        if (calculated_rating > max_rating )
+        MCTS_leaf *child = root_node->children[i];
+        int nk = child->total_games;
+        if (nk == 0)
         {
-            max_rating = calculated_rating;
-            best_child = child;
+            // rated infinity, nothing can beat it
+            return child;
         }
+        wins_buf[i] = static_cast<double>(child->wins);
+        if (nk < UCB_TABLE_SIZE)
+        {
+            inv_buf[i] = tables.inv[nk];
+            inv_sqrt_buf[i] = tables.inv_sqrt[nk];
+        }
+        else
+        {
+            inv_buf[i] = 1.0 / nk;
+            inv_sqrt_buf[i] = 1.0 / sqrt(static_cast<double>(nk));
+        }
+    }
+
+    // UCB1: wins/nk + C * sqrt(log(np) / nk) = wins * (1/nk) + (C * sqrt(log(np))) * (1/sqrt(nk))
+    // the log only depends on the parent, so it is computed once per node instead of once per child
+    const double exploration = search_params().c * sqrt(log(static_cast<double>(root_node->total_games)));
+    const double *wins = wins_buf.data();
+    const double *inv = inv_buf.data();
+    const double *inv_sqrt = inv_sqrt_buf.data();
+    double *rating = rating_buf.data();
+    // branch-free loop over contiguous arrays, so the compiler can vectorize it
+    for (size_t i = 0; i < num_children; i++)
+    {
+        rating[i] = wins[i] * inv[i] + exploration * inv_sqrt[i];
     }
-    // root_node = best_child;
 
-    return best_child;
+    // pick the first child with the highest rating
+    size_t best_index = 0;
+    for (size_t i = 1; i < num_children; i++)
+    {
+        if (rating[i] > rating[best_index])
+        {
+            best_index = i;
+        }
+    }
+    return root_node->children[best_index];
+}
+
+MCTS_leaf *select_most_visited_child(MCTS_leaf *root_node)
+{
+    if (root_node != nullptr)
+    {
+        ensure_children(root_node);
+    }
+    if (root_node == nullptr || root_node->children.empty())
+    {
+        return root_node; // Return node itself if null or no children
+    }
+
+    MCTS_leaf *most_visited_child = nullptr;
+    int max_visits = -1; // Initialize max visits to handle nodes with 0 visits correctly
+    // Iterate through children to find the one with the most visits
+    for (MCTS_leaf *child : root_node->children)
+    {
+        if (child->total_games > max_visits)
+        {
+            max_visits = child->total_games;
+            most_visited_child = child;
+        }
+    }
+    return most_visited_child; // Return the child with the most visits
+}
+
+/** @brief Returns true if the endgame bitbase has the exact result of `state`; `winner` receives it. */
+static bool bitbase_winner(GameState &state, int &winner)
+{
+    const Bitbase *bitbase = get_bitbase();
+    return bitbase != nullptr && bitbase->winner(state, winner);
 }
 
 MCTS_leaf *selection(MCTS_leaf *root)
@@ -43,13 +303,31 @@ MCTS_leaf *selection(MCTS_leaf *root)
     if (root == nullptr) return nullptr;
     // iterative implementation
     MCTS_leaf *current_node = root;
+    ensure_children(current_node); // children still in a mapped file
     while(current_node->num_children() > 0)
     {
+        // nodes loaded from a file do not have their moves generated yet
+        if (current_node->state.possible_moves.empty())
+        {
+            current_node->state.list_all_possible_moves(current_node->state.get_current_player());
+            COUNT_STAT(move_generations, 1);
+        }
         if (current_node->state.TerminalState() != -1)
         {
             // if the game is over, break
             break;
         }
+        // below a position the bitbase has solved there is nothing to learn; simulation() returns its result
+        int winner;
+        if (current_node != root && bitbase_winner(current_node->state, winner))
+        {
+            break;
+        }
+        // stop at nodes that still have unexplored moves, so expansion() can add one of them
+        if (current_node->num_children() < current_node->state.num_possible_moves())
+        {
+            break;
+        }
         // select the best child
         MCTS_leaf* nextnode = select_best_child(current_node);
         if (nextnode == nullptr || nextnode == current_node) {
@@ -58,14 +336,17 @@ MCTS_leaf *selection(MCTS_leaf *root)
             break;
        }
        current_node = nextnode;
+       ensure_children(current_node);
     }
     return current_node;
 }
 
 MCTS_leaf *expansion(MCTS_leaf *root_node)
 {
+    ensure_children(root_node);
     // generate list of possible moves just to be sure
     root_node->state.list_all_possible_moves(root_node->state.get_current_player());
+    COUNT_STAT(move_generations, 1);
     // check if there are any possible moves
     int num_moves = root_node->state.possible_moves.size();
     Move new_move;
@@ -79,7 +360,7 @@ MCTS_leaf *expansion(MCTS_leaf *root_node)
     {
         // we haven't explored any of the children yet,
         // so we select a random move from the possible moves
-        int random_move_index = rand() % num_moves;
+        int random_move_index = mcts_random() % num_moves;
         new_move = root_node->state.possible_moves.at(random_move_index);
     }
     else
@@ -119,34 +400,92 @@ MCTS_leaf *expansion(MCTS_leaf *root_node)
     new_move.perform_move(tmp_board, new_move);
     // populate the possible moves of the new game state
     new_game_state.list_all_possible_moves(new_game_state.get_current_player());
+    COUNT_STAT(move_generations, 1);
     // create a new child node with the new game state and add to the tree
     MCTS_leaf *new_child = new MCTS_leaf(new_game_state, new_move, root_node);
+    COUNT_STAT(nodes_created, 1);
     root_node->children.push_back(new_child);
     return new_child;
 }
 
+/** @brief Returns the index of the first move in `state` that crowns a king, or -1 if there is none. */
+static int find_promoting_move(GameState &state)
+{
+    int player = state.get_current_player();
+    int last_row = player == PLAYER1 ? 7 : 0;
+    for (size_t i = 0; i < state.possible_moves.size(); i++)
+    {
+        const Move &move = state.possible_moves[i];
+        if (move.get_dest_y() == last_row && !state.get_board()->get_Piece(move.get_src_y(), move.get_src_x())->get_king())
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the player who is ahead when a rollout is cut off, or NOPLAYER if it is even.
+ * A pending exchange is played out first (jumps are mandatory), so the position is not scored in the middle of it.
+ */
+static int cutoff_winner(GameState &state)
+{
+    long long budget = AB_QS_NODES;
+    int score = quiescence(state, 0, -AB_INFINITY, AB_INFINITY, budget);
+    if (score == 0)
+    {
+        return NOPLAYER;
+    }
+    int player = state.get_current_player();
+    return score > 0 ? player : (player == PLAYER1 ? PLAYER2 : PLAYER1);
+}
+
 int simulation(MCTS_leaf *leaf_node)
 {
+    const SearchParams &params = search_params();
+    int plies = 0;
     // initialize a temporary game state
     GameState tmp_game_state = leaf_node->state.clone();
     // // change the player of the new game state
     // tmp_game_state.switch_player();
+    // clone() does not copy the possible moves, and TerminalState() needs them;
+    // without this every rollout ended before the first move
+    tmp_game_state.list_all_possible_moves(tmp_game_state.get_current_player());
+    COUNT_STAT(move_generations, 1);
     // status of the game
     int status = tmp_game_state.TerminalState();
     // while the game is not over, keep playing by executing random moves until the game is over
     // each state is not saved on the tree
     while (status == -1)
     {
+        // with few pieces left the bitbase knows the exact result, so the rest of the rollout is not played
+        int winner;
+        if (bitbase_winner(tmp_game_state, winner))
+        {
+            COUNT_STAT(bitbase_hits, 1);
+            return winner;
+        }
+        if (params.rollout_cutoff > 0 && plies >= params.rollout_cutoff)
+        {
+            // stop the rollout and score it by material, after the captures
+            return cutoff_winner(tmp_game_state);
+        }
+        plies++;
         // list all possible moves of the leaf node
         tmp_game_state.list_all_possible_moves(tmp_game_state.get_current_player());
+        COUNT_STAT(move_generations, 1);
         // check if there are any possible moves
         int num_moves = tmp_game_state.possible_moves.size();
         // if there are possible moves
         // create a new board and perform a random move on that
         if (num_moves > 0)
         {
-            // select a random move from the possible moves
-            int random_move_index = rand() % num_moves;
+            // select a random move from the possible moves (or a promotion, if the policy prefers them)
+            int random_move_index = params.rollout == ROLLOUT_PROMOTE ? find_promoting_move(tmp_game_state) : -1;
+            if (random_move_index < 0)
+            {
+                random_move_index = mcts_random() % num_moves;
+            }
             Move random_move = tmp_game_state.possible_moves.at(random_move_index);
             // DEBUG_PRINT("while simulating: chose random move: ");
             // random_move.print_move();
@@ -162,6 +501,8 @@ int simulation(MCTS_leaf *leaf_node)
             random_move.perform_move(tmp_board, random_move);
             // populate the possible moves of the new game state
             new_game_state.list_all_possible_moves(new_game_state.get_current_player());
+            COUNT_STAT(move_generations, 1);
+            COUNT_STAT(rollout_plies, 1);
             // set the new game state to the leaf node
             tmp_game_state = new_game_state;
         }
@@ -180,6 +521,7 @@ void backpropagation(MCTS_leaf *leaf_node, int result)
     {
         // update the total games and wins
         current_node->total_games++;
+        current_node->dirty = true; // for the journal
         int player_who_moved = (current_node->state.get_current_player() == PLAYER1) ? PLAYER2 : PLAYER1;
 
         if (player_who_moved == result)
@@ -195,17 +537,30 @@ void backpropagation(MCTS_leaf *leaf_node, int result)
     }
 }
 
-void train(MCTS_leaf *root_node, int num_iterations)
+void train(MCTS_leaf *root_node, int num_iterations, TrainStats *stats, const SearchParams &params)
 {
+    // make the counters in expansion() and simulation() count into stats
+    TrainStats *outer_stats = active_train_stats;
+    active_train_stats = stats;
+    // select_best_child() and simulation() read the parameters from here
+    const SearchParams *outer_params = active_search_params;
+    active_search_params = &params;
+    long long train_start = stats != nullptr ? now_ns() : 0;
+    long long phase_start = train_start;
     // run the MCTS algorithm for num_iterations
     for (int i = 0; i < num_iterations; i++)
     {
+        if (stats != nullptr)
+        {
+            phase_start = now_ns();
+        }
         // select
         MCTS_leaf *selected_node = selection(root_node);
         if (selected_node == nullptr)
         {
             selected_node = root_node;
         }
+        PROFILE_PHASE(selection_ns);
         DEBUG_PRINT("Selected!\n");
         DEBUG_PRINT("\tSelected Player: ");
         DEBUG_PRINT(selected_node->state.get_current_player());
@@ -215,7 +570,21 @@ void train(MCTS_leaf *root_node, int num_iterations)
         DEBUG_PRINT("\n");
         DEBUG_PRINT("Expanding and simulating...\n");
         // expand selected node
-        MCTS_leaf *expanded_node = expansion(selected_node);
+        // a solved position (see selection()) is not expanded; it is scored by simulation() directly
+        int solved_winner;
+        MCTS_leaf *expanded_node = selected_node != root_node && bitbase_winner(selected_node->state, solved_winner) ? nullptr : expansion(selected_node);
+        PROFILE_PHASE(expansion_ns);
+        if (stats != nullptr)
+        {
+            // depth of the node we simulate from, relative to the trained root
+            int depth = 0;
+            for (MCTS_leaf *node = expanded_node != nullptr ? expanded_node : selected_node; node != root_node && node != nullptr; node = node->parent)
+            {
+                depth++;
+            }
+            stats->max_depth = max(stats->max_depth, depth);
+            phase_start = now_ns();
+        }
         // if expanded_node is null, we have explored all children
         // and do not need to simulate any more
         if (expanded_node != nullptr)
@@ -229,12 +598,14 @@ void train(MCTS_leaf *root_node, int num_iterations)
             DEBUG_PRINT("\n");
             // simulate the game from the expanded node
             int result = simulation(expanded_node);
+            PROFILE_PHASE(simulation_ns);
             DEBUG_PRINT("\tSimulated!\n");
             DEBUG_PRINT("\tResult: Player ");
             DEBUG_PRINT(result);
             DEBUG_PRINT(" won\n");
             // backpropagate the result to the root node
             backpropagation(expanded_node, result);
+            PROFILE_PHASE(backpropagation_ns);
             DEBUG_PRINT("\tBackpropagated!\n");
         }
         // if the expanded node is null, continue with the selection
@@ -243,11 +614,13 @@ void train(MCTS_leaf *root_node, int num_iterations)
             // expanded_node = select_best_child(selected_node);
             DEBUG_PRINT("Expanded node is null, continuing with selected node...\n");
             int result = simulation(selected_node);
+            PROFILE_PHASE(simulation_ns);
             DEBUG_PRINT("\tSimulated!\n");
             DEBUG_PRINT("\tResult: Player ");
             DEBUG_PRINT(result);
             DEBUG_PRINT(" won\n");
             backpropagation(selected_node, result);
+            PROFILE_PHASE(backpropagation_ns);
             DEBUG_PRINT("\tBackpropagated!\n");
         } 
         // // update the rating of all of the nodes in the tree
@@ -255,11 +628,154 @@ void train(MCTS_leaf *root_node, int num_iterations)
         DEBUG_PRINT("----- Iteration ");
         DEBUG_PRINT(i);
         DEBUG_PRINT(" complete -----\n");
+        if (stats != nullptr)
+        {
+            stats->iterations++;
+        }
+    }
+    if (stats != nullptr)
+    {
+        stats->total_ns += now_ns() - train_start;
     }
+    active_train_stats = outer_stats;
+    active_search_params = outer_params;
     return;
 }
 
-void save_tree(MCTS_leaf *root_node, ofstream &out)
+void print_train_stats(const TrainStats &stats)
+{
+    // share of the phases in the total training time
+    double total = stats.total_ns > 0 ? static_cast<double>(stats.total_ns) : 1.0;
+    printf("---------- training profile ----------\n");
+    printf("iterations:        %lld\n", stats.iterations);
+    printf("total time:        %.3f ms\n", stats.total_ns / 1e6);
+    printf("  selection:       %.3f ms (%.1f%%)\n", stats.selection_ns / 1e6, 100.0 * stats.selection_ns / total);
+    printf("  expansion:       %.3f ms (%.1f%%)\n", stats.expansion_ns / 1e6, 100.0 * stats.expansion_ns / total);
+    printf("  simulation:      %.3f ms (%.1f%%)\n", stats.simulation_ns / 1e6, 100.0 * stats.simulation_ns / total);
+    printf("  backpropagation: %.3f ms (%.1f%%)\n", stats.backpropagation_ns / 1e6, 100.0 * stats.backpropagation_ns / total);
+    printf("move generations:  %lld\n", stats.move_generations);
+    printf("rollout plies:     %lld\n", stats.rollout_plies);
+    printf("nodes created:     %lld\n", stats.nodes_created);
+    printf("bitbase hits:      %lld\n", stats.bitbase_hits);
+    printf("max depth:         %d\n", stats.max_depth);
+    if (stats.total_ns > 0)
+    {
+        printf("iterations/s:      %.1f\n", stats.iterations * 1e9 / stats.total_ns);
+    }
+    printf("--------------------------------------\n");
+}
+
+// size of the buffer used by save_tree; it is written out whenever less than a node's worth is left
+#define SAVE_BUFFER_SIZE (1 << 16)
+#define SAVE_MAX_NODE_SIZE 2048 // the root node (64 pieces) is the longest, about 1.2 KB
+
+/**
+ * @brief Output buffer for save_tree; numbers are formatted in place with to_chars.
+ */
+struct TextWriter
+{
+    ostream &out;
+    vector<char> buf;
+    size_t len = 0;
+
+    TextWriter(ostream &o) : out(o), buf(SAVE_BUFFER_SIZE) {}
+
+    void flush()
+    {
+        out.write(buf.data(), len);
+        len = 0;
+    }
+
+    /** @brief Makes room for one more node. */
+    void reserve_node()
+    {
+        if (len + SAVE_MAX_NODE_SIZE > buf.size())
+        {
+            flush();
+        }
+    }
+
+    void put(char c) { buf[len++] = c; }
+
+    void put(const char *s, size_t n)
+    {
+        memcpy(buf.data() + len, s, n);
+        len += n;
+    }
+
+    void put_int(int value)
+    {
+        len = to_chars(buf.data() + len, buf.data() + buf.size(), value).ptr - buf.data();
+    }
+};
+
+/**
+ * @brief Writes one node exactly like MCTS_leaf::save_leaf does.
+ */
+static void write_leaf(TextWriter &w, MCTS_leaf *node)
+{
+    w.reserve_node();
+    if (node->parent == nullptr)
+    {
+        // r[g[b[p[id, y, x, king],...],current_player],
+        w.put("r[g[b[", 6);
+        Board *board = node->state.get_board();
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                if (y > 0 || x > 0)
+                {
+                    w.put(',');
+                }
+                const Piece &p = board->get_modifiable_piece(y, x);
+                w.put("p[", 2);
+                w.put_int(p.get_id());
+                w.put(", ", 2);
+                w.put_int(p.get_y());
+                w.put(", ", 2);
+                w.put_int(p.get_x());
+                w.put(", ", 2);
+                w.put(p.get_king() ? '1' : '0');
+                w.put(']');
+            }
+        }
+        w.put("],", 2);
+        w.put_int(node->state.get_current_player());
+        w.put("],", 2);
+    }
+    else
+    {
+        // c[m[src_y,src_x,dest_y,dest_x,jump,enemy_y,enemy_x],
+        Move mv = node->get_move();
+        w.put("c[m[", 4);
+        w.put_int(mv.get_src_y());
+        w.put(',');
+        w.put_int(mv.get_src_x());
+        w.put(',');
+        w.put_int(mv.get_dest_y());
+        w.put(',');
+        w.put_int(mv.get_dest_x());
+        w.put(',');
+        w.put(mv.get_jump_type() ? '1' : '0');
+        w.put(',');
+        w.put_int(mv.get_enemy_y());
+        w.put(',');
+        w.put_int(mv.get_enemy_x());
+        w.put("],", 2);
+    }
+    // wins,total_games,is_terminal,is_computer]
+    w.put_int(node->wins);
+    w.put(',');
+    w.put_int(node->total_games);
+    w.put(',');
+    w.put(node->get_is_terminal() ? '1' : '0');
+    w.put(',');
+    w.put(node->get_is_computer() ? '1' : '0');
+    w.put(']');
+}
+
+void save_tree(MCTS_leaf *root_node, ostream &out, SavePruning *pruning)
 {
     // save the tree
     if (root_node == nullptr)
@@ -267,101 +783,275 @@ void save_tree(MCTS_leaf *root_node, ofstream &out)
         out << "#";
         return;
     }
-    root_node->save_leaf(out);
-    for (MCTS_leaf *child : root_node->children)
+    TextWriter w(out);
+    // preorder with an explicit stack of (node, index of the next child to write);
+    // a node's "$" is written once all of its children are done
+    vector<pair<MCTS_leaf *, size_t>> stack;
+    uint64_t nodes_written = 1;
+    uint64_t nodes_dropped = 0;
+    ensure_children(root_node);
+    write_leaf(w, root_node);
+    stack.push_back({root_node, 0});
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back().first;
+        size_t next = stack.back().second++;
+        if (next == node->children.size())
+        {
+            w.reserve_node();
+            w.put('$');
+            stack.pop_back();
+            continue;
+        }
+        MCTS_leaf *child = node->children[next];
+        if (child == nullptr)
+        {
+            w.reserve_node();
+            w.put('#');
+            continue;
+        }
+        // the stack holds the path from the root, so the child is stack.size() plies below it
+        if (pruning != nullptr && !pruning->keep(child->total_games, static_cast<int>(stack.size())))
+        {
+            nodes_dropped += count_tree_nodes(child);
+            continue;
+        }
+        ensure_children(child);
+        write_leaf(w, child);
+        nodes_written++;
+        stack.push_back({child, 0});
+    }
+    w.flush();
+    if (pruning != nullptr)
     {
-        save_tree(child, out);
+        pruning->nodes_written = nodes_written;
+        pruning->nodes_dropped = nodes_dropped;
     }
-    out << "$";
-    return;
 }
 
-MCTS_leaf *load_tree_helper(MCTS_leaf *root_node, string &full_input)
+/**
+ * @brief Cursor over the text tree format.
+ * Every character is looked at once, numbers are read in place with from_chars.
+ */
+struct TextCursor
 {
-    // check for null_pointers
-    if (full_input[0] == '#')
+    string_view input;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const string &what) const
     {
-        full_input.erase(0, 1);
-        return nullptr;
+        throw runtime_error(what + " at position " + to_string(pos) + ".");
     }
-    // check for end of child list -- this would be an error
-    if (full_input[0] == '$')
+
+    char peek() const
     {
-        throw runtime_error("Unexpected $ found.");
+        if (pos >= input.size())
+        {
+            fail("Unexpected end of tree");
+        }
+        return input[pos];
     }
-    // verify beginning of string
-    size_t bracket_start = full_input.find('[');
-    if ((full_input[0] != 'r' && full_input[0] != 'c') || bracket_start == string::npos)
+
+    void expect(char c)
     {
-        throw runtime_error("Unexpected character found. Expected r[ or c[.");
+        if (peek() != c)
+        {
+            fail(string("Expected '") + c + "'");
+        }
+        pos++;
     }
 
-    // find matching end bracket
-    int tmp_counter = 1; // holds counter for bracket, so we can find matching bracket
-    size_t bracket_end = string::npos;
-    for (int i = bracket_start+1; i < full_input.length(); i++)
+    int read_int()
     {
-        if (full_input[i] == '[')
+        // Piece::info_to_file writes ", " between the fields
+        while (pos < input.size() && input[pos] == ' ')
         {
-            tmp_counter++;
+            pos++;
         }
-        else if (full_input[i] == ']')
+        int value = 0;
+        auto result = from_chars(input.data() + pos, input.data() + input.size(), value);
+        if (result.ec != errc())
         {
-            tmp_counter--;
+            fail("Expected a number");
         }
-        if (tmp_counter == 0)
+        pos = result.ptr - input.data();
+        return value;
+    }
+
+    /** @brief Reads "wins,total_games,is_terminal,is_computer]", the end of every node. */
+    void read_stats(int &wins, int &total_games, bool &is_terminal, bool &is_computer)
+    {
+        wins = read_int();
+        expect(',');
+        total_games = read_int();
+        expect(',');
+        is_terminal = read_int() != 0;
+        expect(',');
+        is_computer = read_int() != 0;
+        expect(']');
+    }
+};
+
+/**
+ * @brief Parses one node ("r[g...]" or "c[m...]", see MCTS_leaf::save_leaf) at the cursor.
+ * @param parent nullptr for the root node.
+ */
+static MCTS_leaf *parse_leaf(TextCursor &cur, MCTS_leaf *parent)
+{
+    int wins, total_games;
+    bool is_terminal, is_computer;
+    char type = cur.peek();
+    if (type == 'c' && parent != nullptr)
+    {
+        // c[m[src_y,src_x,dest_y,dest_x,jump,enemy_y,enemy_x],wins,total_games,is_terminal,is_computer]
+        cur.pos++;
+        cur.expect('[');
+        cur.expect('m');
+        cur.expect('[');
+        int v[7];
+        for (int i = 0; i < 7; i++)
         {
-            bracket_end = i;
-            break;
+            if (i > 0)
+            {
+                cur.expect(',');
+            }
+            v[i] = cur.read_int();
+        }
+        cur.expect(']');
+        cur.expect(',');
+        cur.read_stats(wins, total_games, is_terminal, is_computer);
+        Move new_move(v[0], v[1], v[2], v[3], v[4] != 0, v[5], v[6]);
+        // clone gamestate from the parent, switch the player and perform the move
+        GameState tmp_state = parent->state.clone();
+        tmp_state.switch_player();
+        new_move.perform_move(tmp_state.get_board(), new_move);
+        MCTS_leaf *new_leaf = new MCTS_leaf(tmp_state, new_move, parent, {}, wins, total_games, is_computer, is_terminal);
+        new_leaf->mark_saved();
+        return new_leaf;
+    }
+    if (type == 'r' && parent == nullptr)
+    {
+        // r[g[b[p[id, y, x, king],...64 pieces...],current_player],wins,total_games,is_terminal,is_computer]
+        cur.pos++;
+        cur.expect('[');
+        cur.expect('g');
+        cur.expect('[');
+        cur.expect('b');
+        cur.expect('[');
+        array<array<Piece, 8>, 8> board_data;
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                if (i > 0 || j > 0)
+                {
+                    cur.expect(',');
+                }
+                cur.expect('p');
+                cur.expect('[');
+                int player_id = cur.read_int();
+                cur.expect(',');
+                int y = cur.read_int();
+                cur.expect(',');
+                int x = cur.read_int();
+                cur.expect(',');
+                bool is_king = cur.read_int() != 0;
+                cur.expect(']');
+                board_data[i][j] = Piece(player_id, y, x, is_king);
+            }
         }
+        cur.expect(']');
+        cur.expect(',');
+        int curr_player = cur.read_int();
+        cur.expect(']');
+        cur.expect(',');
+        cur.read_stats(wins, total_games, is_terminal, is_computer);
+        GameState new_game_state(Board(board_data), curr_player);
+        MCTS_leaf *new_leaf = new MCTS_leaf(new_game_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, wins, total_games, is_computer, is_terminal);
+        new_leaf->mark_saved();
+        return new_leaf;
     }
-    if (bracket_end == string::npos)
+    if (type == '$')
     {
-        throw runtime_error("No matching end bracket found.");
+        cur.fail("Unexpected $ found");
     }
+    cur.fail("Invalid input format for MCTS_leaf");
+}
 
-    /* we have found our data */
-    // extract the data from the string
-    string to_pass = full_input.substr(0, bracket_end + 1);
-    // erase the data from the string
-    full_input.erase(0, bracket_end + 1);
-    // create new leaf
-
-    MCTS_leaf *new_leaf = load_leaf(to_pass, root_node);
-    new_leaf->parent = root_node;
-    // create all of the children
-    while (full_input[0] != '$')
+/**
+ * @brief Parses a node and its whole subtree ("node child child ... $") at the cursor.
+ * Uses an explicit stack of open nodes instead of recursion; on error the partial subtree is freed.
+ * @return The node, or nullptr for "#".
+ */
+static MCTS_leaf *parse_subtree(TextCursor &cur, MCTS_leaf *parent)
+{
+    if (cur.peek() == '#')
+    {
+        cur.pos++;
+        return nullptr;
+    }
+    MCTS_leaf *top = parse_leaf(cur, parent);
+    vector<MCTS_leaf *> open_nodes = {top};
+    try
     {
-        // load the next child
-        MCTS_leaf* child = load_tree_helper(new_leaf, full_input);
-        if (child != nullptr)
+        while (!open_nodes.empty())
         {
-            new_leaf->children.push_back(child);
+            char c = cur.peek();
+            if (c == '$')
+            {
+                // end of the children of the innermost open node
+                cur.pos++;
+                open_nodes.pop_back();
+            }
+            else if (c == '#')
+            {
+                cur.pos++;
+            }
+            else
+            {
+                MCTS_leaf *child = parse_leaf(cur, open_nodes.back());
+                open_nodes.back()->children.push_back(child);
+                open_nodes.push_back(child);
+            }
         }
     }
-    // we have hit a $ (this should be the case)
-    full_input.erase(0, 1); // erase the $
+    catch (const exception &e)
+    {
+        destroy_tree(top);
+        throw;
+    }
+    return top;
+}
+
+MCTS_leaf *load_leaf(string params, MCTS_leaf *parent)
+{
+    TextCursor cur{params};
+    return parse_leaf(cur, parent);
+}
 
-    // return the reconstructed leaf
+MCTS_leaf *load_tree_helper(MCTS_leaf *root_node, string &full_input)
+{
+    TextCursor cur{full_input};
+    MCTS_leaf *new_leaf = parse_subtree(cur, root_node);
+    // the caller expects the parsed part to be consumed
+    full_input.erase(0, cur.pos);
     return new_leaf;
 }
 
-MCTS_leaf * load_tree(string full_input)
+MCTS_leaf *load_tree(string full_input)
 {
-    MCTS_leaf* root_node = nullptr;
     try
     {
-        root_node = load_tree_helper(root_node, full_input);
-        return root_node;
+        if (is_binary_tree(full_input))
+        {
+            return load_tree_binary(full_input);
+        }
+        TextCursor cur{full_input};
+        return parse_subtree(cur, nullptr);
     }
     catch (const exception &e)
     {
         cerr << e.what() << '\n';
-        // clean up the tree if one was created
-        if (root_node != nullptr)
-        {
-            destroy_tree(root_node);
-        }
         return nullptr;
     }
 }
@@ -373,25 +1063,24 @@ void destroy_tree(MCTS_leaf *root_node)
         return;
     }
 
-    // Create a copy of the children pointers
-    vector<MCTS_leaf *> children_to_delete = root_node->children;
-    // Clear the original vector 
-    root_node->children.clear();
-
-    // Recursively delete using the copied pointers
-    for (MCTS_leaf *child : children_to_delete)
+    // walk the tree with an explicit stack instead of recursing once per level,
+    // so deep trees grown by long rollouts cannot overflow the call stack
+    vector<MCTS_leaf *> to_delete;
+    to_delete.push_back(root_node);
+    while (!to_delete.empty())
     {
-        // Add an extra null check just in case, though ideally unnecessary
-        if (child != nullptr)
+        MCTS_leaf *current_node = to_delete.back();
+        to_delete.pop_back();
+        // hand the children over to the stack without copying the vector
+        for (MCTS_leaf *child : current_node->children)
         {
-            destroy_tree(child);
+            if (child != nullptr)
+            {
+                to_delete.push_back(child);
+            }
         }
+        delete current_node;
     }
-
-    // Delete the current node
-    delete root_node;
-
-    // No return needed for void function
 }
 
 array<array<Piece, 8>, 8> create_board(string choice)
@@ -401,9 +1090,9 @@ array<array<Piece, 8>, 8> create_board(string choice)
         // Minimal board for testing jumps
         array<array<Piece, 8>, 8> m_board_j = {{{Piece(NOPLAYER, 0, 0), Piece(NOPLAYER, 0, 1), Piece(NOPLAYER, 0, 2), Piece(NOPLAYER, 0, 3), Piece(NOPLAYER, 0, 4), Piece(NOPLAYER, 0, 5), Piece(NOPLAYER, 0, 6), Piece(NOPLAYER, 0, 7)},
                                                 {Piece(NOPLAYER, 1, 0), Piece(NOPLAYER, 1, 1), Piece(NOPLAYER, 1, 2), Piece(NOPLAYER, 1, 3), Piece(NOPLAYER, 1, 4), Piece(NOPLAYER, 1, 5), Piece(NOPLAYER, 1, 6), Piece(NOPLAYER, 1, 7)},
-                                                {Piece(NOPLAYER, 2, 0), Piece(NOPLAYER, 2, 1), Piece(NOPLAYER, 2, 2), Piece(NOPLAYER, 2, 3), Piece(NOPLAYER, 2, 4), Piece(NOPLAYER, 2, 5), Piece(NOPLAYER, 2, 6), Piece(NOPLAYER, 2, 7)},
+                                                {Piece(NOPLAYER, 2, 0), Piece(NOPLAYER, 2, 1), Piece(NOPLAYER, 2, 2), Piece(PLAYER1, 2, 3), Piece(NOPLAYER, 2, 4), Piece(NOPLAYER, 2, 5), Piece(NOPLAYER, 2, 6), Piece(NOPLAYER, 2, 7)},
                                                 {Piece(NOPLAYER, 3, 0), Piece(NOPLAYER, 3, 1), Piece(PLAYER2, 3, 2), Piece(NOPLAYER, 3, 3), Piece(NOPLAYER, 3, 4), Piece(NOPLAYER, 3, 5), Piece(NOPLAYER, 3, 6), Piece(NOPLAYER, 3, 7)},
-                                                {Piece(NOPLAYER, 4, 0), Piece(PLAYER1, 4, 1), Piece(NOPLAYER, 4, 2), Piece(NOPLAYER, 4, 3), Piece(NOPLAYER, 4, 4), Piece(NOPLAYER, 4, 5), Piece(NOPLAYER, 4, 6), Piece(NOPLAYER, 4, 7)},
+                                                {Piece(NOPLAYER, 4, 0), Piece(NOPLAYER, 4, 1), Piece(NOPLAYER, 4, 2), Piece(NOPLAYER, 4, 3), Piece(NOPLAYER, 4, 4), Piece(NOPLAYER, 4, 5), Piece(NOPLAYER, 4, 6), Piece(NOPLAYER, 4, 7)},
                                                 {Piece(NOPLAYER, 5, 0), Piece(NOPLAYER, 5, 1), Piece(NOPLAYER, 5, 2), Piece(NOPLAYER, 5, 3), Piece(NOPLAYER, 5, 4), Piece(NOPLAYER, 5, 5), Piece(NOPLAYER, 5, 6), Piece(NOPLAYER, 5, 7)},
                                                 {Piece(NOPLAYER, 6, 0), Piece(NOPLAYER, 6, 1), Piece(NOPLAYER, 6, 2), Piece(NOPLAYER, 6, 3), Piece(NOPLAYER, 6, 4), Piece(NOPLAYER, 6, 5), Piece(NOPLAYER, 6, 6), Piece(NOPLAYER, 6, 7)},
                                                 {Piece(NOPLAYER, 7, 0), Piece(NOPLAYER, 7, 1), Piece(NOPLAYER, 7, 2), Piece(NOPLAYER, 7, 3), Piece(NOPLAYER, 7, 4), Piece(NOPLAYER, 7, 5), Piece(NOPLAYER, 7, 6), Piece(NOPLAYER, 7, 7)}}};
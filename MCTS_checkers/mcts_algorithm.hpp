@@ -2,8 +2,12 @@
 #define MCTS_ALGORITHM_HPP
 
 #include "classes.hpp"
+#include "tree_format.hpp"
 #include <unordered_set>
 #include <map>
+#include <string_view>
+#include <charconv>
+#include <chrono>
 
 
 using namespace std;
@@ -12,18 +16,38 @@ using namespace std;
  * @brief Selects the child node with the highest UCB rating.
  *
  * Iterates through the children of the given node and returns the one with the maximum rating.
+ * Unvisited children are rated infinity, so the first unvisited child is returned right away.
+ * Otherwise `log(parent visits)` is computed once, the statistics of all children are gathered into
+ * contiguous buffers and 1/n, 1/sqrt(n) are taken from lookup tables for small visit counts.
  * If the node has no children, it will return the node itself.
+ * The exploration constant is the one of the running `train()` call, or C outside of it.
  * @param root_node The parent node whose children are to be evaluated.
  * @return Pointer to the child node with the highest UCB rating or the input node if no children.
  */
 MCTS_leaf *select_best_child(MCTS_leaf*);
 
+/**
+ * @brief Selects the child that was visited most often, i.e. the move the AI plays after training.
+ * @param root_node The node whose children are compared.
+ * @return The most visited child, or the input node if it is nullptr or has no children.
+ */
+MCTS_leaf *select_most_visited_child(MCTS_leaf*);
+
+/**
+ * @brief Returns the child of a node that is reached with the given move and creates it if it does not exist yet.
+ * @param node The parent node.
+ * @param move The move; it must be legal in the state of the node.
+ * @return Pointer to the child node.
+ */
+MCTS_leaf *find_or_add_child(MCTS_leaf *node, const Move &move);
+
 /**
  * @brief Performs the selection phase of the MCTS algorithm.
  *
  * Recursively traverses the tree starting from the root, always choosing the child
  * with the highest UCB rating (using `select_best_child`) until a leaf node
- * (a node with no children) is reached.
+ * (a node with no children), a terminal node or a node with unexplored moves is reached.
+ * It also stops below the root at a position the endgame bitbase (`get_bitbase`) has solved.
  * @param root The starting node for the selection process (usually the tree root).
  * @return Pointer to the selected leaf node.
  */
@@ -42,16 +66,79 @@ MCTS_leaf *selection(MCTS_leaf*);
  */
 MCTS_leaf *expansion(MCTS_leaf*);
 
+/**
+ * @brief Gives the calling thread its own random number generator for expansion and simulation.
+ * Threads without one use rand(), which is shared by all threads and takes a lock on every call.
+ * @param seed Seed (or a state returned by `get_thread_random_state`); the same seed gives the same games.
+ * 0 switches the thread back to rand().
+ */
+void seed_thread_random(unsigned int seed);
+
+/**
+ * @brief Returns the current state of the generator of the calling thread (0 if it uses rand()).
+ * Passing it to `seed_thread_random` later continues with the same numbers.
+ */
+unsigned int get_thread_random_state();
+
+/** @def ROLLOUT_RANDOM
+ *  @brief Rollout policy: every move of a simulation is chosen at random.
+ */
+#define ROLLOUT_RANDOM 0
+/** @def ROLLOUT_PROMOTE
+ *  @brief Rollout policy: a move that crowns a king is played whenever there is one, otherwise a random move.
+ */
+#define ROLLOUT_PROMOTE 1
+
+/** @def SEARCH_PARAMS_FILE
+ *  @brief Config file with the search parameters; the game and the server read it at startup if it exists.
+ */
+#define SEARCH_PARAMS_FILE "search_params.cfg"
+
+/**
+ * @struct SearchParams
+ * @brief Parameters of the search, passed to `train()`.
+ *
+ * Written by `checkers_exec tune` as a text file with one `key value` line per parameter
+ * (c, rollout, rollout_cutoff, reply_iterations, move_iterations, new_tree_iterations); lines starting with # are comments.
+ */
+struct SearchParams
+{
+    double c = C;                     /**< Exploration constant of the UCB formula. */
+    int rollout = ROLLOUT_RANDOM;     /**< Rollout policy (ROLLOUT_RANDOM or ROLLOUT_PROMOTE). */
+    int rollout_cutoff = 0;           /**< Plies after which a rollout stops and the side that is ahead after the captures wins; 0 plays to the end. */
+    int reply_iterations = 20;        /**< Iterations after the opponent played a move the tree did not have. */
+    int move_iterations = 30;         /**< Iterations before the AI moves from a node without children. */
+    int new_tree_iterations = 1000;   /**< Iterations a newly created tree is trained for. */
+};
+
+/**
+ * @brief Reads a search parameter file; keys that are not in the file keep their values.
+ * @param path Path of the file.
+ * @param params Receives the parameters.
+ * @throws runtime_error on an unknown key or an invalid value.
+ * @return false if the file can not be opened.
+ */
+bool read_search_params(const string &path, SearchParams &params);
+
+/**
+ * @brief Writes a search parameter file (to a temporary file that is renamed over `path`).
+ * @return true on success.
+ */
+bool write_search_params(const string &path, const SearchParams &params);
+
 /**
  * @brief Performs the simulation (playout) phase of the MCTS algorithm.
  *
  * Starting from the game state of the given leaf node, it simulates a complete game
- * by repeatedly choosing random moves for the current player until a terminal state is reached.
+ * by repeatedly choosing moves for the current player (see `SearchParams::rollout`) until a terminal state is reached
+ * or `SearchParams::rollout_cutoff` plies were played; then the pending captures are played out (`quiescence`)
+ * and the side that is ahead by `evaluate` (material, kings count 1.5 men) wins.
+ * As soon as a position of the game is in the endgame bitbase (`get_bitbase`), its exact result is returned instead.
  * The simulation does not modify the MCTS tree itself.
  *
  * @param leaf_node The node from which to start the simulation (usually the node added during expansion).
  * @return int The result of the simulated game: PLAYER1 (1) if Player 1 wins, PLAYER2 (2) if Player 2 wins,
- *         or NOPLAYER (0) for a draw (as determined by `GameState::TerminalState`).
+ *         or NOPLAYER (0) for a draw (as determined by `GameState::TerminalState`, or equal material at the cutoff).
  */
 int simulation(MCTS_leaf*);
 
@@ -78,6 +165,28 @@ void backpropagation(MCTS_leaf*, int);
 //  */
 // void update_rating(MCTS_leaf*);
 
+/**
+ * @struct TrainStats
+ * @brief Counters and timers collected by `train()` when profiling is requested.
+ *
+ * All times are in nanoseconds (measured with steady_clock). The values are added up,
+ * so the same object can be passed to several `train()` calls.
+ */
+struct TrainStats
+{
+    long long iterations = 0;         /**< Number of finished MCTS iterations. */
+    long long total_ns = 0;           /**< Wall time spent inside train(). */
+    long long selection_ns = 0;       /**< Time spent in selection(). */
+    long long expansion_ns = 0;       /**< Time spent in expansion(). */
+    long long simulation_ns = 0;      /**< Time spent in simulation(). */
+    long long backpropagation_ns = 0; /**< Time spent in backpropagation(). */
+    long long move_generations = 0;   /**< Calls to GameState::list_all_possible_moves(). */
+    long long rollout_plies = 0;      /**< Random moves played during simulations. */
+    long long nodes_created = 0;      /**< New nodes added to the tree by expansion(). */
+    long long bitbase_hits = 0;       /**< Simulations that were ended by the endgame bitbase. */
+    int max_depth = 0;                /**< Deepest node (relative to the trained root) that was simulated from. */
+};
+
 /**
  * @brief Runs the complete MCTS process for a specified number of iterations.
  *
@@ -86,8 +195,17 @@ void backpropagation(MCTS_leaf*, int);
  *
  * @param root_node The root node of the MCTS tree.
  * @param num_iterations The number of MCTS iterations to perform.
+ * @param stats Optional; if not nullptr, the phase timers and counters are added to it.
+ * Without it no clock is read and nothing is counted.
+ * @param params Exploration constant and rollout settings of the search.
+ */
+void train(MCTS_leaf*, int, TrainStats* = nullptr, const SearchParams &params = SearchParams());
+
+/**
+ * @brief Prints the counters and the time per phase collected by `train()`.
+ * @param stats The collected statistics.
  */
-void train(MCTS_leaf*, int);
+void print_train_stats(const TrainStats&);
 
 /**
  * @brief loads a leaf node from given input string
@@ -101,13 +219,16 @@ MCTS_leaf* load_leaf(string params,MCTS_leaf*);
  * @brief Saves the current state of the MCTS tree to a json file
  * The first node (root node) saves everything (gamestate, board, ...).
  * The rest of the nodes just save the moves (and other metadata), because the gamestate can then be reconstructed from the root node.
+ * The nodes are written iteratively into a buffer (same text as `MCTS_leaf::save_leaf`), which is passed to the stream in 64 KB blocks.
  * @param root_node The root node of the MCTS tree. 
  * @param out The output stream to write the tree data to.
+ * @param pruning If given, only the nodes it keeps are written (see `SavePruning`), and it receives the node counts.
  */
-void save_tree(MCTS_leaf*,ofstream&);
+void save_tree(MCTS_leaf*,ostream&,SavePruning *pruning = nullptr);
 
 /**
  * @brief loads tree from a file
+ * Binary files (see tree_format.hpp) are detected by their header and loaded with `load_tree_binary`.
  * @param string The whole, unfiltered input file as a string.
  * @return Pointer to the root node of the loaded tree.
  */
@@ -115,17 +236,18 @@ MCTS_leaf* load_tree(string);
 
 /**
  * @brief deletes the whole tree, freeing up the used memory
+ * The tree is walked iteratively with an explicit stack, so the depth of the tree does not matter.
  * @param root_node The root node of the MCTS tree.
  */
 void destroy_tree(MCTS_leaf*);
 
 /**
  * @brief Function to load a tree from a string.
- * Recursively reconstructs the MCTS tree from the string
+ * Reconstructs the MCTS tree from the string in a single pass, with an explicit stack instead of recursion.
  * @param root_node The parent node to which the new leaf will be added.
  * @param full_input The input string containing the leaf node data.
  * @throws runtime_error if any of the data is invalid.
- * @note This is a helper function for `load_tree`.
+ * @note The parsed part is erased from `full_input`.
  * @return MCTS_leaf* 
  */
 MCTS_leaf *load_tree_helper(MCTS_leaf*, string&);
@@ -0,0 +1,290 @@
+#include "opening_book.hpp"
+#include "mcts_algorithm.hpp"
+#include "tree_format.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+
+using namespace std;
+
+#define BOOK_FLAG_JUMP 1 // the move is a jump
+
+/** @brief Reads a little endian integer of `num_bytes` bytes at `p`. */
+static uint64_t read_uint(const char *p, int num_bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++)
+    {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+// ----- reading -----
+shared_ptr<OpeningBook> OpeningBook::open(const string &path)
+{
+    shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (file == nullptr)
+    {
+        return nullptr;
+    }
+    shared_ptr<OpeningBook> book = make_shared<OpeningBook>();
+    book->parse(file);
+    return book;
+}
+
+shared_ptr<OpeningBook> OpeningBook::from_buffer(string content)
+{
+    shared_ptr<OpeningBook> book = make_shared<OpeningBook>();
+    book->parse(MappedFile::from_buffer(std::move(content)));
+    return book;
+}
+
+void OpeningBook::parse(shared_ptr<MappedFile> mapped_file)
+{
+    file = mapped_file;
+    const char *data = file->data();
+    size_t size = file->size();
+    if (size < BOOK_HEADER_SIZE + 8 || memcmp(data, BOOK_MAGIC, 4) != 0)
+    {
+        throw runtime_error("Not an opening book file.");
+    }
+    if (read_uint(data + 4, 2) != BOOK_FORMAT_VERSION)
+    {
+        throw runtime_error("Unsupported opening book version " + to_string(read_uint(data + 4, 2)) + ".");
+    }
+    num_positions = read_uint(data + 8, 8);
+    num_moves = read_uint(data + 16, 8);
+    // checked in this order, so the products can not overflow for any size that fits the file
+    if (num_positions > size / BOOK_POSITION_SIZE || num_moves > size / BOOK_MOVE_SIZE ||
+        BOOK_HEADER_SIZE + num_positions * BOOK_POSITION_SIZE + num_moves * BOOK_MOVE_SIZE + 8 != size)
+    {
+        throw runtime_error("Opening book has the wrong size.");
+    }
+    if (read_uint(data + size - 8, 8) != fnv1a(data, size - 8))
+    {
+        throw runtime_error("Opening book checksum mismatch.");
+    }
+}
+
+vector<BookMove> OpeningBook::probe(const GameState &state) const
+{
+    vector<BookMove> moves;
+    uint64_t key = state.hash();
+    const char *positions = file->data() + BOOK_HEADER_SIZE;
+    const char *move_table = positions + num_positions * BOOK_POSITION_SIZE;
+    // binary search for the first position with a key >= `key`
+    uint64_t low = 0;
+    uint64_t high = num_positions;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if (read_uint(positions + mid * BOOK_POSITION_SIZE, 8) < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if (low == num_positions || read_uint(positions + low * BOOK_POSITION_SIZE, 8) != key)
+    {
+        return moves;
+    }
+    const char *entry = positions + low * BOOK_POSITION_SIZE;
+    uint64_t first_move = read_uint(entry + 8, 4);
+    uint64_t count = read_uint(entry + 12, 2);
+    if (first_move + count > num_moves)
+    {
+        throw runtime_error("Invalid move index in opening book.");
+    }
+    for (uint64_t i = first_move; i < first_move + count; i++)
+    {
+        const char *mv = move_table + i * BOOK_MOVE_SIZE;
+        uint8_t flags = static_cast<uint8_t>(mv[1]);
+        moves.push_back({decode_move(static_cast<uint8_t>(mv[0]), flags & BOOK_FLAG_JUMP),
+                         static_cast<uint32_t>(read_uint(mv + 4, 4)), static_cast<uint32_t>(read_uint(mv + 8, 4))});
+    }
+    return moves;
+}
+
+bool OpeningBook::best_move(const GameState &state, Move &best) const
+{
+    vector<BookMove> moves = probe(state);
+    if (moves.empty())
+    {
+        return false;
+    }
+    // a hash collision could return moves of another position, so only legal moves are played
+    GameState current = state;
+    current.list_all_possible_moves(current.get_current_player());
+    bool found = false;
+    uint32_t best_visits = 0;
+    for (BookMove &book_move : moves)
+    {
+        if (found && book_move.visits <= best_visits)
+        {
+            continue;
+        }
+        for (Move &legal : current.possible_moves)
+        {
+            if (legal.get_move_info() == book_move.move.get_move_info())
+            {
+                best = legal;
+                best_visits = book_move.visits;
+                found = true;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+// ----- writing -----
+/** @brief Statistics of one move while the book is collected. */
+struct BookEntry
+{
+    uint8_t move;
+    uint8_t flags;
+    uint64_t visits;
+    uint64_t wins;
+};
+
+uint64_t export_book(MCTS_leaf *root_node, ostream &out, int min_visits, int max_plies)
+{
+    if (root_node == nullptr)
+    {
+        throw runtime_error("Can not export an empty tree.");
+    }
+    // key -> moves; a map, so the positions come out sorted by key
+    map<uint64_t, vector<BookEntry>> positions;
+    vector<pair<MCTS_leaf *, int>> stack = {{root_node, 0}};
+    while (!stack.empty())
+    {
+        MCTS_leaf *node = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        if (depth >= max_plies || node->total_games < min_visits)
+        {
+            continue;
+        }
+        ensure_children(node);
+        vector<BookEntry> &entries = positions[node->state.hash()];
+        for (MCTS_leaf *child : node->children)
+        {
+            if (child == nullptr || child->total_games == 0)
+            {
+                continue;
+            }
+            uint8_t code = encode_move(child->get_move());
+            auto it = find_if(entries.begin(), entries.end(), [code](const BookEntry &e)
+                              { return e.move == code; });
+            if (it == entries.end())
+            {
+                entries.push_back({code, static_cast<uint8_t>(child->get_move().get_jump_type() ? BOOK_FLAG_JUMP : 0), 0, 0});
+                it = entries.end() - 1;
+            }
+            it->visits += child->total_games;
+            it->wins += child->wins;
+            stack.push_back({child, depth + 1});
+        }
+        if (entries.empty())
+        {
+            positions.erase(node->state.hash());
+        }
+    }
+
+    string buf(BOOK_MAGIC, 4);
+    put_uint(buf, BOOK_FORMAT_VERSION, 2);
+    put_uint(buf, 0, 2);
+    put_uint(buf, positions.size(), 8);
+    size_t num_moves_pos = buf.size();
+    put_uint(buf, 0, 8);
+    uint64_t num_moves = 0;
+    for (auto &position : positions)
+    {
+        put_uint(buf, position.first, 8);
+        put_uint(buf, num_moves, 4);
+        put_uint(buf, position.second.size(), 2);
+        put_uint(buf, 0, 2);
+        num_moves += position.second.size();
+    }
+    for (auto &position : positions)
+    {
+        for (BookEntry &entry : position.second)
+        {
+            buf.push_back(static_cast<char>(entry.move));
+            buf.push_back(static_cast<char>(entry.flags));
+            put_uint(buf, 0, 2);
+            put_uint(buf, min<uint64_t>(entry.visits, UINT32_MAX), 4);
+            put_uint(buf, min<uint64_t>(entry.wins, UINT32_MAX), 4);
+        }
+    }
+    string count;
+    put_uint(count, num_moves, 8);
+    buf.replace(num_moves_pos, 8, count);
+    put_uint(buf, fnv1a(buf.data(), buf.size()), 8);
+    out.write(buf.data(), buf.size());
+    return positions.size();
+}
+
+int book_main(int argc, char *argv[])
+{
+    string paths[2];
+    int num_paths = 0;
+    int min_visits = BOOK_MIN_VISITS;
+    int max_plies = BOOK_MAX_PLIES;
+    for (int i = 0; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--min-visits" && i + 1 < argc)
+        {
+            min_visits = atoi(argv[++i]);
+        }
+        else if (arg == "--max-plies" && i + 1 < argc)
+        {
+            max_plies = atoi(argv[++i]);
+        }
+        else if (num_paths < 2)
+        {
+            paths[num_paths++] = arg;
+        }
+    }
+    if (num_paths < 2)
+    {
+        cerr << "usage: checkers_exec book <tree> <out> [--min-visits K] [--max-plies N]\n";
+        return 1;
+    }
+    MCTS_leaf *tree = open_tree_with_journal(paths[0]);
+    if (tree == nullptr)
+    {
+        cerr << "Unable to load " << paths[0] << "\n";
+        return 1;
+    }
+    ofstream out(paths[1], ios::binary);
+    if (!out.is_open())
+    {
+        cerr << "Unable to open " << paths[1] << "\n";
+        destroy_tree(tree);
+        return 1;
+    }
+    try
+    {
+        auto start = chrono::steady_clock::now();
+        uint64_t num_positions = export_book(tree, out, min_visits, max_plies);
+        out.close();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("wrote %llu positions (min visits %d, max plies %d) to %s in %.1f ms\n",
+               static_cast<unsigned long long>(num_positions), min_visits, max_plies, paths[1].c_str(), seconds * 1000);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        destroy_tree(tree);
+        return 1;
+    }
+    destroy_tree(tree);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file opening_book.hpp
+ * @brief Opening book: the move statistics of the well explored positions of a trained tree, sorted by position hash.
+ *
+ * Layout (all integers little endian):
+ * - header (BOOK_HEADER_SIZE bytes): magic "MCBK", u16 version, u16 flags (0), u64 number of positions, u64 number of moves
+ * - the positions, sorted by key, BOOK_POSITION_SIZE bytes each:
+ *   u64 key (`GameState::hash`), u32 index of the first move, u16 number of moves, u16 0
+ * - the moves of all positions, BOOK_MOVE_SIZE bytes each:
+ *   u8 move (encoded like in tree_format.hpp), u8 flags (1 = jump), u16 0, u32 visits, u32 wins
+ * - u64 FNV-1a checksum of everything before it
+ *
+ * A position is found with a binary search over the keys, so probing needs neither the tree nor any parsing.
+ * `wins` of a move counts the games the player who makes the move won (like `MCTS_leaf::wins` of the child).
+ */
+#ifndef OPENING_BOOK_HPP
+#define OPENING_BOOK_HPP
+
+#include "classes.hpp"
+#include "tree_format.hpp"
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+/** @def BOOK_MAGIC
+ *  @brief First four bytes of an opening book file.
+ */
+#define BOOK_MAGIC "MCBK"
+/** @def BOOK_FORMAT_VERSION
+ *  @brief Version of the book format written by export_book.
+ */
+#define BOOK_FORMAT_VERSION 1
+/** @def BOOK_HEADER_SIZE
+ *  @brief Size of the header, i.e. the offset of the first position.
+ */
+#define BOOK_HEADER_SIZE 24
+/** @def BOOK_POSITION_SIZE
+ *  @brief Size of one position entry.
+ */
+#define BOOK_POSITION_SIZE 16
+/** @def BOOK_MOVE_SIZE
+ *  @brief Size of one move entry.
+ */
+#define BOOK_MOVE_SIZE 12
+/** @def BOOK_MIN_VISITS
+ *  @brief Default number of visits a position needs to be put into the book.
+ */
+#define BOOK_MIN_VISITS 100
+/** @def BOOK_MAX_PLIES
+ *  @brief Default number of plies from the root that are put into the book.
+ */
+#define BOOK_MAX_PLIES 15
+/** @def OPENING_BOOK_FILE
+ *  @brief File the server loads its opening book from.
+ */
+#define OPENING_BOOK_FILE "opening_book.bin"
+
+/**
+ * @struct BookMove
+ * @brief One move of a book position with its statistics.
+ */
+struct BookMove
+{
+    Move move;       /**< The move. */
+    uint32_t visits; /**< Number of games through this move. */
+    uint32_t wins;   /**< Number of these games won by the player making the move. */
+};
+
+/**
+ * @class OpeningBook
+ * @brief A mapped opening book file; positions are looked up by their hash.
+ */
+class OpeningBook
+{
+private:
+    shared_ptr<MappedFile> file; /**< The whole file. */
+    uint64_t num_positions = 0;  /**< Number of positions. */
+    uint64_t num_moves = 0;      /**< Number of moves of all positions. */
+
+    /** @brief Takes the content of `file` and checks its header, size and checksum. */
+    void parse(shared_ptr<MappedFile> file);
+
+public:
+    /**
+     * @brief Maps an opening book file read only (see `MappedFile::open`), so the processes
+     * of one host share a single copy of it and probes read it without copying.
+     * @param path Path of the book file.
+     * @throws runtime_error if the file is not a valid opening book.
+     * @return The book or nullptr if the file can not be opened.
+     */
+    static shared_ptr<OpeningBook> open(const string &path);
+
+    /**
+     * @brief Wraps the content of an opening book file.
+     * @param data The whole file content.
+     * @throws runtime_error if the content is not a valid opening book.
+     */
+    static shared_ptr<OpeningBook> from_buffer(string data);
+
+    /** @brief Returns the number of positions in the book. */
+    uint64_t get_num_positions() const { return num_positions; }
+
+    /**
+     * @brief Looks up the moves of a position (binary search over the keys).
+     * @param state The position.
+     * @return The moves of the position in the book, or an empty vector if it is not in the book.
+     */
+    vector<BookMove> probe(const GameState &state) const;
+
+    /**
+     * @brief Finds the most visited book move of a position that is legal in that position.
+     * @param state The position.
+     * @param best Receives the move.
+     * @return true if the position is in the book.
+     */
+    bool best_move(const GameState &state, Move &best) const;
+};
+
+/**
+ * @brief Writes an opening book with every position of the tree that is at most `max_plies` plies from the root
+ * and has at least `min_visits` visits. A position that is reached by several move orders is stored once,
+ * with the statistics of all of them added up.
+ * @param root_node The root node of the trained tree (nodes of a mapped tree are created as needed).
+ * @param out The output stream; it should be opened in binary mode.
+ * @param min_visits Visits a position needs to be put into the book.
+ * @param max_plies Number of plies from the root that are looked at.
+ * @return Number of positions in the book.
+ */
+uint64_t export_book(MCTS_leaf *, ostream &out, int min_visits = BOOK_MIN_VISITS, int max_plies = BOOK_MAX_PLIES);
+
+/**
+ * @brief Command line entry for `checkers_exec book <tree> <out> [--min-visits K] [--max-plies N]`.
+ * @param argc Number of arguments after "book".
+ * @param argv The arguments after "book".
+ * @return 0 on success, 1 on error.
+ */
+int book_main(int argc, char *argv[]);
+
+#endif
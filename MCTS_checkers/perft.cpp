@@ -0,0 +1,137 @@
+#include "perft.hpp"
+#include "mcts_algorithm.hpp"
+#include <chrono>
+
+using namespace std;
+
+unsigned long long perft(const GameState &state, int depth)
+{
+    if (depth == 0)
+    {
+        return 1;
+    }
+    GameState current = state;
+    current.list_all_possible_moves(current.get_current_player());
+    // one ply left: every move leads to exactly one leaf, no need to perform them
+    if (depth == 1)
+    {
+        return current.possible_moves.size();
+    }
+    unsigned long long nodes = 0;
+    for (Move mv : current.possible_moves)
+    {
+        // same steps as expansion(): clone, switch the player, perform the move
+        GameState next = current.clone();
+        next.switch_player();
+        mv.perform_move(next.get_board(), mv);
+        nodes += perft(next, depth - 1);
+    }
+    return nodes;
+}
+
+PerftResult perft_divide(const GameState &state, int depth, int num_threads)
+{
+    auto start = chrono::steady_clock::now();
+    PerftResult result;
+    GameState root = state;
+    root.list_all_possible_moves(root.get_current_player());
+    for (Move mv : root.possible_moves)
+    {
+        result.divide.push_back({mv, 0});
+    }
+
+    // every thread takes the next root move that nobody is working on yet
+    atomic<size_t> next_move(0);
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = next_move.fetch_add(1)) < result.divide.size())
+        {
+            Move mv = result.divide[i].first;
+            GameState next = root.clone();
+            next.switch_player();
+            mv.perform_move(next.get_board(), mv);
+            // every thread writes only its own entries
+            result.divide[i].second = perft(next, depth - 1);
+        }
+    };
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    vector<thread> threads;
+    for (int t = 1; t < num_threads; t++)
+    {
+        threads.push_back(thread(worker));
+    }
+    worker(); // the calling thread helps as well
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+
+    for (auto &entry : result.divide)
+    {
+        result.nodes += entry.second;
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int perft_main(int argc, char *argv[])
+{
+    int depth = -1;
+    string board_name = "default";
+    bool divide = false;
+    int num_threads = 1;
+    for (int i = 0; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--divide")
+        {
+            divide = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (depth == -1 && isdigit(arg[0]))
+        {
+            depth = atoi(arg.c_str());
+        }
+        else
+        {
+            board_name = arg;
+        }
+    }
+    if (depth < 1)
+    {
+        cerr << "usage: checkers_exec perft <depth> [default|jump-test|king-test|win-test] [--divide] [--threads N]\n";
+        return 1;
+    }
+
+    array<array<Piece, 8>, 8> board_data;
+    try
+    {
+        board_data = create_board(board_name);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    GameState state(Board(board_data), PLAYER1);
+    PerftResult result = perft_divide(state, depth, num_threads);
+
+    if (divide)
+    {
+        for (auto &entry : result.divide)
+        {
+            printf("%s: %llu\n", entry.first.get_move_info().c_str(), entry.second);
+        }
+    }
+    double nps = result.seconds > 0 ? result.nodes / result.seconds : 0;
+    printf("perft board=%s depth=%d threads=%d nodes=%llu time_ms=%.1f nps=%.0f\n",
+           board_name.c_str(), depth, num_threads, result.nodes, result.seconds * 1000, nps);
+    return 0;
+}
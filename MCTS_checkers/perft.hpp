@@ -0,0 +1,56 @@
+/**
+ * @file perft.hpp
+ * @brief Perft (performance test) for the move generator.
+ *
+ * Perft counts all positions that can be reached in exactly N plies, using the engine's own
+ * `GameState::list_all_possible_moves` and `Move::perform_move`. The counts are a correctness
+ * oracle for the move generator, and the time it takes is a nodes-per-second benchmark.
+ */
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+#include "classes.hpp"
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @struct PerftResult
+ * @brief Result of a perft run, including the "divide" count per root move.
+ */
+struct PerftResult
+{
+    unsigned long long nodes = 0;                             /**< Number of positions at the given depth. */
+    vector<pair<Move, unsigned long long>> divide;            /**< Number of positions below every root move. */
+    double seconds = 0;                                       /**< Wall time of the run. */
+};
+
+/**
+ * @brief Counts the positions reachable from `state` in exactly `depth` plies.
+ * Positions without moves (game over) before reaching the depth are not counted.
+ * @param state The position to start from; `current_player` is the player to move.
+ * @param depth Number of plies.
+ * @return Number of leaf positions.
+ */
+unsigned long long perft(const GameState &state, int depth);
+
+/**
+ * @brief Runs perft and splits the work at the root, so every root move is searched by one of `num_threads` threads.
+ * @param state The position to start from.
+ * @param depth Number of plies (at least 1 for a divide output).
+ * @param num_threads Number of worker threads; values below 1 are treated as 1.
+ * @return The total count, the count per root move (in move generator order) and the time it took.
+ */
+PerftResult perft_divide(const GameState &state, int depth, int num_threads = 1);
+
+/**
+ * @brief Command line entry for `checkers_exec perft <depth> [board] [--divide] [--threads N]`.
+ * Prints the divide output (optional) and a summary line with nodes and nodes per second.
+ * @param argc Number of arguments after "perft".
+ * @param argv The arguments after "perft".
+ * @return 0 on success, 1 on invalid arguments.
+ */
+int perft_main(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,568 @@
+#include "selfplay.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+// ----- engine configurations -----
+EngineConfig parse_engine_config(const string &spec, EngineConfig config)
+{
+    stringstream fields(spec);
+    string field;
+    bool iterations_given = false;
+    bool time_given = false;
+    while (getline(fields, field, ','))
+    {
+        if (field.empty())
+        {
+            continue;
+        }
+        size_t eq = field.find('=');
+        if (eq == string::npos)
+        {
+            throw runtime_error("Expected key=value in engine configuration: " + field);
+        }
+        string key = field.substr(0, eq);
+        string value = field.substr(eq + 1);
+        if (key == "engine" && value == "mcts")
+            config.engine = ENGINE_MCTS;
+        else if (key == "engine" && value == "alphabeta")
+            config.engine = ENGINE_ALPHABETA;
+        else if (key == "depth")
+            config.depth = atoi(value.c_str());
+        else if (key == "threads")
+            config.threads = atoi(value.c_str());
+        else if (key == "iterations")
+        {
+            config.iterations = atoi(value.c_str());
+            iterations_given = true;
+        }
+        else if (key == "time")
+        {
+            config.seconds = atof(value.c_str());
+            time_given = true;
+        }
+        else if (key == "c")
+            config.params.c = atof(value.c_str());
+        else if (key == "rollout" && value == "random")
+            config.params.rollout = ROLLOUT_RANDOM;
+        else if (key == "rollout" && value == "promote")
+            config.params.rollout = ROLLOUT_PROMOTE;
+        else if (key == "cutoff")
+            config.params.rollout_cutoff = atoi(value.c_str());
+        else
+            throw runtime_error("Unknown engine setting: " + field);
+    }
+    if (time_given && !iterations_given)
+    {
+        // only a time: search until it is up
+        config.iterations = 0;
+    }
+    if (config.engine == ENGINE_ALPHABETA)
+    {
+        if (config.depth < 0 || config.seconds < 0 || (config.depth == 0 && config.seconds == 0))
+        {
+            throw runtime_error("An alpha-beta engine needs a depth or a time per move: " + spec);
+        }
+        if (config.threads < 1)
+        {
+            throw runtime_error("An alpha-beta engine needs at least one thread: " + spec);
+        }
+    }
+    else if (config.iterations < 0 || config.seconds < 0 || (config.iterations == 0 && config.seconds == 0))
+    {
+        throw runtime_error("An engine needs iterations or a time per move: " + spec);
+    }
+    return config;
+}
+
+string engine_config_to_string(const EngineConfig &config)
+{
+    ostringstream out;
+    if (config.engine == ENGINE_ALPHABETA)
+    {
+        out << "engine=alphabeta,time=" << config.seconds << ",depth=" << config.depth << ",threads=" << config.threads;
+        return out.str();
+    }
+    out << "iterations=" << config.iterations << ",time=" << config.seconds << ",c=" << config.params.c
+        << ",rollout=" << (config.params.rollout == ROLLOUT_PROMOTE ? "promote" : "random") << ",cutoff=" << config.params.rollout_cutoff;
+    return out.str();
+}
+
+// ----- playing -----
+/** @brief Returns the position after `move`, with the moves of the next player listed. */
+static GameState play_move(const GameState &state, Move move)
+{
+    GameState next = state.clone();
+    next.switch_player();
+    move.perform_move(next.get_board(), move);
+    next.list_all_possible_moves(next.get_current_player());
+    return next;
+}
+
+/** @brief `search_move` for an alpha-beta engine. */
+static bool search_move_alphabeta(const GameState &state, const EngineConfig &config, EngineStats *stats, Move &best, ParallelAlphaBeta *searcher)
+{
+    unique_ptr<ParallelAlphaBeta> own_searcher;
+    if (searcher == nullptr)
+    {
+        own_searcher.reset(new ParallelAlphaBeta(config.threads));
+        searcher = own_searcher.get();
+    }
+    AlphaBetaResult result = searcher->search(state, config.seconds, config.depth > 0 ? config.depth : AB_MAX_PLY - 1).best;
+    if (!result.found)
+    {
+        return false;
+    }
+    best = result.best;
+    if (stats != nullptr)
+    {
+        stats->moves++;
+        stats->iterations += result.nodes;
+        stats->depth += result.depth;
+        stats->seconds += result.seconds;
+    }
+    return true;
+}
+
+bool search_move(const GameState &state, const EngineConfig &config, EngineStats *stats, Move &best, ParallelAlphaBeta *searcher)
+{
+    if (config.engine == ENGINE_ALPHABETA)
+    {
+        return search_move_alphabeta(state, config, stats, best, searcher);
+    }
+    GameState root_state = state.clone();
+    root_state.list_all_possible_moves(root_state.get_current_player());
+    if (root_state.possible_moves.empty())
+    {
+        return false;
+    }
+    MCTS_leaf *root = new MCTS_leaf(root_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    auto start = chrono::steady_clock::now();
+    long long done = 0;
+    if (config.seconds <= 0)
+    {
+        train(root, config.iterations, nullptr, config.params);
+        done = config.iterations;
+    }
+    else
+    {
+        auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(config.seconds));
+        while (chrono::steady_clock::now() < deadline && (config.iterations <= 0 || done < config.iterations))
+        {
+            int count = config.iterations > 0 ? static_cast<int>(min<long long>(SELFPLAY_CHUNK, config.iterations - done)) : SELFPLAY_CHUNK;
+            train(root, count, nullptr, config.params);
+            done += count;
+        }
+    }
+    MCTS_leaf *chosen = select_most_visited_child(root);
+    best = chosen != root ? chosen->get_move() : root_state.possible_moves[0];
+    if (stats != nullptr)
+    {
+        stats->moves++;
+        stats->iterations += done;
+        stats->seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    destroy_tree(root);
+    return true;
+}
+
+/**
+ * @brief Plays one game to the end or to the ply limit.
+ * @param state The position after the opening.
+ * @param engines The engine of each player, indexed by PLAYER1 and PLAYER2.
+ * @param stats The statistics of each player, indexed the same way.
+ * @return The winner, or NOPLAYER for a draw.
+ */
+static int play_game(GameState state, const EngineConfig *engines[3], EngineStats *stats[3], int max_plies)
+{
+    // each alpha-beta engine keeps its table for the whole game
+    unique_ptr<ParallelAlphaBeta> searchers[3];
+    for (int player : {PLAYER1, PLAYER2})
+    {
+        if (engines[player]->engine == ENGINE_ALPHABETA)
+        {
+            searchers[player].reset(new ParallelAlphaBeta(engines[player]->threads));
+        }
+    }
+    for (int ply = 0;; ply++)
+    {
+        state.list_all_possible_moves(state.get_current_player());
+        int status = state.TerminalState();
+        if (status != -1)
+        {
+            return status;
+        }
+        if (ply >= max_plies)
+        {
+            return NOPLAYER;
+        }
+        int player = state.get_current_player();
+        Move move;
+        search_move(state, *engines[player], stats[player], move, searchers[player].get());
+        state = play_move(state, move);
+    }
+}
+
+/** @brief Adds the statistics of one game to the statistics of the match. */
+static void add_engine_stats(EngineStats &total, const EngineStats &game)
+{
+    total.moves += game.moves;
+    total.iterations += game.iterations;
+    total.depth += game.depth;
+    total.seconds += game.seconds;
+}
+
+/** @brief Returns the start position with `plies` random moves played; the same `seed` gives the same opening. */
+static GameState random_opening(unsigned int seed, int plies)
+{
+    mt19937 rng(seed);
+    GameState state(Board(create_board("default")), PLAYER1);
+    state.list_all_possible_moves(state.get_current_player());
+    for (int i = 0; i < plies && state.TerminalState() == -1; i++)
+    {
+        Move move = state.possible_moves[rng() % state.possible_moves.size()];
+        state = play_move(state, move);
+    }
+    return state;
+}
+
+MatchResult play_match(const EngineConfig &engine_a, const EngineConfig &engine_b, const MatchOptions &options)
+{
+    MatchResult result;
+    auto start = chrono::steady_clock::now();
+    int pairs = (options.games + 1) / 2;
+    int num_threads = max(1, min(options.threads, 2 * pairs));
+    atomic<int> next_game(0);
+    mutex result_mutex;
+    unsigned int outer_random_state = get_thread_random_state();
+
+    auto work = [&]()
+    {
+        for (int game = next_game++; game < 2 * pairs; game = next_game++)
+        {
+            // both games of a pair start from the same opening; A moves first in the first one and second in the other
+            GameState opening = random_opening(options.seed + game / 2, options.opening_plies);
+            bool a_first = game % 2 == 0;
+            int a_player = a_first ? opening.get_current_player() : (opening.get_current_player() == PLAYER1 ? PLAYER2 : PLAYER1);
+            int b_player = a_player == PLAYER1 ? PLAYER2 : PLAYER1;
+            EngineStats stats_a, stats_b;
+            const EngineConfig *engines[3];
+            EngineStats *stats[3];
+            engines[a_player] = &engine_a;
+            engines[b_player] = &engine_b;
+            stats[a_player] = &stats_a;
+            stats[b_player] = &stats_b;
+            // every game gets its own generator, so a match does not depend on the number of threads
+            seed_thread_random((options.seed * 2654435761u + game) | 1);
+            int winner = play_game(opening, engines, stats, options.max_plies);
+
+            lock_guard<mutex> lock(result_mutex);
+            if (winner == NOPLAYER)
+                result.draws++;
+            else if (winner == a_player)
+                result.wins++;
+            else
+                result.losses++;
+            add_engine_stats(result.a, stats_a);
+            add_engine_stats(result.b, stats_b);
+        }
+    };
+    vector<thread> workers;
+    for (int i = 1; i < num_threads; i++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    seed_thread_random(outer_random_state);
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// ----- rating -----
+double elo_difference(double score)
+{
+    if (score <= 0)
+    {
+        return -INFINITY;
+    }
+    if (score >= 1)
+    {
+        return INFINITY;
+    }
+    return -400 * log10(1 / score - 1);
+}
+
+double match_elo(const MatchResult &result, double &low, double &high)
+{
+    int games = result.wins + result.draws + result.losses;
+    if (games == 0)
+    {
+        low = high = 0;
+        return 0;
+    }
+    double n = games;
+    double score = (result.wins + 0.5 * result.draws) / n;
+    // Wilson score interval with the variance of the game results (every game scores 1, 0.5 or 0),
+    // which stays inside (0, 1) when one engine wins every game
+    double variance = (result.wins * pow(1 - score, 2) + result.draws * pow(0.5 - score, 2) + result.losses * pow(score, 2)) / n;
+    const double z = 1.96;
+    double center = (score + z * z / (2 * n)) / (1 + z * z / n);
+    double error = z / (1 + z * z / n) * sqrt(variance / n + z * z / (4 * n * n));
+    low = elo_difference(center - error);
+    high = elo_difference(center + error);
+    return elo_difference(score);
+}
+
+// ----- command line -----
+/** @brief Prints the time per move and the search speed of one engine. */
+static void print_engine_stats(const char *name, const EngineConfig &config, const EngineStats &stats)
+{
+    if (config.engine == ENGINE_ALPHABETA)
+    {
+        double nodes_per_second = stats.seconds > 0 ? stats.iterations / stats.seconds : 0.0;
+        printf("%s: %lld moves, %.3f ms/move, depth %.1f/move, %.0f nodes/s (%.0f per thread)\n", name, stats.moves,
+               stats.moves > 0 ? stats.seconds * 1000 / stats.moves : 0.0, stats.moves > 0 ? static_cast<double>(stats.depth) / stats.moves : 0.0,
+               nodes_per_second, nodes_per_second / config.threads);
+        return;
+    }
+    printf("%s: %lld moves, %.3f ms/move, %.0f iterations/move, %.0f iterations/s\n", name, stats.moves,
+           stats.moves > 0 ? stats.seconds * 1000 / stats.moves : 0.0, stats.moves > 0 ? static_cast<double>(stats.iterations) / stats.moves : 0.0,
+           stats.seconds > 0 ? stats.iterations / stats.seconds : 0.0);
+}
+
+int selfplay_main(int argc, char *argv[])
+{
+    EngineConfig engine_a, engine_b;
+    MatchOptions options;
+    options.threads = max(1u, thread::hardware_concurrency());
+    options.seed = static_cast<unsigned int>(chrono::system_clock::now().time_since_epoch().count());
+    try
+    {
+        for (int i = 0; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                throw runtime_error("Missing value for " + arg);
+            }
+            string value = argv[++i];
+            if (arg == "--a")
+                engine_a = parse_engine_config(value);
+            else if (arg == "--b")
+                engine_b = parse_engine_config(value);
+            else if (arg == "--games")
+                options.games = atoi(value.c_str());
+            else if (arg == "--threads")
+                options.threads = atoi(value.c_str());
+            else if (arg == "--seed")
+                options.seed = static_cast<unsigned int>(strtoul(value.c_str(), nullptr, 10));
+            else if (arg == "--max-plies")
+                options.max_plies = atoi(value.c_str());
+            else if (arg == "--opening-plies")
+                options.opening_plies = atoi(value.c_str());
+            else
+                throw runtime_error("Unknown option " + arg);
+        }
+        if (options.games < 1 || options.threads < 1)
+        {
+            throw runtime_error("--games and --threads must be at least 1");
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        cerr << "usage: checkers_exec selfplay [--a CONFIG] [--b CONFIG] [--games N] [--threads T] [--seed X]\n"
+                "                              [--max-plies P] [--opening-plies K]\n"
+                "       CONFIG: iterations=N,time=S,c=X,rollout=random|promote,cutoff=P\n"
+                "           or: engine=alphabeta,time=S,depth=D,threads=T\n";
+        return 1;
+    }
+
+    printf("A: %s\nB: %s\n", engine_config_to_string(engine_a).c_str(), engine_config_to_string(engine_b).c_str());
+    printf("playing %d games with %d thread(s), seed %u\n", (options.games + 1) / 2 * 2, options.threads, options.seed);
+    fflush(stdout);
+    MatchResult result = play_match(engine_a, engine_b, options);
+
+    int games = result.wins + result.draws + result.losses;
+    double low, high;
+    double elo = match_elo(result, low, high);
+    printf("%d games in %.1f s\n", games, result.seconds);
+    printf("A: %d wins, %d draws, %d losses (score %.1f%%)\n", result.wins, result.draws, result.losses,
+           100.0 * (result.wins + 0.5 * result.draws) / games);
+    printf("Elo A - B: %+.1f (95%%: %+.1f .. %+.1f)\n", elo, low, high);
+    print_engine_stats("A", engine_a, result.a);
+    print_engine_stats("B", engine_b, result.b);
+    return 0;
+}
+
+// ----- tuning -----
+vector<TuneResult> tune_grid(const SearchParams &baseline, const TuneGrid &grid, double seconds, const MatchOptions &options,
+                             const function<void(const TuneResult &)> &on_result)
+{
+    EngineConfig base_engine;
+    base_engine.iterations = 0;
+    base_engine.seconds = seconds;
+    base_engine.params = baseline;
+    vector<TuneResult> results;
+    for (double c : grid.c)
+    {
+        for (int rollout : grid.rollout)
+        {
+            for (int cutoff : grid.cutoff)
+            {
+                EngineConfig candidate = base_engine;
+                candidate.params.c = c;
+                candidate.params.rollout = rollout;
+                candidate.params.rollout_cutoff = cutoff;
+                results.push_back({candidate.params, play_match(candidate, base_engine, options)});
+                if (on_result)
+                {
+                    on_result(results.back());
+                }
+            }
+        }
+    }
+    return results;
+}
+
+/** @brief Splits a comma separated list and converts every item with `convert`. */
+template <typename T>
+static vector<T> parse_list(const string &list, const function<T(const string &)> &convert)
+{
+    vector<T> values;
+    stringstream items(list);
+    string item;
+    while (getline(items, item, ','))
+    {
+        values.push_back(convert(item));
+    }
+    if (values.empty())
+    {
+        throw runtime_error("Empty list");
+    }
+    return values;
+}
+
+/** @brief Returns the score of a match (wins plus half the draws, divided by the games). */
+static double match_score(const MatchResult &result)
+{
+    int games = result.wins + result.draws + result.losses;
+    return games > 0 ? (result.wins + 0.5 * result.draws) / games : 0.5;
+}
+
+int tune_main(int argc, char *argv[])
+{
+    TuneGrid grid;
+    MatchOptions options;
+    options.games = 40;
+    options.threads = max(1u, thread::hardware_concurrency());
+    options.seed = static_cast<unsigned int>(chrono::system_clock::now().time_since_epoch().count());
+    double seconds = 0.005;
+    string in_path = SEARCH_PARAMS_FILE;
+    string out_path = "";
+    SearchParams baseline;
+    try
+    {
+        for (int i = 0; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                throw runtime_error("Missing value for " + arg);
+            }
+            string value = argv[++i];
+            if (arg == "--c")
+                grid.c = parse_list<double>(value, [](const string &item)
+                                            { return stod(item); });
+            else if (arg == "--rollout")
+                grid.rollout = parse_list<int>(value, [](const string &item)
+                                               {
+                    if (item != "random" && item != "promote")
+                        throw runtime_error("Unknown rollout policy " + item);
+                    return item == "promote" ? ROLLOUT_PROMOTE : ROLLOUT_RANDOM; });
+            else if (arg == "--cutoff")
+                grid.cutoff = parse_list<int>(value, [](const string &item)
+                                              { return stoi(item); });
+            else if (arg == "--time")
+                seconds = atof(value.c_str());
+            else if (arg == "--games")
+                options.games = atoi(value.c_str());
+            else if (arg == "--threads")
+                options.threads = atoi(value.c_str());
+            else if (arg == "--seed")
+                options.seed = static_cast<unsigned int>(strtoul(value.c_str(), nullptr, 10));
+            else if (arg == "--in")
+                in_path = value;
+            else if (arg == "--out")
+                out_path = value;
+            else
+                throw runtime_error("Unknown option " + arg);
+        }
+        if (options.games < 1 || options.threads < 1 || seconds <= 0)
+        {
+            throw runtime_error("--games, --threads and --time must be positive");
+        }
+        read_search_params(in_path, baseline);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        cerr << "usage: checkers_exec tune [--c LIST] [--rollout LIST] [--cutoff LIST] [--time S] [--games N] [--threads T]\n"
+                "                          [--seed X] [--in FILE] [--out FILE]\n";
+        return 1;
+    }
+    if (out_path.empty())
+    {
+        out_path = in_path;
+    }
+
+    EngineConfig base_engine;
+    base_engine.iterations = 0;
+    base_engine.seconds = seconds;
+    base_engine.params = baseline;
+    int num_candidates = static_cast<int>(grid.c.size() * grid.rollout.size() * grid.cutoff.size());
+    printf("baseline: %s\n", engine_config_to_string(base_engine).c_str());
+    printf("%d candidates, %d games each, %d thread(s), seed %u\n", num_candidates, (options.games + 1) / 2 * 2, options.threads, options.seed);
+    fflush(stdout);
+    vector<TuneResult> results = tune_grid(baseline, grid, seconds, options, [&](const TuneResult &candidate)
+                                           {
+        EngineConfig engine = base_engine;
+        engine.params = candidate.params;
+        double low, high;
+        double elo = match_elo(candidate.result, low, high);
+        printf("%s: %d/%d/%d, Elo %+.1f (95%%: %+.1f .. %+.1f), %.0f iterations/s\n", engine_config_to_string(engine).c_str(),
+               candidate.result.wins, candidate.result.draws, candidate.result.losses, elo, low, high,
+               candidate.result.a.seconds > 0 ? candidate.result.a.iterations / candidate.result.a.seconds : 0.0);
+        fflush(stdout); });
+
+    // the baseline stays unless a candidate beat it
+    SearchParams best = baseline;
+    double best_score = 0.5;
+    for (const TuneResult &candidate : results)
+    {
+        if (match_score(candidate.result) > best_score)
+        {
+            best = candidate.params;
+            best_score = match_score(candidate.result);
+        }
+    }
+    if (!write_search_params(out_path, best))
+    {
+        cerr << "Unable to write " << out_path << "\n";
+        return 1;
+    }
+    base_engine.params = best;
+    printf("best: %s (score %.1f%% against the baseline), written to %s\n", engine_config_to_string(base_engine).c_str(),
+           100 * best_score, out_path.c_str());
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file selfplay.hpp
+ * @brief Self-play matches between two engine configurations (`checkers_exec selfplay`).
+ *
+ * Every move is searched from a new tree with the budget of the engine to move, so a match measures
+ * the strength of a configuration for its time per move and not the knowledge stored in a tree file.
+ * Games are played in pairs: both games of a pair start with the same random opening and the engines swap colors.
+ * An engine is either MCTS or the alpha-beta search (`alphabeta.hpp`, on one or more threads); the alpha-beta
+ * engine keeps its transposition table for the whole game.
+ */
+#ifndef SELFPLAY_HPP
+#define SELFPLAY_HPP
+
+#include "classes.hpp"
+#include "mcts_algorithm.hpp"
+#include "alphabeta.hpp"
+#include <cmath>
+#include <functional>
+
+using namespace std;
+
+/** @def SELFPLAY_CHUNK
+ *  @brief Iterations between two looks at the clock when an engine searches for a time.
+ */
+#define SELFPLAY_CHUNK 16
+/** @def SELFPLAY_MAX_PLIES
+ *  @brief Default number of plies after which a game is a draw.
+ */
+#define SELFPLAY_MAX_PLIES 200
+/** @def SELFPLAY_OPENING_PLIES
+ *  @brief Default number of random moves each pair of games starts with.
+ */
+#define SELFPLAY_OPENING_PLIES 2
+/** @def ENGINE_MCTS
+ *  @brief Engine that searches with MCTS.
+ */
+#define ENGINE_MCTS 0
+/** @def ENGINE_ALPHABETA
+ *  @brief Engine that searches with iterative-deepening alpha-beta.
+ */
+#define ENGINE_ALPHABETA 1
+
+/**
+ * @struct EngineConfig
+ * @brief Search budget and parameters of one engine in a match.
+ */
+struct EngineConfig
+{
+    int engine = ENGINE_MCTS; /**< ENGINE_MCTS or ENGINE_ALPHABETA. */
+    int iterations = 100;     /**< MCTS iterations per move; 0 for no limit (then `seconds` must be set). */
+    double seconds = 0;       /**< Time per move in seconds; 0 for no limit. */
+    int depth = 0;            /**< Alpha-beta depth limit; 0 for none (then `seconds` must be set). */
+    int threads = 1;          /**< Alpha-beta threads (Lazy SMP). */
+    SearchParams params;      /**< Exploration constant and rollout settings of MCTS. */
+};
+
+/**
+ * @brief Parses an engine configuration like "iterations=500,time=0.01,c=1.2,rollout=promote,cutoff=40"
+ * or "engine=alphabeta,time=0.01,depth=12,threads=4".
+ * Keys that are not given keep the values of `config`, except that a time without iterations removes the iteration limit.
+ * @throws runtime_error on an unknown key or value.
+ */
+EngineConfig parse_engine_config(const string &spec, EngineConfig config = EngineConfig());
+
+/** @brief Formats an engine configuration the way `parse_engine_config` reads it. */
+string engine_config_to_string(const EngineConfig &config);
+
+/**
+ * @struct EngineStats
+ * @brief Search statistics of one engine over a match.
+ */
+struct EngineStats
+{
+    long long moves = 0;      /**< Moves searched. */
+    long long iterations = 0; /**< Iterations (nodes for alpha-beta) of all these searches. */
+    long long depth = 0;      /**< Sum of the finished alpha-beta depths. */
+    double seconds = 0;       /**< Time of all these searches. */
+};
+
+/**
+ * @struct MatchResult
+ * @brief Result of a match, from the point of view of engine A.
+ */
+struct MatchResult
+{
+    int wins = 0;        /**< Games A won. */
+    int draws = 0;       /**< Games that were drawn (or reached the ply limit). */
+    int losses = 0;      /**< Games A lost. */
+    EngineStats a;       /**< Search statistics of A. */
+    EngineStats b;       /**< Search statistics of B. */
+    double seconds = 0;  /**< Wall time of the match. */
+};
+
+/**
+ * @struct MatchOptions
+ * @brief Options of a match.
+ */
+struct MatchOptions
+{
+    int games = 100;                            /**< Number of games; rounded up to an even number. */
+    int threads = 1;                            /**< Games played at the same time. */
+    unsigned int seed = 1;                      /**< Seed of the openings and of the engines' generators. */
+    int max_plies = SELFPLAY_MAX_PLIES;         /**< Plies after which a game is a draw. */
+    int opening_plies = SELFPLAY_OPENING_PLIES; /**< Random moves at the start of each pair of games. */
+};
+
+/**
+ * @brief Searches the best move of a position with a new tree, or with alpha-beta.
+ * @param state The position; the player to move is `state.get_current_player()`.
+ * @param config Engine, budget and parameters of the search.
+ * @param stats If not nullptr, the move, its iterations and its time are added to it.
+ * @param best Receives the move.
+ * @param searcher The alpha-beta searcher of the game; if nullptr, a new one with `config.threads` threads is used for this move.
+ * @return false if the position has no moves.
+ */
+bool search_move(const GameState &state, const EngineConfig &config, EngineStats *stats, Move &best, ParallelAlphaBeta *searcher = nullptr);
+
+/**
+ * @brief Plays a match between two engines; the games run on `options.threads` threads.
+ * @param engine_a The first engine; the result is counted for it.
+ * @param engine_b The second engine.
+ * @param options Number of games, threads, seed and game rules.
+ * @return Wins, draws and losses of A and the search statistics of both engines.
+ */
+MatchResult play_match(const EngineConfig &engine_a, const EngineConfig &engine_b, const MatchOptions &options);
+
+/**
+ * @brief Converts a score (wins plus half the draws, divided by the games) to an Elo difference.
+ * @return The difference; +-infinity for a score of 1 or 0.
+ */
+double elo_difference(double score);
+
+/**
+ * @brief Computes the Elo difference of a match with its 95% confidence interval
+ * (a Wilson score interval, so the bounds stay finite when one engine wins every game).
+ * @param result The match.
+ * @param low Receives the lower end of the interval.
+ * @param high Receives the upper end of the interval.
+ * @return The Elo difference of A over B.
+ */
+double match_elo(const MatchResult &result, double &low, double &high);
+
+/**
+ * @struct TuneGrid
+ * @brief The values the tuner tries for each parameter; every combination is a candidate.
+ */
+struct TuneGrid
+{
+    vector<double> c = {0.7, 1.0, sqrt(2), 2.0}; /**< Exploration constants. */
+    vector<int> rollout = {ROLLOUT_RANDOM};      /**< Rollout policies. */
+    vector<int> cutoff = {0, 40};                /**< Rollout cutoffs in plies (0: none). */
+};
+
+/**
+ * @struct TuneResult
+ * @brief One candidate of the tuner and its match against the baseline.
+ */
+struct TuneResult
+{
+    SearchParams params; /**< The candidate. */
+    MatchResult result;  /**< Its match against the baseline, from the candidate's point of view. */
+};
+
+/**
+ * @brief Plays a match of every candidate of the grid against the baseline, both with the same time per move.
+ * All matches use the same seed, so they start from the same openings and differ only in the candidate.
+ * @param baseline The current parameters; the candidates take the iteration budgets from it.
+ * @param grid The values to try.
+ * @param seconds Time per move of both engines.
+ * @param options Games, threads and seed of every match.
+ * @param on_result If set, called after every match (e.g. to print progress).
+ * @return The candidates with their results, in grid order.
+ */
+vector<TuneResult> tune_grid(const SearchParams &baseline, const TuneGrid &grid, double seconds, const MatchOptions &options,
+                             const function<void(const TuneResult &)> &on_result = nullptr);
+
+/**
+ * @brief Command line entry for `checkers_exec tune [--c LIST] [--rollout LIST] [--cutoff LIST] [--time S] [--games N]
+ * [--threads T] [--seed X] [--in FILE] [--out FILE]` (LIST is comma separated).
+ * Plays the grid against the parameters in `--in` (default SEARCH_PARAMS_FILE; the defaults if it does not exist)
+ * and writes the candidate with the best score to `--out` (default: the input file), or the baseline if none beat it.
+ * @param argc Number of arguments after "tune".
+ * @param argv The arguments after "tune".
+ * @return 0 on success, 1 on error.
+ */
+int tune_main(int argc, char *argv[]);
+
+/**
+ * @brief Command line entry for `checkers_exec selfplay [--a CONFIG] [--b CONFIG] [--games N] [--threads T] [--seed X]
+ * [--max-plies P] [--opening-plies K]`. Plays the match and prints wins/draws/losses, the Elo difference
+ * with its error bars, the time per move and the iterations per second of both engines.
+ * @param argc Number of arguments after "selfplay".
+ * @param argv The arguments after "selfplay".
+ * @return 0 on success, 1 on error.
+ */
+int selfplay_main(int argc, char *argv[]);
+
+#endif
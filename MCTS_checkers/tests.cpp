@@ -18,12 +18,24 @@ int all_tests()
         return testres;
     printf("Saving and loading tree test passed!\n");
     printf("------\n");
+    printf("Testing the buffered tree writer...\n");
+    testres = test_save_buffer();
+    if (testres != 0)
+        return testres;
+    printf("Buffered writer test passed!\n");
+    printf("------\n");
     printf("Testing jumping moves...\n");
     testres = test_jump();
     if (testres != 0)
         return testres;
     printf("Jumping test passed!\n");
     printf("------\n");
+    printf("Testing selection of nodes with unexplored moves...\n");
+    testres = test_selection();
+    if (testres != 0)
+        return testres;
+    printf("Selection test passed!\n");
+    printf("------\n");
     printf("Testing if king is set correctly...\n");
     testres = test_king();
     if (testres != 0)
@@ -35,6 +47,108 @@ int all_tests()
     if (testres != 0)
         return testres;
     printf("Win test passed!\n");
+    printf("------\n");
+    printf("Testing move generator with perft...\n");
+    testres = test_perft();
+    if (testres != 0)
+        return testres;
+    printf("Perft test passed!\n");
+    printf("------\n");
+    printf("Testing binary tree format...\n");
+    testres = test_binary_tree();
+    if (testres != 0)
+        return testres;
+    printf("Binary tree format test passed!\n");
+    printf("------\n");
+    printf("Testing memory mapped tree...\n");
+    testres = test_mapped_tree();
+    if (testres != 0)
+        return testres;
+    printf("Memory mapped tree test passed!\n");
+    printf("------\n");
+    printf("Testing tree journal...\n");
+    testres = test_journal();
+    if (testres != 0)
+        return testres;
+    printf("Tree journal test passed!\n");
+    printf("------\n");
+    printf("Testing checkpoints...\n");
+    testres = test_checkpoint();
+    if (testres != 0)
+        return testres;
+    printf("Checkpoint test passed!\n");
+    printf("------\n");
+    printf("Testing pending changes...\n");
+    testres = test_pending_changes();
+    if (testres != 0)
+        return testres;
+    printf("Pending changes test passed!\n");
+    printf("------\n");
+    printf("Testing tree merge...\n");
+    testres = test_merge();
+    if (testres != 0)
+        return testres;
+    printf("Tree merge test passed!\n");
+    printf("------\n");
+    printf("Testing opening book...\n");
+    testres = test_opening_book();
+    if (testres != 0)
+        return testres;
+    printf("Opening book test passed!\n");
+    printf("------\n");
+    printf("Testing pruned save...\n");
+    testres = test_pruning();
+    if (testres != 0)
+        return testres;
+    printf("Pruned save test passed!\n");
+    printf("------\n");
+    printf("Testing parallel training...\n");
+    testres = test_train_parallel();
+    if (testres != 0)
+        return testres;
+    printf("Parallel training test passed!\n");
+    printf("------\n");
+    printf("Testing resumed training...\n");
+    testres = test_train_resume();
+    if (testres != 0)
+        return testres;
+    printf("Resumed training test passed!\n");
+    printf("------\n");
+    printf("Testing self-play matches...\n");
+    testres = test_selfplay();
+    if (testres != 0)
+        return testres;
+    printf("Self-play test passed!\n");
+    printf("------\n");
+    printf("Testing search parameters...\n");
+    testres = test_search_params();
+    if (testres != 0)
+        return testres;
+    printf("Search parameters test passed!\n");
+    printf("------\n");
+    printf("Testing alpha-beta search...\n");
+    testres = test_alphabeta();
+    if (testres != 0)
+        return testres;
+    printf("Alpha-beta test passed!\n");
+    printf("------\n");
+    printf("Testing parallel alpha-beta search...\n");
+    testres = test_lazy_smp();
+    if (testres != 0)
+        return testres;
+    printf("Parallel alpha-beta test passed!\n");
+    printf("------\n");
+    printf("Testing quiescence search...\n");
+    testres = test_quiescence();
+    if (testres != 0)
+        return testres;
+    printf("Quiescence test passed!\n");
+    printf("------\n");
+    printf("Testing the endgame bitbase...\n");
+    testres = test_bitbase();
+    if (testres != 0)
+        return testres;
+    printf("Bitbase test passed!\n");
     return testres;
 }
 
@@ -69,6 +183,12 @@ int test_load_save()
         return 1;
     }
     DEBUG_PRINT("\treconstructed tree successfully\n");
+    // a cut off file must be rejected, not read past its end
+    if (load_tree(raw_input.substr(0, raw_input.size() / 2)) != nullptr)
+    {
+        printf("\tTruncated tree was loaded!\n");
+        return 1;
+    }
 
     destroy_tree(tree1);
     destroy_tree(tree2);
@@ -78,6 +198,61 @@ int test_load_save()
     return 0;
 }
 
+int test_save_buffer()
+{
+    // a bigger tree than in test_load_save, so the writer goes up and down several levels
+    array<array<Piece, 8>, 8> start_board = create_board("default");
+    GameState init(Board(start_board), 1);
+    Move default_move(-1, -1, -1, -1, false, -1, -1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, default_move, nullptr, {}, 0, 0, false, false);
+    train(tree1, 50);
+    ostringstream out;
+    save_tree(tree1, out);
+    string raw_input = out.str();
+    // the buffered writer must produce the same text as writing every node with save_leaf
+    {
+        ofstream reference_file("mcts_tree_ref.txt");
+        vector<pair<MCTS_leaf *, size_t>> stack = {{tree1, 0}};
+        tree1->save_leaf(reference_file);
+        while (!stack.empty())
+        {
+            MCTS_leaf *node = stack.back().first;
+            size_t next = stack.back().second++;
+            if (next == node->children.size())
+            {
+                reference_file << "$";
+                stack.pop_back();
+                continue;
+            }
+            node->children[next]->save_leaf(reference_file);
+            stack.push_back({node->children[next], 0});
+        }
+    }
+    string reference;
+    read_tree_file("mcts_tree_ref.txt", reference);
+    remove("mcts_tree_ref.txt");
+    if (reference != raw_input)
+    {
+        printf("\tsave_tree output differs from save_leaf!\n");
+        destroy_tree(tree1);
+        return 1;
+    }
+    MCTS_leaf *tree2 = load_tree(raw_input);
+    try
+    {
+        compare_trees(tree1, tree2);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(tree1);
+    destroy_tree(tree2);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
 int test_jump()
 {
     // create, expand and save tree
@@ -120,6 +295,49 @@ int test_jump()
     return 0;
 }
 
+int test_selection()
+{
+    array<array<Piece, 8>, 8> start_board = create_board("default");
+    GameState init(Board(start_board), 1);
+    Move default_move(-1, -1, -1, -1, false, -1, -1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, default_move, nullptr, {}, 0, 0, false, false);
+    DEBUG_PRINT("\tcreated tree\n");
+    // the root has a child, but the other moves are not explored yet, so selection stops at the root
+    MCTS_leaf *child = expansion(tree1);
+    backpropagation(child, simulation(child));
+    if (selection(tree1) != tree1)
+    {
+        printf("\tSelection did not stop at a node with unexplored moves!\n");
+        return 1;
+    }
+    // once every move has a child, selection goes down to one of them
+    while (tree1->num_children() < tree1->state.num_possible_moves())
+    {
+        child = expansion(tree1);
+        backpropagation(child, simulation(child));
+    }
+    MCTS_leaf *selected = selection(tree1);
+    if (selected == tree1 || selected->parent != tree1)
+    {
+        printf("\tSelection did not go down to a child of a fully expanded node!\n");
+        return 1;
+    }
+    destroy_tree(tree1);
+    // training therefore expands every move of the root, not only the first one
+    MCTS_leaf *tree2 = new MCTS_leaf(init, default_move, nullptr, {}, 0, 0, false, false);
+    train(tree2, 100);
+    tree2->state.list_all_possible_moves(tree2->state.get_current_player());
+    if (tree2->num_children() != tree2->state.num_possible_moves())
+    {
+        printf("\tTraining did not expand all moves of the root!\n");
+        return 1;
+    }
+    destroy_tree(tree2);
+    DEBUG_PRINT("\tdestroyed trees \n==> Graceful exit\n");
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
 int test_king()
 {
     // create, expand and save tree
@@ -206,6 +424,943 @@ int test_win()
     return 0;
 }
 
+int test_perft()
+{
+    // published perft numbers for the standard starting position up to depth 6; the generator has no
+    // multi-jumps, so from depth 7 on its counts differ from the published 179740 and 846931 and the
+    // engine's own numbers are checked instead, to catch any change of the generator
+    unsigned long long expected[] = {7, 49, 302, 1469, 7361, 36768, 180018, 844361};
+    GameState init(Board(create_board("default")), PLAYER1);
+    for (int depth = 1; depth <= 8; depth++)
+    {
+        unsigned long long nodes = perft(init, depth);
+        DEBUG_PRINT("\tperft(" << depth << ") = " << nodes << "\n");
+        if (nodes != expected[depth - 1])
+        {
+            printf("\tperft(%d) is %llu, expected %llu!\n", depth, nodes, expected[depth - 1]);
+            return 1;
+        }
+    }
+    // splitting the root over several threads must not change the result
+    PerftResult split = perft_divide(init, 5, 4);
+    unsigned long long divide_sum = 0;
+    for (auto &entry : split.divide)
+    {
+        divide_sum += entry.second;
+    }
+    if (split.nodes != expected[4] || divide_sum != expected[4] || split.divide.size() != expected[0])
+    {
+        printf("\tthreaded perft(5) is %llu, expected %llu!\n", split.nodes, expected[4]);
+        return 1;
+    }
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_binary_tree()
+{
+    // create and train a tree
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree1, 200);
+    // save it in the binary format and load it again
+    ostringstream out;
+    save_tree_binary(tree1, out);
+    string data = out.str();
+    MCTS_leaf *tree2 = load_tree(data);
+    if (tree2 == nullptr)
+    {
+        printf("\tBinary tree could not be loaded!\n");
+        return 1;
+    }
+    try
+    {
+        compare_trees(tree1, tree2);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    DEBUG_PRINT("\treconstructed binary tree successfully\n");
+    // a flipped byte must be detected by the checksum
+    data[data.size() / 2] ^= 0x01;
+    bool detected = false;
+    try
+    {
+        MCTS_leaf *broken = load_tree_binary(data);
+        destroy_tree(broken);
+    }
+    catch (const exception &e)
+    {
+        detected = true;
+    }
+    if (!detected)
+    {
+        printf("\tCorrupted binary tree was loaded!\n");
+        return 1;
+    }
+    destroy_tree(tree1);
+    destroy_tree(tree2);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_mapped_tree()
+{
+    const string file_name = "test_mapped_tree.bin";
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree1, 300);
+    if (!save_tree_file(tree1, file_name))
+    {
+        printf("\tCould not write %s!\n", file_name.c_str());
+        return 1;
+    }
+    // without preloading, mapping creates only the root
+    MCTS_leaf *tree2 = map_tree_file(file_name, 0);
+    if (tree2 == nullptr || !tree2->mapped || !tree2->children.empty())
+    {
+        printf("\tTree was not mapped!\n");
+        return 1;
+    }
+    // by default the first plies are created, everything below stays in the file
+    MCTS_leaf *preloaded = map_tree_file(file_name);
+    MCTS_leaf *node = preloaded;
+    for (int depth = 0; depth < TREE_PRELOAD_PLIES && node != nullptr; depth++)
+    {
+        if (node->mapped || node->children.empty())
+        {
+            printf("\tPly %d was not preloaded!\n", depth + 1);
+            return 1;
+        }
+        node = node->children[0];
+    }
+    if (node == nullptr || (node->mapped == nullptr && !node->children.empty()))
+    {
+        printf("\tNodes below the preloaded plies were created!\n");
+        return 1;
+    }
+    destroy_tree(preloaded);
+    try
+    {
+        // a partly created tree must be saved completely
+        ostringstream out;
+        save_tree_binary(tree2, out);
+        MCTS_leaf *tree3 = load_tree_binary(out.str());
+        compare_trees(tree1, tree3);
+        destroy_tree(tree3);
+        // training on the mapped tree must not change the file
+        train(tree2, 100);
+        MCTS_leaf *tree4 = map_tree_file(file_name);
+        compare_trees(tree1, tree4);
+        destroy_tree(tree4);
+        if (tree2->total_games != tree1->total_games + 100)
+        {
+            printf("\tTraining on the mapped tree was lost!\n");
+            return 1;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(tree1);
+    destroy_tree(tree2);
+    remove(file_name.c_str());
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_journal()
+{
+    const string file_name = "test_journal.bin";
+    remove((file_name + ".journal").c_str());
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree1, 300);
+    if (!save_tree_file(tree1, file_name))
+    {
+        printf("\tCould not write %s!\n", file_name.c_str());
+        return 1;
+    }
+    destroy_tree(tree1);
+    try
+    {
+        // two sessions, each one appends only its own changes
+        MCTS_leaf *tree2 = open_tree_with_journal(file_name);
+        train(tree2, 100);
+        if (!save_tree_incremental(tree2, file_name))
+        {
+            printf("\tCould not append to the journal!\n");
+            return 1;
+        }
+        destroy_tree(tree2);
+        tree2 = open_tree_with_journal(file_name);
+        train(tree2, 100);
+        if (!save_tree_incremental(tree2, file_name))
+        {
+            printf("\tCould not append to the journal!\n");
+            return 1;
+        }
+        // nothing changed since the last save, so nothing is written
+        if (append_journal(tree2, file_name) != 0)
+        {
+            printf("\tUnchanged nodes were written again!\n");
+            return 1;
+        }
+        // the full tree, saved and loaded again, is the reference
+        ostringstream out;
+        save_tree_binary(tree2, out);
+        MCTS_leaf *expected = load_tree_binary(out.str());
+        destroy_tree(tree2);
+        if (expected->total_games != 500)
+        {
+            printf("\tGames of a session were lost!\n");
+            return 1;
+        }
+
+        MCTS_leaf *tree3 = open_tree_with_journal(file_name);
+        compare_trees(expected, tree3);
+        destroy_tree(tree3);
+        // converting a tree with a pending journal keeps the games of the journal
+        const string converted_name = "test_journal_converted.bin";
+        string args[] = {file_name, converted_name};
+        char *argv[] = {&args[0][0], &args[1][0]};
+        if (convert_main(2, argv) != 0)
+        {
+            printf("\tCould not convert the tree!\n");
+            return 1;
+        }
+        MCTS_leaf *converted = open_tree_file(converted_name);
+        compare_trees(expected, converted);
+        destroy_tree(converted);
+        remove(converted_name.c_str());
+        // after compaction the snapshot contains everything and the journal is empty
+        string old_journal;
+        read_tree_file(file_name + ".journal", old_journal);
+        if (!compact_journal(file_name))
+        {
+            printf("\tCould not compact the journal!\n");
+            return 1;
+        }
+        MCTS_leaf *tree4 = open_tree_file(file_name);
+        compare_trees(expected, tree4);
+        destroy_tree(tree4);
+        tree4 = open_tree_with_journal(file_name);
+        compare_trees(expected, tree4);
+        // a compaction that stopped after renaming the snapshot left the new journal in <file>.journal.next
+        // and the old journal in place; opening the tree finishes the swap
+        train(tree4, 50);
+        if (append_journal(tree4, file_name) <= 0)
+        {
+            printf("\tCould not append to the journal!\n");
+            return 1;
+        }
+        int games = tree4->total_games;
+        destroy_tree(tree4);
+        rename((file_name + ".journal").c_str(), (file_name + ".journal.next").c_str());
+        {
+            ofstream stale(file_name + ".journal", ios::binary);
+            stale << old_journal;
+        }
+        tree4 = open_tree_with_journal(file_name);
+        bool finished = tree4->total_games == games && !ifstream(file_name + ".journal.next").is_open();
+        destroy_tree(tree4);
+        if (!finished)
+        {
+            printf("\tAn interrupted compaction was not finished!\n");
+            return 1;
+        }
+        destroy_tree(expected);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    remove(file_name.c_str());
+    remove((file_name + ".journal").c_str());
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_pending_changes()
+{
+    const string file_name = "test_pending.bin";
+    remove((file_name + ".journal").c_str());
+    remove((file_name + ".pending").c_str());
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree, 300);
+    if (!save_tree_file(tree, file_name))
+    {
+        printf("\tCould not write %s!\n", file_name.c_str());
+        return 1;
+    }
+    destroy_tree(tree);
+    try
+    {
+        // two processes opened the same file; only the writer saves, the other one hands its games over
+        MCTS_leaf *writer = open_tree_with_journal(file_name);
+        MCTS_leaf *other = open_tree_with_journal(file_name);
+        train(other, 100);
+        TreeCheckpoint checkpoint = prepare_checkpoint(file_name);
+        take_checkpoint(other, checkpoint);
+        if (!write_pending_changes(checkpoint))
+        {
+            printf("\tCould not write the pending changes!\n");
+            return 1;
+        }
+        destroy_tree(other);
+        train(writer, 50);
+        if (add_pending_changes(writer, take_pending_changes(file_name)) <= 0 || writer->total_games != 450)
+        {
+            printf("\tThe pending changes were not added!\n");
+            return 1;
+        }
+        if (!take_pending_changes(file_name).empty())
+        {
+            printf("\tThe pending changes were not removed!\n");
+            return 1;
+        }
+        // the added games are dirty, so they are saved with the writer's own games
+        if (!save_tree_incremental(writer, file_name))
+        {
+            printf("\tCould not append to the journal!\n");
+            return 1;
+        }
+        destroy_tree(writer);
+        writer = open_tree_with_journal(file_name);
+        bool saved = writer->total_games == 450;
+        destroy_tree(writer);
+        if (!saved)
+        {
+            printf("\tThe pending changes were not saved!\n");
+            return 1;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    remove(file_name.c_str());
+    remove((file_name + ".journal").c_str());
+    remove((file_name + ".pending").c_str());
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_checkpoint()
+{
+    const string file_name = "test_checkpoint.bin";
+    remove((file_name + ".journal").c_str());
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree, 300);
+    if (!save_tree_file(tree, file_name))
+    {
+        printf("\tCould not write %s!\n", file_name.c_str());
+        return 1;
+    }
+    destroy_tree(tree);
+    try
+    {
+        tree = open_tree_with_journal(file_name);
+        train(tree, 100);
+        TreeCheckpoint checkpoint = prepare_checkpoint(file_name);
+        take_checkpoint(tree, checkpoint);
+        if (checkpoint.full || checkpoint.num_records == 0)
+        {
+            printf("\tExpected a journal block!\n");
+            return 1;
+        }
+        // the tree as it was when the checkpoint was taken
+        ostringstream out;
+        save_tree_binary(tree, out);
+        MCTS_leaf *expected = load_tree_binary(out.str());
+        // training between taking and writing the checkpoint must not end up in it
+        train(tree, 100);
+        if (!write_checkpoint(checkpoint))
+        {
+            printf("\tCould not write the checkpoint!\n");
+            return 1;
+        }
+        MCTS_leaf *loaded = open_tree_with_journal(file_name);
+        compare_trees(expected, loaded);
+        destroy_tree(loaded);
+
+        // a crash while appending leaves a torn block at the end, which must be ignored
+        if (!save_tree_incremental(tree, file_name))
+        {
+            printf("\tCould not append to the journal!\n");
+            return 1;
+        }
+        string journal;
+        read_tree_file(file_name + ".journal", journal);
+        ofstream torn(file_name + ".journal", ios::binary | ios::trunc);
+        torn.write(journal.data(), journal.size() - 3);
+        torn.close();
+        loaded = open_tree_with_journal(file_name);
+        compare_trees(expected, loaded);
+        destroy_tree(loaded);
+        destroy_tree(expected);
+        destroy_tree(tree);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    remove(file_name.c_str());
+    remove((file_name + ".journal").c_str());
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+/**
+ * @brief Checks that every node of `merged` has the summed statistics of the nodes with the same moves in `inputs`
+ * and that no child of an input is missing.
+ */
+static void check_merged(MCTS_leaf *merged, vector<MCTS_leaf *> inputs)
+{
+    int wins = 0;
+    int total_games = 0;
+    size_t max_children = 0;
+    for (MCTS_leaf *input : inputs)
+    {
+        wins += input->wins;
+        total_games += input->total_games;
+        ensure_children(input);
+        max_children = max(max_children, input->children.size());
+    }
+    if (merged->wins != wins || merged->total_games != total_games)
+    {
+        throw runtime_error("Merged statistics mismatch\n");
+    }
+    ensure_children(merged);
+    if (merged->children.size() < max_children)
+    {
+        throw runtime_error("Merged children missing\n");
+    }
+    for (MCTS_leaf *child : merged->children)
+    {
+        vector<MCTS_leaf *> matching;
+        for (MCTS_leaf *input : inputs)
+        {
+            for (MCTS_leaf *input_child : input->children)
+            {
+                if (input_child->get_move_info() == child->get_move_info())
+                {
+                    matching.push_back(input_child);
+                }
+            }
+        }
+        if (matching.empty())
+        {
+            throw runtime_error("Merged tree has a child that no input has\n");
+        }
+        check_merged(child, matching);
+    }
+}
+
+int test_merge()
+{
+    // two trees trained separately; the second one is saved as text first and has to be converted
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree1 = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    MCTS_leaf *tree2 = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    srand(1);
+    train(tree1, 300);
+    srand(2);
+    train(tree2, 200);
+    {
+        ofstream out1("test_merge_1.bin", ios::binary);
+        save_tree_binary(tree1, out1);
+        ofstream out2("test_merge_2.txt");
+        save_tree(tree2, out2);
+    }
+    try
+    {
+        bool rejected = false;
+        try
+        {
+            merge_tree_files({"test_merge_1.bin", "test_merge_2.txt"}, "test_merge_out.bin");
+        }
+        catch (const runtime_error &)
+        {
+            rejected = true;
+        }
+        if (!rejected)
+        {
+            printf("\tA text tree was merged without being converted!\n");
+            return 1;
+        }
+        string args[] = {"test_merge_2.txt", "test_merge_2.bin", "--binary"};
+        char *argv[] = {&args[0][0], &args[1][0], &args[2][0]};
+        if (convert_main(3, argv) != 0)
+        {
+            printf("\tUnable to convert the text tree!\n");
+            return 1;
+        }
+        uint64_t num_nodes = merge_tree_files({"test_merge_1.bin", "test_merge_2.bin"}, "test_merge_out.bin");
+        MCTS_leaf *merged = map_tree_file("test_merge_out.bin");
+        if (merged == nullptr || num_nodes < 300)
+        {
+            printf("\tMerged tree is too small!\n");
+            return 1;
+        }
+        check_merged(merged, {tree1, tree2});
+        destroy_tree(merged);
+        if (ifstream("test_merge_out.bin.queue.0").is_open() || ifstream("test_merge_out.bin.queue.1").is_open())
+        {
+            printf("\tThe queue files of the merge were not removed!\n");
+            return 1;
+        }
+        // merging a tree with itself doubles its statistics
+        merge_tree_files({"test_merge_1.bin", "test_merge_1.bin"}, "test_merge_out.bin");
+        merged = map_tree_file("test_merge_out.bin");
+        check_merged(merged, {tree1, tree1});
+        destroy_tree(merged);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(tree1);
+    destroy_tree(tree2);
+    remove("test_merge_1.bin");
+    remove("test_merge_2.txt");
+    remove("test_merge_2.bin");
+    remove("test_merge_out.bin");
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_opening_book()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    srand(3);
+    train(tree, 500);
+    // the hash depends on the side to move
+    GameState other_side(Board(create_board("default")), PLAYER2);
+    if (init.hash() != init.clone().hash() || init.hash() == other_side.hash())
+    {
+        printf("\tPosition hash is not stable or ignores the side to move!\n");
+        return 1;
+    }
+    try
+    {
+        ostringstream out;
+        uint64_t num_positions = export_book(tree, out, 10, 4);
+        shared_ptr<OpeningBook> book = OpeningBook::from_buffer(out.str());
+        if (num_positions < 2 || book->get_num_positions() != num_positions)
+        {
+            printf("\tOpening book has %llu positions!\n", static_cast<unsigned long long>(num_positions));
+            return 1;
+        }
+        // the root position has all moves of the root with their statistics, the best is the most visited one
+        vector<BookMove> moves = book->probe(init);
+        if (moves.size() != tree->children.size())
+        {
+            printf("\tRoot position has %zu moves in the book instead of %zu!\n", moves.size(), tree->children.size());
+            return 1;
+        }
+        MCTS_leaf *most_visited = tree->children[0];
+        for (MCTS_leaf *child : tree->children)
+        {
+            if (child->total_games > most_visited->total_games)
+                most_visited = child;
+        }
+        Move best;
+        if (!book->best_move(init, best) || best.get_move_info() != most_visited->get_move_info())
+        {
+            printf("\tBook move is not the most visited move!\n");
+            return 1;
+        }
+        for (BookMove &book_move : moves)
+        {
+            if (book_move.move.get_move_info() == most_visited->get_move_info() &&
+                (book_move.visits != static_cast<uint32_t>(most_visited->total_games) || book_move.wins != static_cast<uint32_t>(most_visited->wins)))
+            {
+                printf("\tBook statistics do not match the tree!\n");
+                return 1;
+            }
+        }
+        // the same book mapped from a file
+        {
+            ofstream book_file("test_book.bin", ios::binary);
+            book_file << out.str();
+        }
+        shared_ptr<OpeningBook> mapped = OpeningBook::open("test_book.bin");
+        remove("test_book.bin");
+        if (mapped == nullptr || mapped->probe(init).size() != moves.size() || OpeningBook::open("test_book.bin") != nullptr)
+        {
+            printf("\tMapped opening book differs!\n");
+            return 1;
+        }
+        // positions that are not in the book
+        if (!book->probe(other_side).empty() || book->best_move(other_side, best))
+        {
+            printf("\tFound a position that is not in the book!\n");
+            return 1;
+        }
+        // a corrupted book is rejected
+        string corrupted = out.str();
+        corrupted[BOOK_HEADER_SIZE] ^= 1;
+        bool rejected = false;
+        try
+        {
+            OpeningBook::from_buffer(corrupted);
+        }
+        catch (const runtime_error &)
+        {
+            rejected = true;
+        }
+        if (!rejected)
+        {
+            printf("\tCorrupted book was accepted!\n");
+            return 1;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(tree);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+/**
+ * @brief Checks that every node of `pruned` has at least `min_visits` games, is at most `max_depth` plies deep
+ * and has the statistics of the node with the same moves in `full`.
+ */
+static void check_pruned(MCTS_leaf *pruned, MCTS_leaf *full, int min_visits, int max_depth, int depth)
+{
+    if (pruned->wins != full->wins || pruned->total_games != full->total_games)
+        throw runtime_error("Statistics mismatch\n");
+    if (depth > 0 && (pruned->total_games < min_visits || depth > max_depth))
+        throw runtime_error("Node was not pruned\n");
+    ensure_children(pruned);
+    ensure_children(full);
+    for (MCTS_leaf *child : pruned->children)
+    {
+        MCTS_leaf *match = nullptr;
+        for (MCTS_leaf *full_child : full->children)
+        {
+            if (full_child->get_move_info() == child->get_move_info())
+                match = full_child;
+        }
+        if (match == nullptr)
+            throw runtime_error("Pruned tree has a node that is not in the full tree\n");
+        check_pruned(child, match, min_visits, max_depth, depth + 1);
+    }
+}
+
+int test_pruning()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    srand(4);
+    train(tree, 500);
+    uint64_t num_nodes = count_tree_nodes(tree);
+    try
+    {
+        for (bool binary : {true, false})
+        {
+            SavePruning pruning;
+            pruning.min_visits = 3;
+            pruning.max_depth = 5;
+            ostringstream out;
+            if (binary)
+                save_tree_binary(tree, out, &pruning);
+            else
+                save_tree(tree, out, &pruning);
+            MCTS_leaf *pruned = load_tree(out.str());
+            if (pruning.nodes_written + pruning.nodes_dropped != num_nodes || pruning.nodes_dropped == 0 ||
+                count_tree_nodes(pruned) != pruning.nodes_written)
+            {
+                printf("\tWrong node counts: %llu written, %llu dropped, %llu in the tree!\n",
+                       static_cast<unsigned long long>(pruning.nodes_written),
+                       static_cast<unsigned long long>(pruning.nodes_dropped), static_cast<unsigned long long>(num_nodes));
+                return 1;
+            }
+            check_pruned(pruned, tree, pruning.min_visits, pruning.max_depth, 0);
+            destroy_tree(pruned);
+        }
+        // pruning a mapped tree reads the dropped records from the file
+        {
+            ostringstream out;
+            save_tree_binary(tree, out);
+            MCTS_leaf *mapped = load_tree_binary(out.str());
+            SavePruning pruning;
+            pruning.min_visits = 3;
+            ostringstream pruned_out;
+            save_tree_binary(mapped, pruned_out, &pruning);
+            if (count_tree_nodes(mapped) != num_nodes || pruning.nodes_written + pruning.nodes_dropped != num_nodes)
+            {
+                printf("\tWrong node counts for the mapped tree!\n");
+                return 1;
+            }
+            MCTS_leaf *pruned = load_tree(pruned_out.str());
+            check_pruned(pruned, tree, pruning.min_visits, INT32_MAX, 0);
+            destroy_tree(pruned);
+            destroy_tree(mapped);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(tree);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_train_parallel()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    auto new_tree = [&]()
+    { return new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false); };
+    srand(5);
+    MCTS_leaf *base = new_tree();
+    train(base, 200);
+    {
+        ofstream out("test_train.bin", ios::binary);
+        save_tree_binary(base, out);
+    }
+    try
+    {
+        // three threads, each on its own copy of the file, with a checkpoint every 300 iterations
+        MCTS_leaf *tree = map_tree_file("test_train.bin");
+        TrainOptions options;
+        options.iterations = 1000;
+        options.threads = 3;
+        options.checkpoint_every = 300;
+        int checkpoints = 0;
+        TrainReport report = train_parallel(tree, options, []()
+                                            { return map_tree_file("test_train.bin"); }, [&](MCTS_leaf *root, const TrainReport &)
+                                            {
+            checkpoints++;
+            // all games of the round have been added up at every checkpoint
+            if (root->total_games != 200 + 300 * checkpoints)
+                throw runtime_error("Wrong number of games at a checkpoint\n"); });
+        if (report.iterations != 1000 || report.checkpoints != 3 || checkpoints != 3 || tree->total_games != 1200)
+        {
+            printf("\tParallel training ran %lld iterations (%d games), %d checkpoints!\n", report.iterations, tree->total_games, report.checkpoints);
+            return 1;
+        }
+        // the added changes are dirty, so the journal gets them and replaying it gives the same tree
+        if (!save_tree_incremental(tree, "test_train.bin"))
+        {
+            printf("\tUnable to save the trained tree!\n");
+            return 1;
+        }
+        MCTS_leaf *reloaded = open_tree_with_journal("test_train.bin");
+        compare_trees(tree, reloaded);
+        destroy_tree(reloaded);
+        destroy_tree(tree);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    destroy_tree(base);
+    remove("test_train.bin");
+    remove("test_train.bin.journal");
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_train_resume()
+{
+    GameState init(Board(create_board("default")), PLAYER1);
+    auto new_tree = [&]()
+    { return new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false); };
+    auto no_copy = []() -> MCTS_leaf *
+    { return nullptr; };
+    try
+    {
+        // one run of 600 iterations
+        MCTS_leaf *straight = new_tree();
+        TrainOptions options;
+        options.iterations = 600;
+        options.random_states = {12345};
+        train_parallel(straight, options, no_copy, [](MCTS_leaf *, const TrainReport &) {});
+
+        // the same run, stopped at its first checkpoint; the state goes through a state file
+        MCTS_leaf *resumed = new_tree();
+        atomic<bool> stop(false);
+        options.checkpoint_every = 300;
+        options.stop = &stop;
+        TrainReport first = train_parallel(resumed, options, no_copy, [&](MCTS_leaf *, const TrainReport &)
+                                           { stop = true; });
+        if (!first.stopped || first.iterations != 300 || resumed->total_games != 300)
+        {
+            printf("\tStopped training ran %lld iterations (%d games)!\n", first.iterations, resumed->total_games);
+            return 1;
+        }
+        TrainState state;
+        state.iterations_done = first.iterations;
+        state.iterations = 600;
+        state.seconds_done = first.seconds;
+        state.checkpoints = first.checkpoints;
+        state.random_states = first.random_states;
+        TrainState read;
+        if (!write_train_state("test_train.bin.train", state) || !read_train_state("test_train.bin.train", read) ||
+            read.iterations_done != 300 || read.iterations != 600 || read.checkpoints != 1 || read.random_states != first.random_states)
+        {
+            printf("\tThe training state file was not read back!\n");
+            return 1;
+        }
+        // the rest of the run continues with the saved generator and ends with the same tree
+        stop = false;
+        options.iterations = read.iterations - read.iterations_done;
+        options.random_states = read.random_states;
+        TrainReport second = train_parallel(resumed, options, no_copy, [](MCTS_leaf *, const TrainReport &) {});
+        if (second.stopped || second.iterations != 300)
+        {
+            printf("\tResumed training ran %lld iterations!\n", second.iterations);
+            return 1;
+        }
+        compare_trees(straight, resumed);
+        destroy_tree(straight);
+        destroy_tree(resumed);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    remove("test_train.bin.train");
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_selfplay()
+{
+    EngineConfig config = parse_engine_config("iterations=5,c=0.5,rollout=promote,cutoff=30");
+    if (config.iterations != 5 || config.params.c != 0.5 || config.params.rollout != ROLLOUT_PROMOTE || config.params.rollout_cutoff != 30 || config.seconds != 0)
+    {
+        printf("\tEngine configuration was not parsed: %s\n", engine_config_to_string(config).c_str());
+        return 1;
+    }
+    try
+    {
+        parse_engine_config("speed=3");
+        printf("\tUnknown engine setting was accepted!\n");
+        return 1;
+    }
+    catch (const runtime_error &)
+    {
+    }
+    double low, high;
+    if (elo_difference(0.5) != 0 || fabs(elo_difference(0.75) - 190.85) > 0.01)
+    {
+        printf("\tWrong Elo difference: %f\n", elo_difference(0.75));
+        return 1;
+    }
+    MatchResult even;
+    even.wins = 30;
+    even.draws = 40;
+    even.losses = 30;
+    if (match_elo(even, low, high) != 0 || !(low < 0 && high > 0 && fabs(low + high) < 1e-9))
+    {
+        printf("\tWrong error bars: %f .. %f\n", low, high);
+        return 1;
+    }
+
+    // a short match; every game has its own seed, so the number of threads does not change the result
+    MatchOptions options;
+    options.games = 4;
+    options.threads = 2;
+    options.seed = 7;
+    options.max_plies = 40;
+    EngineConfig engine_a = parse_engine_config("iterations=5");
+    EngineConfig engine_b = parse_engine_config("iterations=5,c=0.7,rollout=promote");
+    MatchResult result = play_match(engine_a, engine_b, options);
+    options.threads = 1;
+    MatchResult again = play_match(engine_a, engine_b, options);
+    if (result.wins + result.draws + result.losses != 4 || result.a.moves == 0 || result.b.moves == 0 ||
+        result.a.iterations != 5 * result.a.moves)
+    {
+        printf("\tMatch played %d games, %lld and %lld moves!\n", result.wins + result.draws + result.losses, result.a.moves, result.b.moves);
+        return 1;
+    }
+    if (again.wins != result.wins || again.draws != result.draws || again.losses != result.losses || again.a.moves != result.a.moves)
+    {
+        printf("\tThe match result depends on the number of threads!\n");
+        return 1;
+    }
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_search_params()
+{
+    SearchParams params;
+    params.c = 0.8;
+    params.rollout = ROLLOUT_PROMOTE;
+    params.rollout_cutoff = 1;
+    params.reply_iterations = 7;
+    SearchParams read;
+    if (!write_search_params("test_search_params.cfg", params) || !read_search_params("test_search_params.cfg", read) ||
+        read.c != 0.8 || read.rollout != ROLLOUT_PROMOTE || read.rollout_cutoff != 1 || read.reply_iterations != 7 ||
+        read.move_iterations != params.move_iterations)
+    {
+        printf("\tSearch parameters were not read back!\n");
+        return 1;
+    }
+    {
+        ofstream out("test_search_params.cfg");
+        out << "# comment\nc fast\n";
+    }
+    try
+    {
+        read_search_params("test_search_params.cfg", read);
+        printf("\tInvalid search parameter was accepted!\n");
+        return 1;
+    }
+    catch (const runtime_error &)
+    {
+    }
+    remove("test_search_params.cfg");
+
+    // with a cutoff of one ply, the rollouts from the children of the start position end before any capture is possible
+    GameState init(Board(create_board("default")), PLAYER1);
+    MCTS_leaf *tree = new MCTS_leaf(init, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    train(tree, 7, nullptr, params);
+    int wins = 0;
+    for (MCTS_leaf *child : tree->children)
+    {
+        wins += child->wins;
+    }
+    if (tree->total_games != 7 || tree->children.size() != 7 || wins != 0)
+    {
+        printf("\tRollouts with a cutoff were not scored as draws: %d games, %d wins!\n", tree->total_games, wins);
+        return 1;
+    }
+    // cal_rating uses the global C
+    MCTS_leaf *child = tree->children[0];
+    double expected = static_cast<double>(child->wins) / child->total_games + C * sqrt(log(7.0) / child->total_games);
+    if (fabs(child->cal_rating() - expected) > 1e-12)
+    {
+        printf("\tcal_rating() does not use C!\n");
+        return 1;
+    }
+    destroy_tree(tree);
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
 void compare_trees(MCTS_leaf *tree1, MCTS_leaf *tree2)
 {
     // if both are nullptr then return
@@ -228,6 +1383,13 @@ void compare_trees(MCTS_leaf *tree1, MCTS_leaf *tree2)
         throw runtime_error("Move mismatch\n");
         return;
     }
+    if (tree1->wins != tree2->wins || tree1->total_games != tree2->total_games)
+    {
+        throw runtime_error("Statistics mismatch\n");
+        return;
+    }
+    ensure_children(tree1);
+    ensure_children(tree2);
     if (tree1->children.size() != tree2->children.size())
         throw runtime_error("Tree size mismatch\n");
 
@@ -240,4 +1402,381 @@ void compare_trees(MCTS_leaf *tree1, MCTS_leaf *tree2)
         // }
         compare_trees(tree1->children[i], tree2->children[i]);
     }
-}
\ No newline at end of file
+}
+
+/** @brief Plain minimax with the scores of `AlphaBeta`, to check the pruning against. */
+static int minimax(GameState state, int depth, int ply)
+{
+    int player = state.get_current_player();
+    state.list_all_possible_moves(player);
+    int terminal = state.TerminalState();
+    if (terminal != -1)
+    {
+        if (terminal == NOPLAYER)
+            return 0;
+        return terminal == player ? AB_WIN - ply : -(AB_WIN - ply);
+    }
+    if (depth == 0)
+    {
+        // pending captures are played out, without a node budget
+        long long budget = 1 << 20;
+        return state.possible_moves[0].get_jump_type() ? quiescence(state, ply, -AB_INFINITY, AB_INFINITY, budget) : evaluate(state);
+    }
+    int best = -AB_INFINITY;
+    for (Move move : state.possible_moves)
+    {
+        GameState child = state.clone();
+        child.switch_player();
+        move.perform_move(child.get_board(), move);
+        best = max(best, -minimax(child, depth - 1, ply + 1));
+    }
+    return best;
+}
+
+int test_alphabeta()
+{
+    // the start position is symmetric
+    GameState init(Board(create_board("default")), PLAYER1);
+    if (evaluate(init) != 0)
+    {
+        printf("\tThe start position is not even: %d\n", evaluate(init));
+        return 1;
+    }
+    // the only move (a forced capture) is played without a search
+    GameState win(Board(create_board("win-test")), PLAYER2);
+    AlphaBeta searcher(12);
+    AlphaBetaResult result = searcher.search(win, 0, 4);
+    if (!result.found || !result.best.get_jump_type() || result.depth != 0)
+    {
+        printf("\tThe forced capture was not played!\n");
+        return 1;
+    }
+    // pruning, the table and the move ordering must not change the score
+    // (positions with a single move are not searched)
+    searcher.set_quiescence_nodes(1 << 20);
+    GameState state = init.clone();
+    for (int ply = 0; ply < 6; ply++)
+    {
+        state.list_all_possible_moves(state.get_current_player());
+        for (int depth = 1; depth <= 4 && state.possible_moves.size() > 1; depth++)
+        {
+            searcher.clear();
+            result = searcher.search(state, 0, depth);
+            int expected = minimax(state, depth, 0);
+            if (result.depth != depth || result.score != expected)
+            {
+                printf("\tAlpha-beta score %d at depth %d, minimax score %d!\n", result.score, depth, expected);
+                return 1;
+            }
+        }
+        Move move = state.possible_moves[ply % state.possible_moves.size()];
+        state.switch_player();
+        move.perform_move(state.get_board(), move);
+    }
+    // a search to a fixed depth is deterministic
+    searcher.clear();
+    AlphaBetaResult first = searcher.search(init, 0, 5);
+    searcher.clear();
+    AlphaBetaResult second = searcher.search(init, 0, 5);
+    if (!first.found || first.depth != 5 || first.nodes != second.nodes || first.best.get_move_info() != second.best.get_move_info())
+    {
+        printf("\tThe search is not deterministic: %lld and %lld nodes!\n", first.nodes, second.nodes);
+        return 1;
+    }
+    // the table and the killer moves of the first search make the second one cheaper
+    AlphaBetaResult warm = searcher.search(init, 0, 5);
+    if (warm.nodes >= first.nodes)
+    {
+        printf("\tThe transposition table did not help: %lld and %lld nodes!\n", first.nodes, warm.nodes);
+        return 1;
+    }
+    // alpha-beta engines in a match (forced moves and found wins end the search before the depth limit)
+    EngineConfig config = parse_engine_config("engine=alphabeta,depth=3");
+    if (config.engine != ENGINE_ALPHABETA || config.depth != 3 || parse_engine_config(engine_config_to_string(config)).depth != 3)
+    {
+        printf("\tAlpha-beta engine configuration was not parsed: %s\n", engine_config_to_string(config).c_str());
+        return 1;
+    }
+    MatchOptions options;
+    options.games = 2;
+    options.seed = 3;
+    options.max_plies = 30;
+    MatchResult match = play_match(config, parse_engine_config("iterations=5"), options);
+    if (match.wins + match.draws + match.losses != 2 || match.a.moves == 0 || match.a.depth == 0 || match.a.depth > 3 * match.a.moves)
+    {
+        printf("\tAlpha-beta match played %lld moves at depth %lld!\n", match.a.moves, match.a.depth);
+        return 1;
+    }
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_lazy_smp()
+{
+    // the lock-free table returns what was stored, and nothing for another key in the same slot
+    TranspositionTable table(10);
+    TTEntry entry;
+    entry.score = -AB_WIN + 3;
+    entry.depth = 7;
+    entry.bound = 2;
+    entry.move = 17;
+    entry.jump = 1;
+    table.store(0x123456789ABCDEFull, entry);
+    TTEntry found;
+    if (!table.probe(0x123456789ABCDEFull, found) || found.score != entry.score || found.depth != 7 || found.bound != 2 || found.move != 17 ||
+        found.jump != 1)
+    {
+        printf("\tThe table did not return the stored entry!\n");
+        return 1;
+    }
+    if (table.probe(0x123456789ABCDEFull ^ (1ull << 40), found))
+    {
+        printf("\tThe table returned the entry of another position!\n");
+        return 1;
+    }
+    table.clear();
+    if (table.probe(0x123456789ABCDEFull, found))
+    {
+        printf("\tThe table was not cleared!\n");
+        return 1;
+    }
+
+    // every thread searches and the result is a legal move
+    GameState init(Board(create_board("default")), PLAYER1);
+    init.list_all_possible_moves(PLAYER1);
+    ParallelAlphaBeta searcher(2, 14);
+    LazySMPResult result = searcher.search(init, 0.05);
+    long long nodes = 0;
+    for (const AlphaBetaResult &thread_result : result.threads)
+    {
+        nodes += thread_result.nodes;
+    }
+    if (!result.best.found || result.threads.size() != 2 || result.threads[0].nodes == 0 || result.best.nodes != nodes)
+    {
+        printf("\tParallel search: %s\n", lazy_smp_summary(result).c_str());
+        return 1;
+    }
+    bool legal = false;
+    for (Move move : init.possible_moves)
+    {
+        legal = legal || move.get_move_info() == result.best.best.get_move_info();
+    }
+    if (!legal)
+    {
+        printf("\tParallel search played an illegal move!\n");
+        return 1;
+    }
+    // a depth limit ends the search of the main thread
+    searcher.clear();
+    result = searcher.search(init, 0, 4);
+    if (result.best.depth < 4 || result.threads[0].depth != 4)
+    {
+        printf("\tParallel search to depth 4: %s\n", lazy_smp_summary(result).c_str());
+        return 1;
+    }
+    if (parse_engine_config("engine=alphabeta,time=0.01,threads=2").threads != 2)
+    {
+        printf("\tAlpha-beta threads were not parsed!\n");
+        return 1;
+    }
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_quiescence()
+{
+    // the capture generator finds the same jumps as the full generator, along random games
+    srand(5);
+    for (int game = 0; game < 20; game++)
+    {
+        GameState state(Board(create_board("default")), PLAYER1);
+        state.list_all_possible_moves(PLAYER1);
+        for (int ply = 0; ply < 300 && state.TerminalState() == -1; ply++)
+        {
+            vector<Move> moves = state.possible_moves;
+            GameState captures = state.clone();
+            captures.list_all_captures(captures.get_current_player());
+            bool jumps = moves[0].get_jump_type();
+            if (captures.possible_moves.size() != (jumps ? moves.size() : 0))
+            {
+                printf("\tThe capture generator found %zu jumps, the move generator %zu!\n", captures.possible_moves.size(), jumps ? moves.size() : 0);
+                return 1;
+            }
+            for (size_t i = 0; jumps && i < moves.size(); i++)
+            {
+                if (captures.possible_moves[i].get_move_info() != moves[i].get_move_info())
+                {
+                    printf("\tThe capture generator found another jump!\n");
+                    return 1;
+                }
+            }
+            Move move = moves[rand() % moves.size()];
+            state.switch_player();
+            move.perform_move(state.get_board(), move);
+            state.list_all_possible_moves(state.get_current_player());
+        }
+    }
+
+    // a quiet position keeps its static score
+    GameState init(Board(create_board("default")), PLAYER1);
+    long long budget = AB_QS_NODES;
+    if (quiescence(init, 0, -AB_INFINITY, AB_INFINITY, budget) != evaluate(init) || budget != AB_QS_NODES - 1)
+    {
+        printf("\tThe start position was not scored statically!\n");
+        return 1;
+    }
+    // player 2 must take the last piece of player 1: statically almost even, after the capture a win
+    GameState win(Board(create_board("win-test")), PLAYER2);
+    budget = AB_QS_NODES;
+    int score = quiescence(win, 0, -AB_INFINITY, AB_INFINITY, budget);
+    if (score != AB_WIN - 1 || abs(evaluate(win)) > AB_MAN_VALUE / 2)
+    {
+        printf("\tThe capture was not played out: %d (static %d)\n", score, evaluate(win));
+        return 1;
+    }
+    // without a budget, the position is scored statically
+    budget = 0;
+    if (quiescence(win, 0, -AB_INFINITY, AB_INFINITY, budget) != evaluate(win))
+    {
+        printf("\tThe node budget was ignored!\n");
+        return 1;
+    }
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
+
+int test_bitbase()
+{
+    // every index is decoded into a position that is encoded into the same index again
+    Material signatures[3];
+    signatures[0].men[0] = 1, signatures[0].men[1] = 1;
+    signatures[1].men[0] = 1, signatures[1].kings[0] = 1, signatures[1].kings[1] = 1;
+    signatures[2].kings[0] = 2, signatures[2].men[1] = 1;
+    GameState state(Board(), PLAYER1);
+    for (const Material &material : signatures)
+    {
+        for (uint64_t i = 0; i < bitbase_num_positions(material); i += 7)
+        {
+            bitbase_position(material, i, state);
+            if (material_of(state).key() != material.key() || bitbase_index(state, material) != i)
+            {
+                printf("\tPosition %llu of bitbase %s was not indexed back to itself!\n", static_cast<unsigned long long>(i), material.name().c_str());
+                return 1;
+            }
+        }
+    }
+
+    // generate the tables with 2 pieces; every result has to agree with the results after one move
+    string dir = "test_bitbases";
+    vector<BitbaseTableStats> all_stats = generate_bitbases(dir, 2, 2);
+    shared_ptr<Bitbase> bitbase = Bitbase::open(dir);
+    if (all_stats.size() != 4 || bitbase == nullptr || bitbase->num_tables() != 4 || bitbase->max_pieces() != 2)
+    {
+        printf("\tThe tables with 2 pieces were not generated!\n");
+        return 1;
+    }
+    for (const BitbaseTableStats &stats : all_stats)
+    {
+        for (uint64_t i = 0; i < stats.positions; i++)
+        {
+            if (!bitbase_position(stats.material, i, state))
+            {
+                continue;
+            }
+            int player = state.get_current_player();
+            int result = bitbase->probe(state);
+            state.list_all_possible_moves(player);
+            int expected = state.possible_moves.empty() ? (player == PLAYER1 ? BITBASE_WIN : BITBASE_LOSS) : BITBASE_LOSS;
+            for (Move &move : state.possible_moves)
+            {
+                GameState child = state.clone();
+                child.switch_player();
+                move.perform_move(child.get_board(), move);
+                int child_result = child.get_board()->get_num_players(child.get_current_player()) == 0 ? BITBASE_LOSS : bitbase->probe(child);
+                if (child_result == BITBASE_LOSS)
+                {
+                    expected = BITBASE_WIN;
+                }
+                else if (child_result == BITBASE_DRAW && expected == BITBASE_LOSS)
+                {
+                    expected = BITBASE_DRAW;
+                }
+            }
+            if (result != expected)
+            {
+                printf("\tPosition %llu of bitbase %s is %d, after one move it is %d!\n", static_cast<unsigned long long>(i), stats.material.name().c_str(), result, expected);
+                return 1;
+            }
+        }
+    }
+    // the side to move takes the other piece
+    GameState win(Board(create_board("win-test")), PLAYER2);
+    if (bitbase->probe(win) != BITBASE_WIN)
+    {
+        printf("\tThe capture of the last piece is not a win!\n");
+        return 1;
+    }
+    // a damaged table is refused
+    string content;
+    {
+        ifstream in(dir + "/bitbase_1010.bin", ios::binary);
+        content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    content[BITBASE_HEADER_SIZE] ^= 1;
+    Bitbase damaged;
+    try
+    {
+        damaged.add_table(MappedFile::from_buffer(content));
+        printf("\tA damaged table was accepted!\n");
+        return 1;
+    }
+    catch (const runtime_error &)
+    {
+    }
+
+    // rollouts from solved positions end with the exact result, and the tree does not grow below them
+    Material kings;
+    kings.kings[0] = 1, kings.kings[1] = 1;
+    uint64_t draw = 0;
+    while (draw < bitbase_num_positions(kings) && (!bitbase_position(kings, draw, state) || bitbase->probe(state) != BITBASE_DRAW))
+    {
+        draw++;
+    }
+    if (draw == bitbase_num_positions(kings))
+    {
+        printf("\tTwo kings never draw!\n");
+        return 1;
+    }
+    set_bitbase(bitbase);
+    state.list_all_possible_moves(state.get_current_player());
+    MCTS_leaf *leaf = new MCTS_leaf(state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, false, false);
+    TrainStats stats;
+    train(leaf, 50, &stats);
+    set_bitbase(nullptr);
+    if (stats.bitbase_hits != 50 || stats.max_depth != 1 || leaf->total_games != 50)
+    {
+        printf("\tThe bitbase was not used by the search (%lld hits, depth %d)!\n", stats.bitbase_hits, stats.max_depth);
+        destroy_tree(leaf);
+        return 1;
+    }
+    for (MCTS_leaf *child : leaf->children)
+    {
+        // the player who moved into the child wins all of its games or none
+        int winner = NOPLAYER;
+        bitbase->winner(child->state, winner);
+        if (child->wins != (winner == leaf->state.get_current_player() ? child->total_games : 0))
+        {
+            printf("\tA child has %d wins in %d games, the bitbase says player %d wins!\n", child->wins, child->total_games, winner);
+            destroy_tree(leaf);
+            return 1;
+        }
+    }
+    destroy_tree(leaf);
+    for (const BitbaseTableStats &s : all_stats)
+    {
+        remove((dir + "/bitbase_" + s.material.name() + ".bin").c_str());
+    }
+    remove(dir.c_str());
+    DEBUG_PRINT("---------------------------------\n");
+    return 0;
+}
@@ -3,6 +3,14 @@
 
 #include "classes.hpp"
 #include "mcts_algorithm.hpp"
+#include "perft.hpp"
+#include "tree_format.hpp"
+#include "opening_book.hpp"
+#include "training.hpp"
+#include "selfplay.hpp"
+#include "alphabeta.hpp"
+#include "bitbase.hpp"
+#include <sstream>
 
 using namespace std;
 
@@ -10,12 +18,50 @@ int all_tests();
 
 int test_load_save();
 
+int test_save_buffer();
+
 int test_jump();
 
+int test_selection();
+
 int test_king();
 
 int test_win();
 
+int test_perft();
+
+int test_binary_tree();
+
+int test_mapped_tree();
+
+int test_journal();
+
+int test_checkpoint();
+
+int test_pending_changes();
+
+int test_merge();
+
+int test_opening_book();
+
+int test_pruning();
+
+int test_train_parallel();
+
+int test_train_resume();
+
+int test_selfplay();
+
+int test_search_params();
+
+int test_alphabeta();
+
+int test_lazy_smp();
+
+int test_quiescence();
+
+int test_bitbase();
+
 void compare_trees(MCTS_leaf *, MCTS_leaf *);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "training.hpp"
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+TrainReport train_parallel(MCTS_leaf *root_node, const TrainOptions &options, const function<MCTS_leaf *()> &open_copy,
+                           const function<void(MCTS_leaf *, const TrainReport &)> &on_checkpoint)
+{
+    TrainReport report;
+    auto start = chrono::steady_clock::now();
+    auto deadline = chrono::steady_clock::time_point::max();
+    if (options.seconds > 0)
+    {
+        deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.seconds));
+    }
+    long long limit = options.iterations > 0 ? options.iterations : LLONG_MAX;
+    int num_threads = max(1, options.threads);
+    vector<MCTS_leaf *> trees = {root_node};
+    for (int i = 1; i < num_threads; i++)
+    {
+        trees.push_back(open_copy());
+    }
+    bool seeded = !options.random_states.empty();
+    report.random_states = options.random_states;
+    for (size_t i = report.random_states.size(); seeded && i < static_cast<size_t>(num_threads); i++)
+    {
+        // more threads than saved states: derive the missing ones (xorshift needs a state other than 0)
+        unsigned int derived = report.random_states[0] ^ static_cast<unsigned int>(i * 0x9E3779B9u);
+        report.random_states.push_back(derived != 0 ? derived : 1);
+    }
+    unsigned int outer_random_state = get_thread_random_state();
+    auto stop_requested = [&]()
+    { return options.stop != nullptr && options.stop->load(); };
+
+    while (report.iterations < limit && chrono::steady_clock::now() < deadline && !stop_requested())
+    {
+        // one round ends at the next checkpoint (or at the end); the threads take chunks of iterations until it is reached
+        long long round_end = limit;
+        if (options.checkpoint_every > 0)
+        {
+            round_end = min(limit, report.iterations + options.checkpoint_every);
+        }
+        auto round_deadline = deadline;
+        if (options.checkpoint_seconds > 0)
+        {
+            round_deadline = min(deadline, chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                                               chrono::duration<double>(options.checkpoint_seconds)));
+        }
+        // without saved states, thread 0 keeps using rand() and every worker gets a generator seeded from it
+        vector<unsigned int> states = report.random_states;
+        if (!seeded)
+        {
+            states.assign(num_threads, 0);
+            for (int i = 1; i < num_threads; i++)
+            {
+                states[i] = static_cast<unsigned int>(rand()) | 1;
+            }
+        }
+        atomic<long long> next(report.iterations);
+        atomic<long long> done(0);
+        auto work = [&](int index)
+        {
+            seed_thread_random(states[index]);
+            while (chrono::steady_clock::now() < round_deadline && !stop_requested())
+            {
+                long long first = next.fetch_add(TRAIN_CHUNK);
+                if (first >= round_end)
+                {
+                    break;
+                }
+                long long count = min<long long>(TRAIN_CHUNK, round_end - first);
+                train(trees[index], static_cast<int>(count));
+                done += count;
+            }
+            states[index] = get_thread_random_state();
+        };
+        vector<thread> workers;
+        for (int i = 1; i < num_threads; i++)
+        {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for (thread &worker : workers)
+        {
+            worker.join();
+        }
+        if (seeded)
+        {
+            report.random_states = states;
+        }
+        report.iterations += done;
+        for (int i = 1; i < num_threads; i++)
+        {
+            add_tree_changes(root_node, trees[i]);
+        }
+        // the last round is saved by the caller
+        bool finished = report.iterations >= limit || chrono::steady_clock::now() >= deadline || stop_requested();
+        if (!finished && (options.checkpoint_every > 0 || options.checkpoint_seconds > 0))
+        {
+            report.checkpoints++;
+            report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            on_checkpoint(root_node, report);
+        }
+    }
+    report.stopped = stop_requested();
+    seed_thread_random(outer_random_state);
+    for (int i = 1; i < num_threads; i++)
+    {
+        destroy_tree(trees[i]);
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+// ----- training state files -----
+bool write_train_state(const string &path, const TrainState &state)
+{
+    string tmp_path = path + ".tmp";
+    {
+        ofstream out(tmp_path);
+        if (!out.is_open())
+        {
+            return false;
+        }
+        out << TRAIN_STATE_MAGIC << "\n";
+        out << "iterations_done " << state.iterations_done << "\n";
+        out << "iterations " << state.iterations << "\n";
+        out.precision(17);
+        out << "seconds_done " << state.seconds_done << "\n";
+        out << "seconds " << state.seconds << "\n";
+        out << "checkpoints " << state.checkpoints << "\n";
+        out << "checkpoint_every " << state.checkpoint_every << "\n";
+        out << "checkpoint_seconds " << state.checkpoint_seconds << "\n";
+        out << "random";
+        for (unsigned int random_state : state.random_states)
+        {
+            out << " " << random_state;
+        }
+        out << "\n";
+        if (!out.good())
+        {
+            return false;
+        }
+    }
+    return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool read_train_state(const string &path, TrainState &state)
+{
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    string line;
+    if (!getline(in, line) || line != TRAIN_STATE_MAGIC)
+    {
+        throw runtime_error(path + " is not a training state file.");
+    }
+    state = TrainState();
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string key;
+        fields >> key;
+        if (key == "iterations_done")
+            fields >> state.iterations_done;
+        else if (key == "iterations")
+            fields >> state.iterations;
+        else if (key == "seconds_done")
+            fields >> state.seconds_done;
+        else if (key == "seconds")
+            fields >> state.seconds;
+        else if (key == "checkpoints")
+            fields >> state.checkpoints;
+        else if (key == "checkpoint_every")
+            fields >> state.checkpoint_every;
+        else if (key == "checkpoint_seconds")
+            fields >> state.checkpoint_seconds;
+        else if (key == "random")
+        {
+            unsigned int random_state;
+            while (fields >> random_state)
+            {
+                state.random_states.push_back(random_state);
+            }
+        }
+        if (fields.fail() && !fields.eof())
+        {
+            throw runtime_error("Invalid line in " + path + ": " + line);
+        }
+    }
+    return true;
+}
+
+// ----- command line -----
+/**
+ * @class CheckpointWriter
+ * @brief Writes checkpoints (and the state file after them) on a background thread, one at a time.
+ */
+class CheckpointWriter
+{
+private:
+    thread worker;  /**< The running write. */
+    bool ok = true; /**< Result of the last write. */
+
+public:
+    ~CheckpointWriter() { wait(); }
+
+    /** @brief Waits for the running write and returns whether it succeeded. */
+    bool wait()
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+        return ok;
+    }
+
+    /** @brief Starts writing a checkpoint that was taken out of the tree; waits for the previous one first. */
+    void start(TreeCheckpoint checkpoint, const string &state_path, const TrainState &state)
+    {
+        wait();
+        worker = thread([this, checkpoint = std::move(checkpoint), state_path, state]()
+                        {
+            ok = write_checkpoint(checkpoint) && write_train_state(state_path, state);
+            // the compaction only reads the files, so it does not need the tree
+            if (ok && journal_needs_compaction(checkpoint.path))
+            {
+                compact_journal(checkpoint.path);
+            } });
+    }
+};
+
+// set by SIGINT and SIGTERM; the training stops after the running chunk
+static atomic<bool> train_stop_requested(false);
+
+static void request_train_stop(int)
+{
+    train_stop_requested = true;
+}
+
+/**
+ * @brief Loads the tree at `path` or creates a new one with the default board if there is no such file.
+ */
+static MCTS_leaf *open_or_create_tree(const string &path)
+{
+    MCTS_leaf *tree = open_tree_with_journal(path);
+    if (tree == nullptr)
+    {
+        GameState game_state(Board(create_board("default")), PLAYER1);
+        tree = new MCTS_leaf(game_state, Move(-1, -1, -1, -1, false, -1, -1), nullptr, {}, 0, 0, true, false);
+    }
+    return tree;
+}
+
+int train_main(int argc, char *argv[])
+{
+    TrainOptions options;
+    string in_path = "mcts_tree.txt";
+    string out_path = "";
+    bool resume = false;
+    bool usage_error = false;
+    unsigned int seed = static_cast<unsigned int>(chrono::system_clock::now().time_since_epoch().count());
+    for (int i = 0; i < argc && !usage_error; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--resume")
+        {
+            resume = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage_error = true;
+            break;
+        }
+        string value = argv[++i];
+        if (arg == "--iterations")
+            options.iterations = atoll(value.c_str());
+        else if (arg == "--time")
+            options.seconds = atof(value.c_str());
+        else if (arg == "--threads")
+            options.threads = atoi(value.c_str());
+        else if (arg == "--in")
+            in_path = value;
+        else if (arg == "--out")
+            out_path = value;
+        else if (arg == "--seed")
+            seed = static_cast<unsigned int>(strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--checkpoint-every")
+            options.checkpoint_every = atoll(value.c_str());
+        else if (arg == "--checkpoint-seconds")
+            options.checkpoint_seconds = atof(value.c_str());
+        else
+            usage_error = true;
+    }
+    if (out_path.empty())
+    {
+        out_path = in_path;
+    }
+    string state_path = out_path + ".train";
+
+    // the budget and the generators of the whole run; a resumed run continues with the saved ones
+    TrainState state;
+    bool resumed = false;
+    try
+    {
+        resumed = resume && read_train_state(state_path, state);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    if (resume && !resumed)
+    {
+        printf("nothing to resume in %s, starting a new run\n", state_path.c_str());
+    }
+    if (resumed)
+    {
+        in_path = out_path; // the last checkpoint
+        if (options.checkpoint_every == 0 && options.checkpoint_seconds == 0)
+        {
+            options.checkpoint_every = state.checkpoint_every;
+            options.checkpoint_seconds = state.checkpoint_seconds;
+        }
+        state.checkpoint_every = options.checkpoint_every;
+        state.checkpoint_seconds = options.checkpoint_seconds;
+        options.iterations = state.iterations > 0 ? max(0LL, state.iterations - state.iterations_done) : 0;
+        options.seconds = state.seconds > 0 ? max(0.0, state.seconds - state.seconds_done) : 0;
+        if (options.iterations == 0 && options.seconds == 0)
+        {
+            printf("the run in %s is already finished\n", state_path.c_str());
+            return 0;
+        }
+    }
+    else
+    {
+        state.iterations = options.iterations;
+        state.seconds = options.seconds;
+        state.checkpoint_every = options.checkpoint_every;
+        state.checkpoint_seconds = options.checkpoint_seconds;
+        srand(seed);
+        for (int i = 0; i < options.threads; i++)
+        {
+            state.random_states.push_back(static_cast<unsigned int>(rand()) | 1);
+        }
+    }
+    if (usage_error || (options.iterations <= 0 && options.seconds <= 0) || options.threads < 1)
+    {
+        cerr << "usage: checkers_exec train (--iterations N | --time S) [--threads T] [--in FILE] [--out FILE] [--seed X]\n"
+                "                           [--checkpoint-every M] [--checkpoint-seconds T] [--resume]\n";
+        return 1;
+    }
+    options.random_states = state.random_states;
+    options.stop = &train_stop_requested;
+
+    MCTS_leaf *tree;
+    try
+    {
+        tree = open_or_create_tree(in_path);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Unable to load " << in_path << ": " << e.what() << '\n';
+        return 1;
+    }
+    int games_before = tree->total_games;
+    uint64_t nodes_before = count_tree_nodes(tree);
+    if (resumed)
+    {
+        printf("resuming %s after %lld iterations (%d games, %llu nodes) with %d thread(s)\n", in_path.c_str(),
+               state.iterations_done, games_before, static_cast<unsigned long long>(nodes_before), options.threads);
+    }
+    else
+    {
+        printf("training %s (%d games, %llu nodes) with %d thread(s), seed %u\n", in_path.c_str(), games_before,
+               static_cast<unsigned long long>(nodes_before), options.threads, seed);
+    }
+    fflush(stdout);
+    signal(SIGINT, request_train_stop);
+    signal(SIGTERM, request_train_stop);
+
+    // the progress of the whole run after `report`
+    auto state_after = [&](const TrainReport &report)
+    {
+        TrainState after = state;
+        after.iterations_done += report.iterations;
+        after.seconds_done += report.seconds;
+        after.checkpoints += report.checkpoints;
+        after.random_states = report.random_states;
+        return after;
+    };
+    // the output file belongs to the tree only if it is the file the tree was loaded from
+    bool need_full = out_path != in_path;
+    CheckpointWriter writer;
+    TrainReport report = train_parallel(tree, options, [&]()
+                                        { return open_or_create_tree(in_path); }, [&](MCTS_leaf *root, const TrainReport &progress)
+                                        {
+        if (!writer.wait())
+        {
+            // the changes of the failed write are only in the tree now
+            need_full = true;
+        }
+        TreeCheckpoint checkpoint = prepare_checkpoint(out_path);
+        checkpoint.full = checkpoint.full || need_full;
+        take_checkpoint(root, checkpoint);
+        need_full = false;
+        writer.start(std::move(checkpoint), state_path, state_after(progress));
+        printf("checkpoint %d: %d games, %.1f s\n", state.checkpoints + progress.checkpoints, root->total_games, progress.seconds);
+        fflush(stdout); });
+
+    // the final save is written right away
+    if (!writer.wait())
+    {
+        need_full = true;
+    }
+    TreeCheckpoint checkpoint = prepare_checkpoint(out_path);
+    checkpoint.full = checkpoint.full || need_full;
+    take_checkpoint(tree, checkpoint);
+    bool saved = write_checkpoint(checkpoint);
+    if (!saved && !checkpoint.full)
+    {
+        checkpoint.full = true;
+        take_checkpoint(tree, checkpoint);
+        saved = write_checkpoint(checkpoint);
+    }
+    TrainState final_state = state_after(report);
+    if (saved && report.stopped)
+    {
+        saved = write_train_state(state_path, final_state);
+    }
+    else if (saved)
+    {
+        remove(state_path.c_str());
+    }
+    if (saved && journal_needs_compaction(out_path))
+    {
+        compact_journal(out_path);
+    }
+    if (!saved)
+    {
+        cerr << "Unable to save the tree to " << out_path << "\n";
+        destroy_tree(tree);
+        return 1;
+    }
+    printf("%lld iterations in %.2f s: %.0f iterations/s (%.0f per thread), %d checkpoint(s)\n", report.iterations, report.seconds,
+           report.iterations / report.seconds, report.iterations / report.seconds / options.threads, report.checkpoints);
+    printf("tree: %d -> %d games, %llu -> %llu nodes, saved to %s\n", games_before, tree->total_games,
+           static_cast<unsigned long long>(nodes_before), static_cast<unsigned long long>(count_tree_nodes(tree)), out_path.c_str());
+    if (report.stopped)
+    {
+        printf("interrupted after %lld iterations in total; continue with --resume\n", final_state.iterations_done);
+    }
+    destroy_tree(tree);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file training.hpp
+ * @brief Headless training for batch jobs (`checkers_exec train`).
+ *
+ * With several threads every thread trains its own copy of the tree (root parallelization), so the threads
+ * never wait for each other. At every checkpoint and at the end the changes of the copies are added
+ * to the first tree (`add_tree_changes`), which is the one that is saved.
+ *
+ * A checkpoint copies the changes out of the tree (`take_checkpoint`) and writes them on a background thread
+ * while training goes on. After the tree, the state of the run is written to `<out>.train`, so an interrupted
+ * run can be resumed (`--resume`) from its last checkpoint:
+ * a text file with the line "MCTS_TRAIN 1" followed by `key value` lines
+ * (iterations_done, iterations, seconds_done, seconds, checkpoints, checkpoint_every, checkpoint_seconds
+ * and random with the state of every thread's generator).
+ */
+#ifndef TRAINING_HPP
+#define TRAINING_HPP
+
+#include "classes.hpp"
+#include "mcts_algorithm.hpp"
+#include "tree_format.hpp"
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+/** @def TRAIN_CHUNK
+ *  @brief Iterations a thread runs between two looks at the clock, the stop flag and the iteration budget.
+ */
+#define TRAIN_CHUNK 64
+
+/** @def TRAIN_STATE_MAGIC
+ *  @brief First line of a training state file.
+ */
+#define TRAIN_STATE_MAGIC "MCTS_TRAIN 1"
+
+/**
+ * @struct TrainOptions
+ * @brief Options of a headless training run.
+ */
+struct TrainOptions
+{
+    long long iterations = 0;           /**< Number of iterations; 0 for no limit (then `seconds` must be set). */
+    double seconds = 0;                 /**< Time limit in seconds; 0 for no limit. */
+    int threads = 1;                    /**< Number of training threads. */
+    long long checkpoint_every = 0;     /**< Iterations between two checkpoints; 0 for none. */
+    double checkpoint_seconds = 0;      /**< Seconds between two checkpoints; 0 for none. */
+    vector<unsigned int> random_states; /**< Generator state of every thread (see `seed_thread_random`); empty: threads use rand(). */
+    const atomic<bool> *stop = nullptr; /**< If set, training stops once it becomes true (after the running chunk). */
+};
+
+/**
+ * @struct TrainReport
+ * @brief What a training run did; also passed to every checkpoint.
+ */
+struct TrainReport
+{
+    long long iterations = 0;           /**< Iterations run by all threads together. */
+    double seconds = 0;                 /**< Wall time of the run. */
+    int checkpoints = 0;                /**< Number of checkpoints taken (including the one that is being taken). */
+    bool stopped = false;               /**< True if training ended because of `TrainOptions::stop`. */
+    vector<unsigned int> random_states; /**< Current generator state of every thread (empty if the threads use rand()). */
+};
+
+/**
+ * @brief Trains a tree with several threads until the iteration budget or the time limit is reached or it is stopped.
+ * @param root_node The tree; thread 0 trains it, and the changes of all other threads are added to it.
+ * @param options Budget, threads, checkpoint interval, generator states and stop flag.
+ * @param open_copy Returns a new copy of the tree as it was before training (loaded from the same file);
+ * it is called once for every thread but the first.
+ * @param on_checkpoint Called with `root_node` every `checkpoint_every` iterations or `checkpoint_seconds` seconds,
+ * after the changes of all threads were added. Not called at the end; the caller saves the final tree.
+ * @return The number of iterations, the time, the number of checkpoints and the generator states.
+ */
+TrainReport train_parallel(MCTS_leaf *root_node, const TrainOptions &options, const function<MCTS_leaf *()> &open_copy,
+                           const function<void(MCTS_leaf *, const TrainReport &)> &on_checkpoint);
+
+/**
+ * @struct TrainState
+ * @brief Progress of a training run, written next to its output file at every checkpoint.
+ */
+struct TrainState
+{
+    long long iterations_done = 0;      /**< Iterations of all threads so far. */
+    long long iterations = 0;           /**< Iteration budget of the whole run (0: none). */
+    double seconds_done = 0;            /**< Training time so far. */
+    double seconds = 0;                 /**< Time budget of the whole run (0: none). */
+    int checkpoints = 0;                /**< Checkpoints taken so far. */
+    long long checkpoint_every = 0;     /**< Iterations between two checkpoints (0: none). */
+    double checkpoint_seconds = 0;      /**< Seconds between two checkpoints (0: none). */
+    vector<unsigned int> random_states; /**< Generator state of every thread. */
+};
+
+/**
+ * @brief Writes a training state file (to a temporary file that is renamed over `path`).
+ * @return true on success.
+ */
+bool write_train_state(const string &path, const TrainState &state);
+
+/**
+ * @brief Reads a training state file.
+ * @throws runtime_error if the file is not a training state file.
+ * @return false if the file can not be opened.
+ */
+bool read_train_state(const string &path, TrainState &state);
+
+/**
+ * @brief Command line entry for `checkers_exec train (--iterations N | --time S) [--threads T] [--in FILE] [--out FILE]
+ * [--seed X] [--checkpoint-every M] [--checkpoint-seconds T] [--resume]`.
+ * Loads `--in` (default mcts_tree.txt; a new tree if it does not exist), trains it without asking anything,
+ * saves it to `--out` (default: the input file; only the changes are appended when that is a binary file)
+ * and prints the throughput. `--seed` makes single threaded runs reproducible. SIGINT and SIGTERM stop the training
+ * after the running chunk and save everything; `--resume` continues the run from `<out>` and `<out>.train`
+ * with its budget and checkpoint interval (a new interval can be given).
+ * @param argc Number of arguments after "train".
+ * @param argv The arguments after "train".
+ * @return 0 on success (also when interrupted), 1 on error.
+ */
+int train_main(int argc, char *argv[]);
+
+#endif
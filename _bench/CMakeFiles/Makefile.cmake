@@ -0,0 +1,97 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/repo/CMakeLists.txt"
+  "/root/repo/MCTS_checkers/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CTest.cmake"
+  "/usr/share/cmake-3.25/Modules/CTestTargets.cmake"
+  "/usr/share/cmake-3.25/Modules/CTestUseLaunchers.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFile.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/DartConfiguration.tcl.in"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  "MCTS_checkers/DartConfiguration.tcl"
+  "MCTS_checkers/CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "MCTS_checkers/CMakeFiles/CLASSES.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/PERFT.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/TRAINING.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/SELFPLAY.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/checkers_exec.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/checkers_bench.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/Experimental.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/Nightly.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/Continuous.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyMemoryCheck.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyStart.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyUpdate.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyConfigure.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyBuild.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyTest.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyCoverage.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlyMemCheck.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/NightlySubmit.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalStart.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalUpdate.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalConfigure.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalBuild.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalTest.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalCoverage.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalMemCheck.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ExperimentalSubmit.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousStart.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousUpdate.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousConfigure.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousBuild.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousTest.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousCoverage.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousMemCheck.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/ContinuousSubmit.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/checkers_exec_test.dir/DependInfo.cmake"
+  "MCTS_checkers/CMakeFiles/TESTS.dir/DependInfo.cmake"
+  )
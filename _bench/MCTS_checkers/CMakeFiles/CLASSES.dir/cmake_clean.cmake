@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/CLASSES.dir/classes.cpp.o"
+  "CMakeFiles/CLASSES.dir/classes.cpp.o.d"
+  "libCLASSES.a"
+  "libCLASSES.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/CLASSES.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
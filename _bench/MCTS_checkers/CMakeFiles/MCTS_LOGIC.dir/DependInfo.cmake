@@ -0,0 +1,23 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/MCTS_checkers/alphabeta.cpp" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/alphabeta.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/alphabeta.cpp.o.d"
+  "/root/repo/MCTS_checkers/bitbase.cpp" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/bitbase.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/bitbase.cpp.o.d"
+  "/root/repo/MCTS_checkers/mcts_algorithm.cpp" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/mcts_algorithm.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/mcts_algorithm.cpp.o.d"
+  "/root/repo/MCTS_checkers/opening_book.cpp" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/opening_book.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/opening_book.cpp.o.d"
+  "/root/repo/MCTS_checkers/tree_format.cpp" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/tree_format.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/tree_format.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,19 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/MCTS_LOGIC.dir/alphabeta.cpp.o"
+  "CMakeFiles/MCTS_LOGIC.dir/alphabeta.cpp.o.d"
+  "CMakeFiles/MCTS_LOGIC.dir/bitbase.cpp.o"
+  "CMakeFiles/MCTS_LOGIC.dir/bitbase.cpp.o.d"
+  "CMakeFiles/MCTS_LOGIC.dir/mcts_algorithm.cpp.o"
+  "CMakeFiles/MCTS_LOGIC.dir/mcts_algorithm.cpp.o.d"
+  "CMakeFiles/MCTS_LOGIC.dir/opening_book.cpp.o"
+  "CMakeFiles/MCTS_LOGIC.dir/opening_book.cpp.o.d"
+  "CMakeFiles/MCTS_LOGIC.dir/tree_format.cpp.o"
+  "CMakeFiles/MCTS_LOGIC.dir/tree_format.cpp.o.d"
+  "libMCTS_LOGIC.a"
+  "libMCTS_LOGIC.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/MCTS_LOGIC.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/PERFT.dir/perft.cpp.o"
+  "CMakeFiles/PERFT.dir/perft.cpp.o.d"
+  "libPERFT.a"
+  "libPERFT.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/PERFT.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
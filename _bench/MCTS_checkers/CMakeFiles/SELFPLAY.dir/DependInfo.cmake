@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/MCTS_checkers/selfplay.cpp" "MCTS_checkers/CMakeFiles/SELFPLAY.dir/selfplay.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/SELFPLAY.dir/selfplay.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/DependInfo.cmake"
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/CLASSES.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/SELFPLAY.dir/selfplay.cpp.o"
+  "CMakeFiles/SELFPLAY.dir/selfplay.cpp.o.d"
+  "libSELFPLAY.a"
+  "libSELFPLAY.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/SELFPLAY.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TRAINING.dir/training.cpp.o"
+  "CMakeFiles/TRAINING.dir/training.cpp.o.d"
+  "libTRAINING.a"
+  "libTRAINING.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TRAINING.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,24 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/MCTS_checkers/main.cpp" "MCTS_checkers/CMakeFiles/checkers_exec.dir/main.cpp.o" "gcc" "MCTS_checkers/CMakeFiles/checkers_exec.dir/main.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/PERFT.dir/DependInfo.cmake"
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/TRAINING.dir/DependInfo.cmake"
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/SELFPLAY.dir/DependInfo.cmake"
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/MCTS_LOGIC.dir/DependInfo.cmake"
+  "/root/repo/_bench/MCTS_checkers/CMakeFiles/CLASSES.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
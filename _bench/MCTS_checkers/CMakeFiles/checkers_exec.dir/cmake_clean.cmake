@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/_bench./bin/checkers_exec"
+  "/root/repo/_bench./bin/checkers_exec.pdb"
+  "CMakeFiles/checkers_exec.dir/main.cpp.o"
+  "CMakeFiles/checkers_exec.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/checkers_exec.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
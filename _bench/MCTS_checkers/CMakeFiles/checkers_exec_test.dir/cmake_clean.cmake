@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/_bench./bin/checkers_exec_test"
+  "/root/repo/_bench./bin/checkers_exec_test.pdb"
+  "CMakeFiles/checkers_exec_test.dir/main.cpp.o"
+  "CMakeFiles/checkers_exec_test.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/checkers_exec_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/MCTS_checkers
+# Build directory: /root/repo/_bench/MCTS_checkers
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[checkers_core_test]=] "/root/repo/_bench./bin/checkers_exec_test")
+set_tests_properties([=[checkers_core_test]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/MCTS_checkers/CMakeLists.txt;67;add_test;/root/repo/MCTS_checkers/CMakeLists.txt;0;")
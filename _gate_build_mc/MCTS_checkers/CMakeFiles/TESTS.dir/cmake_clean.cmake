@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TESTS.dir/tests.cpp.o"
+  "CMakeFiles/TESTS.dir/tests.cpp.o.d"
+  "libTESTS.a"
+  "libTESTS.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TESTS.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
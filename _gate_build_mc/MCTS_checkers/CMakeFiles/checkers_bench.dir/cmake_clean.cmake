@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/_gate_build_mc./bin/checkers_bench"
+  "/root/repo/_gate_build_mc./bin/checkers_bench.pdb"
+  "CMakeFiles/checkers_bench.dir/bench.cpp.o"
+  "CMakeFiles/checkers_bench.dir/bench.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/checkers_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()